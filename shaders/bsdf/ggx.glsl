@@ -1,6 +1,8 @@
 #ifndef GGX_GLSL
 #define GGX_GLSL
 
+#include "../random.glsl"
+
 // inline float evaluateGGX(float alpha, const Vector &wh) {
 //     float nDotH = Frame::cosTheta(wh);
 //     float a     = Frame::cosPhiSinTheta(wh) / alpha;
@@ -70,15 +72,16 @@ float g_smith(vec3 v, vec3 h, float roughness) {
 //     return sgn * Ne;
 // }
 
-vec3 sample_ggx(vec3 v, float roughness, inout uint seed) {
+vec3 sample_ggx(vec3 v, float roughness, inout Sampler rng) {
   float sgn = sign(v.y);
   vec3 h = sgn * normalize(vec3(roughness * v.x, v.y, roughness * v.z));
   float lensqr = h.x * h.x + h.y * h.y;
   vec3 T1 = lensqr > 0 ? vec3(-h.z, h.x, 0) / sqrt(lensqr) : vec3(1,0,0);
   vec3 T2 = cross(h, T1);
   
-  float r = sqrt(random_float(seed));
-  float phi = 2.0 * PI * random_float(seed);
+  vec2 u = random_vec2(rng);
+  float r = sqrt(u.x);
+  float phi = 2.0 * PI * u.y;
 
   float t1 = r * cos(phi);
   float t2 = r * sin(phi);
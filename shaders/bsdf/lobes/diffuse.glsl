@@ -23,10 +23,11 @@ BSDFEvaluation eval_lobe_diffuse(vec3 ray_out, vec3 ray_in, Material material) {
     return result;
 }
 
-BSDFSample sample_lobe_diffuse(vec3 ray_out, Material material, inout uint seed) {
+BSDFSample sample_lobe_diffuse(vec3 ray_out, Material material, inout Sampler rng) {
     BSDFSample result;
 
-    DirectionSample dir_sample = sample_cosine_hemisphere(random_float(seed), random_float(seed));
+    vec2 u = random_vec2(rng);
+    DirectionSample dir_sample = sample_cosine_hemisphere(u.x, u.y);
 
     result.weight = material.base_color;
     result.direction = dir_sample.direction;
@@ -32,11 +32,11 @@ BSDFEvaluation eval_lobe_specular(vec3 ray_out, vec3 ray_in, Material material)
     return result;
 }
 
-BSDFSample sample_lobe_specular(vec3 ray_out, Material material, inout uint seed) {
+BSDFSample sample_lobe_specular(vec3 ray_out, Material material, inout Sampler rng) {
     BSDFSample result;
     float alpha = max(material.roughness * material.roughness, 0.001);
 
-    vec3 h = sample_ggx(ray_out, alpha, seed);
+    vec3 h = sample_ggx(ray_out, alpha, rng);
 
     vec3 ray_in = reflect(-ray_out, h);
 
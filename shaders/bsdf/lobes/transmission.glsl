@@ -39,14 +39,14 @@ BSDFEvaluation eval_lobe_transmission(vec3 ray_out, vec3 ray_in, Material materi
     return result;
 }
 
-BSDFSample sample_lobe_transmission(vec3 ray_out, Material material, inout uint seed) {
+BSDFSample sample_lobe_transmission(vec3 ray_out, Material material, inout Sampler rng) {
     BSDFSample result;
     float alpha = max(material.roughness * material.roughness, 0.001);
 
     float eta = material.ior;
     // if (ray_out.y < 0.0) eta = 1.0 / eta;
 
-    vec3 h = sample_ggx(ray_out, alpha, seed);
+    vec3 h = sample_ggx(ray_out, alpha, rng);
 
     float pdf = pdf_ggx(ray_out, h, alpha);
 
@@ -30,10 +30,10 @@ BSDFEvaluation eval_principled(vec3 ray_out, vec3 ray_in, Material material) {
     return result;
 }
 
-BSDFSample sample_principled(vec3 ray_out, Material material, inout uint seed) {
+BSDFSample sample_principled(vec3 ray_out, Material material, inout Sampler rng) {
 
     BSDFSample bsdf_sample;
-    if (random_float(seed) >= material.opacity) {
+    if (random_float(rng) >= material.opacity) {
         bsdf_sample.weight = vec3(1.0);
         bsdf_sample.direction = -ray_out;
         bsdf_sample.pdf = 1.0;
@@ -43,17 +43,17 @@ BSDFSample sample_principled(vec3 ray_out, Material material, inout uint seed) {
     float diff_weight, spec_weight, trans_weight;
     principled_lobe_weights(material, diff_weight, spec_weight, trans_weight);
 
-    float lobe_sel = random_float(seed);
+    float lobe_sel = random_float(rng);
     float lobe_prob = 0.0;
 
     if (lobe_sel < diff_weight) {
-        bsdf_sample = sample_lobe_diffuse(ray_out, material, seed);
+        bsdf_sample = sample_lobe_diffuse(ray_out, material, rng);
         lobe_prob = diff_weight;
     } else if (lobe_sel < diff_weight + spec_weight) {
-        bsdf_sample = sample_lobe_specular(ray_out, material, seed);
+        bsdf_sample = sample_lobe_specular(ray_out, material, rng);
         lobe_prob = spec_weight;
     } else {
-        bsdf_sample = sample_lobe_transmission(ray_out, material, seed);
+        bsdf_sample = sample_lobe_transmission(ray_out, material, rng);
         lobe_prob = trans_weight;
     }
 
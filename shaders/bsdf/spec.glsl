@@ -10,16 +10,16 @@ BSDFEvaluation eval_spec(vec3 ray_out, vec3 ray_in, Material material) {
     return eval;
 }
 
-BSDFSample sample_spec(vec3 ray_out, Material material, inout uint seed) {
+BSDFSample sample_spec(vec3 ray_out, Material material, inout Sampler rng) {
     BSDFSample bsdf_sample;
 
-    if (random_float(seed) >= material.opacity) {
+    if (random_float(rng) >= material.opacity) {
         bsdf_sample.weight = vec3(1.0);
         bsdf_sample.direction = -ray_out;
         bsdf_sample.pdf = 1.0;
         return bsdf_sample;
     }
 
-    bsdf_sample = sample_lobe_specular(ray_out, material, seed);
+    bsdf_sample = sample_lobe_specular(ray_out, material, rng);
     return bsdf_sample;
 }
\ No newline at end of file
@@ -71,16 +71,23 @@ uint decode_uint(vec3 encoded) {
     return uint(encoded.z * 255) + uint(encoded.y * (255 * 255)) + uint(encoded.x * (255 * 255 * 255));
 }
 
+// pixel coordinates are relative to the rendered region (tile), buffers are sized to the render extent
 uint pixel_to_index(uvec2 pixel_coordinates) {
     return pixel_coordinates.x + pixel_coordinates.y * get_push_constants().render_extent.x;
 }
 
+uvec2 pixel_to_image(uvec2 pixel_coordinates) {
+    return pixel_coordinates + get_push_constants().tile_offset;
+}
+
 vec2 pixel_to_ndc(vec2 pixel_coordinates) {
-    return ((pixel_coordinates / get_push_constants().render_extent) * 2.0) - 1.0;
+    PushConstants constants = get_push_constants();
+    return (((pixel_coordinates + constants.tile_offset) / constants.image_extent) * 2.0) - 1.0;
 }
 
 vec2 ndc_to_pixel(vec2 ndc) {
-    return ((ndc + 1.0) / 2.0) * get_push_constants().render_extent;
+    PushConstants constants = get_push_constants();
+    return ((ndc + 1.0) / 2.0) * constants.image_extent - constants.tile_offset;
 }
 
 #endif
\ No newline at end of file
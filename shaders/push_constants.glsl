@@ -2,23 +2,37 @@
 #define PUSH_CONSTANTS_GLSL
 
 #include "structs.glsl"
+#include "raytracing/interface.glsl"
 layout(std430, push_constant) uniform PConstants {PushConstantsPacked packed;} push_constants;
 
+// specialized pipeline variants replace the packed render settings with constants, so loops over samples and bounces can be unrolled and disabled lighting paths are removed
+layout(constant_id = SPECIALIZATION_CONSTANT_SETTINGS_SPECIALIZED) const bool settings_specialized = false;
+layout(constant_id = SPECIALIZATION_CONSTANT_MAX_DEPTH) const uint specialized_max_depth = 1;
+layout(constant_id = SPECIALIZATION_CONSTANT_FRAME_SAMPLES) const uint specialized_frame_samples = 1;
+layout(constant_id = SPECIALIZATION_CONSTANT_LIGHT_COUNT) const uint specialized_light_count = 0;
+layout(constant_id = SPECIALIZATION_CONSTANT_LIGHTING_FLAGS) const uint specialized_lighting_flags = ENABLE_DIRECT_LIGHTING | ENABLE_INDIRECT_LIGHTING;
+
 PushConstants get_push_constants() {
     PushConstantsPacked packed = push_constants.packed;
     PushConstants res;
 
-    res.sbt_stride =        uint(packed.stride_lcount_fsample_depth & 0xFF000000) >> 24;
-    res.light_count =       uint(packed.stride_lcount_fsample_depth & 0x00FF0000) >> 16;
-    res.frame_samples =     uint(packed.stride_lcount_fsample_depth & 0x0000FF00) >> 8;
-    res.max_depth =         uint(packed.stride_lcount_fsample_depth & 0x000000FF) >> 0;
+    res.sbt_stride =                uint(packed.stride_rr_fsample_depth & 0xFF000000) >> 24;
+    res.russian_roulette_depth =    uint(packed.stride_rr_fsample_depth & 0x00FF0000) >> 16;
+    res.frame_samples =             uint(packed.stride_rr_fsample_depth & 0x0000FF00) >> 8;
+    res.max_depth =                 uint(packed.stride_rr_fsample_depth & 0x000000FF) >> 0;
 
     res.sample_count =  uint(packed.sample_count);
     res.frame =         uint(packed.frame);
     res.flags =         uint(packed.flags);
 
-    res.environment_cdf_dimensions.x = uint(packed.env_dim_xy & 0xFFFF0000) >> 16;
-    res.environment_cdf_dimensions.y = uint(packed.env_dim_xy & 0x0000FFFF) >> 0;
+    if (settings_specialized) {
+        res.frame_samples = specialized_frame_samples;
+        res.max_depth = specialized_max_depth;
+        res.flags = (res.flags & ~uint(ENABLE_DIRECT_LIGHTING | ENABLE_INDIRECT_LIGHTING)) | specialized_lighting_flags;
+    }
+
+    res.environment_distribution_dimensions.x = uint(packed.env_dim_xy & 0xFFFF0000) >> 16;
+    res.environment_distribution_dimensions.y = uint(packed.env_dim_xy & 0x0000FFFF) >> 0;
 
     res.swapchain_extent.x = uint(packed.sc_ext_xy & 0xFFFF0000) >> 16;
     res.swapchain_extent.y = uint(packed.sc_ext_xy & 0x0000FFFF) >> 0;
@@ -26,8 +40,17 @@ PushConstants get_push_constants() {
     res.render_extent.x = uint(packed.r_ext_xy & 0xFFFF0000) >> 16;
     res.render_extent.y = uint(packed.r_ext_xy & 0x0000FFFF) >> 0;
 
+    res.tile_offset.x = uint(packed.tile_offset_xy & 0xFFFF0000) >> 16;
+    res.tile_offset.y = uint(packed.tile_offset_xy & 0x0000FFFF) >> 0;
+
+    res.image_extent.x = uint(packed.img_ext_xy & 0xFFFF0000) >> 16;
+    res.image_extent.y = uint(packed.img_ext_xy & 0x0000FFFF) >> 0;
+
     res.exposure = packed.exposure;
 
+    res.adaptive_threshold = packed.adaptive_threshold;
+    res.adaptive_min_frames = packed.adaptive_min_frames;
+
     res.inv_camera_matrix = packed.inv_camera_matrix;
     res.camera_position = packed.camera_position;
 
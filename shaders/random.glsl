@@ -27,4 +27,88 @@ vec3 random_vec3(inout uint seed) {
     return vec3(random_float(seed), random_float(seed), random_float(seed));
 }
 
+// owen scrambled sobol sequence with hash based scrambling
+// https://jcgt.org/published/0009/04/01/
+#define SAMPLER_RANDOM 0xFFFFFFFF
+
+// dimensions are assigned per path vertex so every sample of a pixel uses the same dimension for the same decision
+#define SAMPLER_DIMENSION_PIXEL 0
+#define SAMPLER_DIMENSION_BOUNCE 2
+#define SAMPLER_BOUNCE_DIMENSIONS 64
+#define SAMPLER_BOUNCE_OFFSET_BSDF 0
+#define SAMPLER_BOUNCE_OFFSET_RUSSIAN_ROULETTE 14
+#define SAMPLER_BOUNCE_OFFSET_LIGHT 16
+
+struct Sampler {
+    // scrambles the sequence of a pixel, state of the lcg for random samplers
+    uint seed;
+    // sample index within the sequence of the pixel, SAMPLER_RANDOM falls back to the lcg
+    uint index;
+    // next dimension drawn from the sequence
+    uint dimension;
+};
+
+Sampler sampler_init(uint seed, uint index, uint dimension) {
+    Sampler rng;
+    rng.seed = seed;
+    rng.index = index;
+    rng.dimension = dimension;
+    return rng;
+}
+
+// independent random samples, reproducible from a single seed
+Sampler sampler_from_seed(uint seed) {
+    return sampler_init(seed, SAMPLER_RANDOM, 0);
+}
+
+// first dimension of the given offset at the path vertex of the given depth (starting at 1)
+uint sampler_bounce_dimension(uint depth, uint offset) {
+    return SAMPLER_DIMENSION_BOUNCE + (depth - 1) * SAMPLER_BOUNCE_DIMENSIONS + offset;
+}
+
+uint laine_karras_permutation(uint x, uint seed) {
+    x += seed;
+    x ^= x * 0x6c50b47c;
+    x ^= x * 0xb82f1e52;
+    x ^= x * 0xc7afe638;
+    x ^= x * 0x8d22f6e6;
+    return x;
+}
+
+uint nested_uniform_scramble(uint x, uint seed) {
+    x = bitfieldReverse(x);
+    x = laine_karras_permutation(x, seed);
+    return bitfieldReverse(x);
+}
+
+// first two dimensions of the sobol sequence
+uint sobol(uint index, uint dimension) {
+    if (dimension == 0) return bitfieldReverse(index);
+
+    uint result = 0;
+    uint direction = 0x80000000;
+    for (; index != 0; index >>= 1) {
+        if ((index & 1) != 0) result ^= direction;
+        direction ^= direction >> 1;
+    }
+    return result;
+}
+
+float random_float(inout Sampler rng) {
+    if (rng.index == SAMPLER_RANDOM) return random_float(rng.seed);
+
+    uint dimension = rng.dimension++;
+    // consecutive pairs of dimensions share a shuffled index and form a stratified 2d sequence
+    uint pair_seed = hash_combine(dimension >> 1, rng.seed);
+    uint index = nested_uniform_scramble(rng.index, pair_seed);
+    uint value = nested_uniform_scramble(sobol(index, dimension & 1), hash_combine(dimension, pair_seed));
+    return float(value >> 8) / 16777216.0;
+}
+
+// both values come from the same pair of dimensions so they stay stratified against each other
+vec2 random_vec2(inout Sampler rng) {
+    rng.dimension = (rng.dimension + 1) & ~1u;
+    return vec2(random_float(rng), random_float(rng));
+}
+
 #endif
\ No newline at end of file
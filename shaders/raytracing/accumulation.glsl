@@ -0,0 +1,37 @@
+#ifndef ACCUMULATION_GLSL
+#define ACCUMULATION_GLSL
+
+#include "../common.glsl"
+#include "../push_constants.glsl"
+#include "output.glsl"
+
+// adds the mean of the frame's samples of a pixel to the accumulated outputs
+// depth is the number of path vertices of the last sample, written to the ray depth output
+void accumulate_frame(uint pixel_index, vec3 multisample_color, uint depth) {
+    PushConstants constants = get_push_constants();
+    uint sample_count = constants.sample_count;
+
+    vec3 multisample_color_normalized = multisample_color / constants.frame_samples;
+
+    vec3 accumulated_color = read_output(OUTPUT_BUFFER_ACCUMULATED, pixel_index).rgb;
+    // luminance sum, squared luminance sum, accumulated frames of this pixel, relative error (written by compaction)
+    vec4 variance = read_output(OUTPUT_BUFFER_VARIANCE, pixel_index);
+    float frame_luminance = luminance(multisample_color_normalized);
+    if (sample_count == 1) {
+        accumulated_color = multisample_color_normalized;
+        variance = vec4(frame_luminance, frame_luminance * frame_luminance, 1.0, 0.0);
+    } else {
+        accumulated_color += multisample_color_normalized;
+        variance.xyz += vec3(frame_luminance, frame_luminance * frame_luminance, 1.0);
+    }
+
+    write_output(OUTPUT_BUFFER_ACCUMULATED, pixel_index, vec4(accumulated_color, 1.0));
+    write_output(OUTPUT_BUFFER_VARIANCE, pixel_index, variance);
+
+    // pixels accumulate different frame counts when sampled adaptively
+    write_output(OUTPUT_BUFFER_RESULT, pixel_index, vec4(accumulated_color / variance.z * pow(2, constants.exposure), 1.0));
+
+    write_output(OUTPUT_BUFFER_RAY_DEPTH, pixel_index, vec4(vec3(float(depth) / constants.max_depth), 1.0));
+}
+
+#endif
@@ -1,3 +1,6 @@
+#ifndef RAYTRACING_BSDF_GLSL
+#define RAYTRACING_BSDF_GLSL
+
 #include "../bsdf/lambertian.glsl"
 #include "../bsdf/spec.glsl"
 #include "../bsdf/principled.glsl"
@@ -8,8 +11,10 @@ BSDFEvaluation eval_bsdf(vec3 ray_out, vec3 ray_in, Material material) {
     // return eval_principled(ray_out, ray_in, material);
 }
 
-BSDFSample sample_bsdf(vec3 ray_out, Material material, inout uint seed) {
-    return sample_lambertian(ray_out, material, seed);
-    // return sample_spec(ray_out, material, seed);
-    // return sample_principled(ray_out, material, seed);
-}
\ No newline at end of file
+BSDFSample sample_bsdf(vec3 ray_out, Material material, inout Sampler rng) {
+    return sample_lambertian(ray_out, material, rng);
+    // return sample_spec(ray_out, material, rng);
+    // return sample_principled(ray_out, material, rng);
+}
+
+#endif
@@ -1,24 +1,27 @@
 #ifndef PAYLOAD_GLSL
 #define PAYLOAD_GLSL
 
+// bounces are traced from the ray generation shader, hit and miss shaders only return data of a single path vertex
 struct RayPayload {
-    vec3 color;
+    // emission and next event estimation at the vertex, not weighted by the path throughput
+    vec3 radiance;
     uint depth;
 
-    vec3 contribution;
+    // continuation ray, the direction is zero when the path terminates
+    vec3 origin;
     uint pixel_index;
 
-    vec3 origin;
-    uint seed;
-    
     vec3 direction;
-    float last_bsdf_pdf_inv;
-
-
-    vec3 primary_hit_position;
+    // scrambles the sample sequence of the pixel
+    uint seed;
 
-    vec2 primary_hit_uv;
+    // sampled bsdf weight, already divided by the pdf
+    vec3 weight;
+    // inverse pdf of the previous bounce on input, of the sampled bounce on output
+    float last_bsdf_pdf_inv;
 
+    // index of the current path within the sample sequence of the pixel
+    uint sample_index;
 };
 
-#endif
\ No newline at end of file
+#endif
@@ -6,9 +6,16 @@
 #include "../random.glsl"
 
 #define TEXTURE_ID_ENVIRONMENT_ALBEDO 0
-#define TEXTURE_ID_ENVIRONMENT_MARGINAL 1
-#define TEXTURE_ID_ENVIRONMENT_CONDITIONAL 2
-
+// alias tables, rgba: threshold, alias, probability
+#define TEXTURE_ID_ENVIRONMENT_CONDITIONAL 1
+#define TEXTURE_ID_ENVIRONMENT_MARGINAL 2
+
+// converts the probability of a texel to a density over solid angle at polar angle theta
+float environment_texel_pdf_to_solid_angle(float texel_pdf, float theta, uvec2 map_dimensions) {
+    float sin_theta = abs(sin(theta));
+    if (sin_theta <= 0.0) return 0.0;
+    return texel_pdf * float(map_dimensions.x * map_dimensions.y) / (2.0 * PI * PI * sin_theta);
+}
 
 float pdf_environment(vec3 direction, uvec2 map_dimensions) {
     int width = int(map_dimensions.x);
@@ -20,32 +27,28 @@ float pdf_environment(vec3 direction, uvec2 map_dimensions) {
 
     vec2 thetaphi = thetaphi_from_dir(direction);
 
-    // uv coordinates from theta and phi
-    float u = thetaphi.y / (2.0 * PI);
+    // uv coordinates from theta and phi, phi is returned in [-pi, pi]
+    float u = fract(thetaphi.y / (2.0 * PI));
     float v = thetaphi.x / PI;
 
-    uint pixel_x = uint(u * width);
-    uint pixel_y = uint(v * height);
+    int texel_x = clamp(int(u * width), 0, width - 1);
+    int texel_y = clamp(int(v * height), 0, height - 1);
 
-    float conditional = fetch_texture(TEXTURE_ID_ENVIRONMENT_CONDITIONAL, ivec2(0, pixel_y)).r;
-    float conditional_lo = fetch_texture(TEXTURE_ID_ENVIRONMENT_CONDITIONAL, ivec2(0, pixel_y - 1)).r;
-    if (pixel_y % height == 0) conditional_lo = 0.0;
+    float row_pdf = fetch_texture(TEXTURE_ID_ENVIRONMENT_MARGINAL, ivec2(0, texel_y)).b;
+    float column_pdf = fetch_texture(TEXTURE_ID_ENVIRONMENT_CONDITIONAL, ivec2(texel_x, texel_y)).b;
 
-    float cdf = fetch_texture(TEXTURE_ID_ENVIRONMENT_MARGINAL, ivec2(pixel_x, pixel_y)).r;
-    float cdf_lo = fetch_texture(TEXTURE_ID_ENVIRONMENT_MARGINAL, ivec2(pixel_x - 1, pixel_y)).r;
-    if (pixel_x % width == 0) cdf_lo = 0.0;
-
-    return (cdf - cdf_lo) * (conditional - conditional_lo) * (abs(sin(thetaphi.x)) * 2.0 * PI * PI) * (width * height);
+    return environment_texel_pdf_to_solid_angle(row_pdf * column_pdf, thetaphi.x, map_dimensions);
 }
 
-LightSample sample_environment(uint seed, uvec2 map_dimensions) {
+LightSample sample_environment(Sampler rng, uvec2 map_dimensions) {
     int width = int(map_dimensions.x);
     int height = int(map_dimensions.y);
 
     if (width == 1 && height == 1) {
-        float phi = random_float(seed) * 2.0 * PI;
+        vec2 u = random_vec2(rng);
+        float phi = u.x * 2.0 * PI;
         
-        float cos_theta = 2.0 * random_float(seed) - 1.0;
+        float cos_theta = 2.0 * u.y - 1.0;
         float sin_theta = sqrt(1.0 - cos_theta * cos_theta);
 
         vec3 dir = dir_from_thetaphi(cos_theta, sin_theta, phi);
@@ -60,52 +63,38 @@ LightSample sample_environment(uint seed, uvec2 map_dimensions) {
         return result;
     }
 
-    float conditional_target = random_float(seed);
-    int conditional_y = 0;
-    float conditional_low = fetch_texture(TEXTURE_ID_ENVIRONMENT_CONDITIONAL, ivec2(0, conditional_y)).r;
-    float conditional_hi = fetch_texture(TEXTURE_ID_ENVIRONMENT_CONDITIONAL, ivec2(0, conditional_y + 1)).r;
-
-
-    while (!(conditional_target < conditional_hi && conditional_target >= conditional_low)) {
-        conditional_low = conditional_hi;
-        conditional_y += 1;
-        conditional_hi = fetch_texture(TEXTURE_ID_ENVIRONMENT_CONDITIONAL, ivec2(0, conditional_y)).r;
-
-        if (conditional_y + 1 >= height) {
-            conditional_y = height - 1;
-            break;
-        }
+    // row from the marginal table, then column from the table of that row, each with a uniform pick and one alias test
+    vec2 u_row = random_vec2(rng);
+    int texel_y = min(int(u_row.x * height), height - 1);
+    vec4 row = fetch_texture(TEXTURE_ID_ENVIRONMENT_MARGINAL, ivec2(0, texel_y));
+    if (u_row.y >= row.r) {
+        texel_y = int(row.g);
+        row = fetch_texture(TEXTURE_ID_ENVIRONMENT_MARGINAL, ivec2(0, texel_y));
     }
 
-    float cdf_target = random_float(seed);
-    int cdf_x = 0;
-    float cdf_low = fetch_texture(TEXTURE_ID_ENVIRONMENT_MARGINAL, ivec2(cdf_x, conditional_y)).r;
-    float cdf_hi = fetch_texture(TEXTURE_ID_ENVIRONMENT_MARGINAL, ivec2(cdf_x + 1, conditional_y)).r;
-
-    while (!(cdf_target <= cdf_hi && cdf_target > cdf_low)) {
-        cdf_low = cdf_hi;
-        cdf_x += 1;
-        cdf_hi = fetch_texture(TEXTURE_ID_ENVIRONMENT_MARGINAL, ivec2(cdf_x, conditional_y)).r;
-
-        if (cdf_x + 1 >= width) {
-            cdf_x = width - 1;
-            break;
-        }
+    vec2 u_column = random_vec2(rng);
+    int texel_x = min(int(u_column.x * width), width - 1);
+    vec4 column = fetch_texture(TEXTURE_ID_ENVIRONMENT_CONDITIONAL, ivec2(texel_x, texel_y));
+    if (u_column.y >= column.r) {
+        texel_x = int(column.g);
+        column = fetch_texture(TEXTURE_ID_ENVIRONMENT_CONDITIONAL, ivec2(texel_x, texel_y));
     }
 
-    float u = ((float(cdf_x) + random_float(seed)) / width);
-    float v = ((float(conditional_y) + random_float(seed)) / height);
+    // uniform within the texel
+    vec2 u_texel = random_vec2(rng);
+    float u = ((float(texel_x) + u_texel.x) / width);
+    float v = ((float(texel_y) + u_texel.y) / height);
 
     float theta = v * PI;
     float phi = u * 2.0 * PI;
 
     vec3 direction = dir_from_thetaphi(theta, phi);
 
-    float pdf = (cdf_hi - cdf_low) * (conditional_hi - conditional_low) / (abs(sin(theta)) * 2.0 * PI * PI) * (width * height);
+    float pdf = environment_texel_pdf_to_solid_angle(row.b * column.b, theta, map_dimensions);
     
     LightSample result;
     result.pdf = pdf;
-    result.weight = sample_texture(TEXTURE_ID_ENVIRONMENT_ALBEDO, vec2(u, v)).rgb / pdf;
+    result.weight = pdf > 0.0 ? sample_texture(TEXTURE_ID_ENVIRONMENT_ALBEDO, vec2(u, v)).rgb / pdf : vec3(0.0);
     result.distance = FLT_MAX;
     result.direction = direction;
     return result;
@@ -4,6 +4,8 @@
 
 #define ENABLE_DIRECT_LIGHTING 1
 #define ENABLE_INDIRECT_LIGHTING 2
+// trace only the compacted list of unconverged pixels
+#define ADAPTIVE_SAMPLING 4
 
 #define DESCRIPTOR_SET_FRAMEWORK 0
 #define DESCRIPTOR_SET_OBJECTS 1
@@ -14,6 +16,8 @@
 #define DESCRIPTOR_BINDING_CAMERA_PARAMETERS 1
 #define DESCRIPTOR_BINDING_OUTPUT_BUFFERS 2
 #define DESCRIPTOR_BINDING_LIGHTS 3
+#define DESCRIPTOR_BINDING_LIGHT_TREE 4
+#define DESCRIPTOR_BINDING_LIGHT_DISTRIBUTIONS 5
 
 // mesh data bindings
 #define DESCRIPTOR_BINDING_MESH_INDICES 0
@@ -32,6 +36,15 @@
 // custom data bindings
 #define DESCRIPTOR_BINDING_RESTIR_RESERVOIRS 0
 #define DESCRIPTOR_BINDING_PREVIOUS_CAMERA_MATRIX 1
+#define DESCRIPTOR_BINDING_ADAPTIVE_SAMPLING 2
+#define DESCRIPTOR_BINDING_WAVEFRONT_STATE 3
+#define DESCRIPTOR_BINDING_WAVEFRONT_PATHS 4
+#define DESCRIPTOR_BINDING_WAVEFRONT_RAYS 5
+#define DESCRIPTOR_BINDING_WAVEFRONT_HITS 6
+#define DESCRIPTOR_BINDING_WAVEFRONT_SHADOW_RAYS 7
+#define DESCRIPTOR_BINDING_WAVEFRONT_SORT 8
+#define DESCRIPTOR_BINDING_WAVEFRONT_RAY_SORT 9
+#define DESCRIPTOR_BINDING_WAVEFRONT_RAY_SORT_HISTOGRAMS 10
 
 // output buffer indices
 #define OUTPUT_BUFFER_RESULT 0
@@ -46,5 +59,49 @@
 #define OUTPUT_BUFFER_RAY_DEPTH 9
 #define OUTPUT_BUFFER_ENVIRONMENT_CONDITIONAL 10
 #define OUTPUT_BUFFER_ENVIRONMENT_MARGINAL 11
+#define OUTPUT_BUFFER_VARIANCE 12
+
+// material flags
+#define MATERIAL_FLAG_DOUBLE_SIDED 1
+
+// light tree node flags
+#define LIGHT_TREE_NODE_LEAF 1
+// directional lights are not part of the hierarchy and precede its root
+#define LIGHT_TREE_NODE_INFINITE 2
+
+// entries of the top level light distribution, directional lights follow the environment and precede the hierarchy
+#define LIGHT_DISTRIBUTION_ENVIRONMENT 0
+#define LIGHT_DISTRIBUTION_INFINITE_OFFSET 1
+
+// output buffer storage formats
+#define OUTPUT_FORMAT_RGBA32F 0
+#define OUTPUT_FORMAT_RGBA16F 1
+#define OUTPUT_FORMAT_RGBA8 2
+
+// threads per workgroup of the wavefront kernels, queues grow their indirect dispatch in steps of one group
+#define WAVEFRONT_GROUP_SIZE 256
+// hits are binned by material before shading, one bin per scene material (wrapping around beyond 255) and a last one for misses
+// the histogram is built in shared memory with one thread per bin, so this equals the group size
+#define WAVEFRONT_SORT_BINS 256
+// secondary rays can be traced ordered by a key of direction octant (3 bits) and morton code of the origin cell (4 bits per axis)
+#define WAVEFRONT_COHERENCE_CELL_BITS 4
+// the key is sorted by an lsd radix sort with one thread per digit value, so digits equal the group size
+#define WAVEFRONT_RADIX_BITS 8
+#define WAVEFRONT_RADIX_DIGITS 256
+#define WAVEFRONT_RADIX_PASSES 2
+
+// square workgroups of the megakernel integrator, neighbouring pixels start with coherent camera rays
+#define MEGAKERNEL_GROUP_SIZE 8
+
+// specialization constant ids of the raytracing stages
+#define SPECIALIZATION_CONSTANT_ENABLED_OUTPUTS 0
+#define SPECIALIZATION_CONSTANT_HALF_OUTPUTS 1
+#define SPECIALIZATION_CONSTANT_UNORM8_OUTPUTS 2
+// fixed render settings of specialized pipeline variants
+#define SPECIALIZATION_CONSTANT_SETTINGS_SPECIALIZED 3
+#define SPECIALIZATION_CONSTANT_MAX_DEPTH 4
+#define SPECIALIZATION_CONSTANT_FRAME_SAMPLES 5
+#define SPECIALIZATION_CONSTANT_LIGHT_COUNT 6
+#define SPECIALIZATION_CONSTANT_LIGHTING_FLAGS 7
 
 #endif
\ No newline at end of file
@@ -0,0 +1,31 @@
+#ifndef LIGHT_DISTRIBUTIONS_GLSL
+#define LIGHT_DISTRIBUTIONS_GLSL
+
+#include "../structs.glsl"
+#include "../random.glsl"
+#include "interface.glsl"
+
+#ifndef NO_LAYOUT
+// top level table over the environment, directional lights and the light hierarchy, followed by the per triangle tables of area lights
+layout(std430, set = DESCRIPTOR_SET_FRAMEWORK, binding = DESCRIPTOR_BINDING_LIGHT_DISTRIBUTIONS) readonly buffer LightDistributionData {AliasTableEntry entries[];} light_distributions;
+#endif
+
+// samples the table of count entries starting at offset, returns the index within the table and its probability
+uint sample_alias_table(uint offset, uint count, inout Sampler rng, out float pdf) {
+    vec2 u = random_vec2(rng);
+    uint index = min(uint(u.x * count), count - 1);
+    AliasTableEntry entry = light_distributions.entries[offset + index];
+    if (u.y >= entry.threshold) {
+        index = entry.alias;
+        entry = light_distributions.entries[offset + index];
+    }
+    pdf = entry.pdf;
+    return index;
+}
+
+// probability of next event estimation sampling the environment
+float pdf_environment_selection() {
+    return light_distributions.entries[LIGHT_DISTRIBUTION_ENVIRONMENT].pdf;
+}
+
+#endif
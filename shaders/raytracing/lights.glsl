@@ -8,6 +8,7 @@
 #include "../random.glsl"
 #include "../push_constants.glsl"
 #include "environment.glsl"
+#include "light_distributions.glsl"
 
 #ifndef IGNORE_AREA_LIGHTS
 #include "mesh_data.glsl"
@@ -15,19 +16,11 @@
 
 #ifndef NO_LAYOUT
 layout(std430, set = DESCRIPTOR_SET_FRAMEWORK, binding = DESCRIPTOR_BINDING_LIGHTS) readonly buffer LightsData {Light[] lights;} lights_data;
+// header: infinite light count, node count, light count, top level distribution size
+layout(std430, set = DESCRIPTOR_SET_FRAMEWORK, binding = DESCRIPTOR_BINDING_LIGHT_TREE) readonly buffer LightTreeData {uvec4 header; LightTreeNode nodes[];} light_tree;
 #endif
 
-float pdf_area_light(uint instance, uint primitive, mat4x3 transform) {
-    vec3 v0, v1, v2;
-    get_vertices(instance, primitive, v0, v1, v2);
-    v0 = transform * vec4(v0, 1.0);
-    v1 = transform * vec4(v1, 1.0);
-    v2 = transform * vec4(v2, 1.0);
-    float area = dot(v1-v0, v2-v0);
-    return 1.0 / area;
-}
-
-LightSample sample_light(vec3 position, uint seed, Light light) {
+LightSample sample_light(vec3 position, Sampler rng, Light light) {
     LightSample light_sample;
     uint type = light.uint_data[0];
     vec3 direction;
@@ -45,11 +38,8 @@ LightSample sample_light(vec3 position, uint seed, Light light) {
         #ifndef IGNORE_AREA_LIGHTS
         case 1: // AREA LIGHT
             uint instance = light.uint_data[1];
-            uint vertex_count = light.uint_data[2];
-            uint primitive_count = vertex_count / 3;
-
-            uint primitive = uint(floor(random_float(seed) * primitive_count));
-            vec3 light_position = get_vertex_position(instance, primitive, vec2(random_float(seed), random_float(seed)));
+            uint triangle_count = light.uint_data[2];
+            uint distribution_offset = light.uint_data[3];
 
             mat4x3 transform;
             transform[0][0] = light.float_data[0];
@@ -69,7 +59,20 @@ LightSample sample_light(vec3 position, uint seed, Light light) {
             // transform[2][3] = light.float_data[14];
             // transform[3][3] = light.float_data[15];
 
-            light_position = transform * vec4(light_position, 1.0);
+            // triangles are chosen proportional to their emitted power
+            float triangle_pdf;
+            uint primitive = sample_alias_table(distribution_offset, triangle_count, rng, triangle_pdf);
+
+            // uniform point on the triangle
+            vec2 barycentrics = random_vec2(rng);
+            if (barycentrics.x + barycentrics.y > 1.0) barycentrics = 1.0 - barycentrics;
+
+            vec3 v0, v1, v2;
+            get_vertices(instance, primitive, v0, v1, v2);
+            v0 = transform * vec4(v0, 1.0);
+            v1 = transform * vec4(v1, 1.0);
+            v2 = transform * vec4(v2, 1.0);
+            vec3 light_position = v0 * (1.0 - barycentrics.x - barycentrics.y) + v1 * barycentrics.x + v2 * barycentrics.y;
 
             direction = light_position - position;
             distance = length(direction);
@@ -77,11 +80,17 @@ LightSample sample_light(vec3 position, uint seed, Light light) {
             light_sample.direction = direction / distance;
             light_sample.distance = distance;
 
-            float pdf = 1.0 / (pdf_area_light(instance, primitive, transform) / primitive_count);
+            // area pdf triangle_pdf / area converted to solid angle, area * cos is the projected area towards the position
+            vec3 face_normal = get_face_normal(v0, v1, v2, mat3(transform));
+            float projected_area = 0.5 * abs(dot(face_normal, light_sample.direction));
+            float pdf = triangle_pdf * distance * distance / max(projected_area, EPSILON * EPSILON);
 
-            vec2 uv = get_vertex_uv(instance, primitive, vec2(random_float(seed), random_float(seed)));
+            // emission is evaluated at the sampled point
+            vec2 uv = get_vertex_uv(instance, primitive, barycentrics);
             Material material = get_material(instance, uv);
             light_sample.weight = material.emission / pdf;
+            // single sided emitters do not light positions behind them
+            if (!is_double_sided(instance) && dot(face_normal, light_sample.direction) >= 0.0) light_sample.weight = vec3(0.0);
             light_sample.pdf = pdf;
             break;
         #endif
@@ -95,22 +104,123 @@ LightSample sample_light(vec3 position, uint seed, Light light) {
     return light_sample;
 }
 
-LightSample sample_direct_light(uint seed, vec3 position) {
-    PushConstants constants = get_push_constants();
-    LightSample light_sample;
-    if (constants.light_count > 0) {
-        if (random_float(seed) < 0.5) {
-            uint light_idx = random_uint(seed) % constants.light_count;
-            Light light = lights_data.lights[light_idx];
-            light_sample = sample_light(position, seed, light);
-            light_sample.weight *= constants.light_count;
+// conservative estimate of the irradiance a node can contribute at the position
+float light_tree_importance(LightTreeNode node, vec3 position) {
+    if ((node.flags & LIGHT_TREE_NODE_INFINITE) != 0) return node.power;
+
+    vec3 center = 0.5 * (node.bounds_min + node.bounds_max);
+    vec3 to_position = position - center;
+    float distance_squared = dot(to_position, to_position);
+    float radius_squared = 0.25 * dot(node.bounds_max - node.bounds_min, node.bounds_max - node.bounds_min);
+
+    // no falloff inside the bounding sphere
+    if (distance_squared <= radius_squared) return node.power / max(radius_squared, EPSILON);
+
+    float importance = node.power / distance_squared;
+    if (node.theta_o >= PI) return importance;
+
+    // smallest angle between any emitting normal and any direction from the bounds towards the position
+    float distance = sqrt(distance_squared);
+    float theta = acos(clamp(dot(node.axis, to_position / distance), -1.0, 1.0));
+    float theta_u = asin(clamp(sqrt(radius_squared) / distance, 0.0, 1.0));
+    float theta_min = max(0.0, theta - node.theta_o - theta_u);
+    if (theta_min >= node.theta_e) return 0.0;
+
+    return importance * cos(theta_min);
+}
+
+uint get_light_count() {
+    if (settings_specialized) return specialized_light_count;
+    return light_tree.header.z;
+}
+
+// stochastic descent from the node towards a single leaf, returns the index of the light and multiplies the probability of each step into selection_pdf
+uint select_light(uint node_index, inout Sampler rng, vec3 position, inout float selection_pdf) {
+    LightTreeNode node = light_tree.nodes[node_index];
+    while ((node.flags & LIGHT_TREE_NODE_LEAF) == 0) {
+        float importance_left = light_tree_importance(light_tree.nodes[node.index], position);
+        float importance_right = light_tree_importance(light_tree.nodes[node.index + 1], position);
+        float importance_total = importance_left + importance_right;
+        if (importance_total <= 0.0) {
+            selection_pdf = 0.0;
+            return 0;
+        }
+
+        float probability_left = importance_left / importance_total;
+        if (random_float(rng) < probability_left) {
+            selection_pdf *= probability_left;
+            node = light_tree.nodes[node.index];
         } else {
-            light_sample = sample_environment(seed, constants.environment_cdf_dimensions);
+            selection_pdf *= 1.0 - probability_left;
+            node = light_tree.nodes[node.index + 1];
         }
-        light_sample.weight *= 2.0;
+    }
+
+    return node.index;
+}
+
+// probability of next event estimation choosing the light of the leaf at the position, retraces the descent of select_light from the leaf up
+float pdf_light_selection(uint leaf_index, vec3 position) {
+    // the hierarchy is the last entry of the top level distribution
+    float selection_pdf = light_distributions.entries[light_tree.header.w - 1].pdf;
+    uint root_index = light_tree.header.x;
+    uint node_index = leaf_index;
+    while (node_index != root_index) {
+        uint parent_index = light_tree.nodes[node_index].parent;
+        uint first_child = light_tree.nodes[parent_index].index;
+        float importance_left = light_tree_importance(light_tree.nodes[first_child], position);
+        float importance_right = light_tree_importance(light_tree.nodes[first_child + 1], position);
+        float importance_total = importance_left + importance_right;
+        if (importance_total <= 0.0) return 0.0;
+
+        selection_pdf *= (node_index == first_child ? importance_left : importance_right) / importance_total;
+        node_index = parent_index;
+    }
+    return selection_pdf;
+}
+
+#ifndef IGNORE_AREA_LIGHTS
+// solid angle density of next event estimation sampling a point on the triangle of an area light from the position
+// face_normal is the unnormalized world space normal of the triangle, direction and distance lead from the position to the point
+float pdf_area_light(uint instance, uint primitive, vec3 face_normal, vec3 position, vec3 direction, float distance) {
+    uint leaf_index = get_material_parameters(instance).light_node;
+    if (leaf_index == NULL_LIGHT_NODE) return 0.0;
+
+    Light light = lights_data.lights[light_tree.nodes[leaf_index].index];
+    float triangle_pdf = light_distributions.entries[light.uint_data[3] + primitive].pdf;
+    float projected_area = 0.5 * abs(dot(face_normal, direction));
+    return pdf_light_selection(leaf_index, position) * triangle_pdf * distance * distance / max(projected_area, EPSILON * EPSILON);
+}
+#endif
+
+LightSample sample_direct_light(Sampler rng, vec3 position) {
+    PushConstants constants = get_push_constants();
+
+    // the top level distribution only holds the environment
+    if (get_light_count() == 0) return sample_environment(rng, constants.environment_distribution_dimensions);
+
+    // the environment, each directional light and the hierarchy over all other lights are chosen by emitted power
+    float selection_pdf;
+    uint entry = sample_alias_table(0, light_tree.header.w, rng, selection_pdf);
+
+    LightSample light_sample;
+    if (entry == LIGHT_DISTRIBUTION_ENVIRONMENT) {
+        light_sample = sample_environment(rng, constants.environment_distribution_dimensions);
     } else {
-        light_sample = sample_environment(seed, constants.environment_cdf_dimensions);
+        uint light_idx = select_light(entry - LIGHT_DISTRIBUTION_INFINITE_OFFSET, rng, position, selection_pdf);
+        if (selection_pdf <= 0.0) {
+            // no light can contribute here
+            light_sample.direction = vec3(0.0, 1.0, 0.0);
+            light_sample.distance = 1.0;
+            light_sample.weight = vec3(0.0);
+            light_sample.pdf = 1.0;
+            return light_sample;
+        }
+        light_sample = sample_light(position, rng, lights_data.lights[light_idx]);
     }
+
+    light_sample.weight /= selection_pdf;
+    light_sample.pdf *= selection_pdf;
     return light_sample;
 }
 
@@ -13,6 +13,10 @@ MaterialParameters get_material_parameters(uint instance) {
     return material_parameters.data[instance];
 }
 
+bool is_double_sided(uint instance) {
+    return (get_material_parameters(instance).flags & MATERIAL_FLAG_DOUBLE_SIDED) != 0;
+}
+
 Material get_material(uint instance, vec2 uv) {
     Material result;
 
@@ -28,6 +28,12 @@ void get_vertices(uint instance, uint primitive, out vec3 v0, out vec3 v1, out v
     v2 = vertices.data[data_offset + indices.data[index_offset + idx2]].xyz;
 }
 
+// unnormalized normal of the front face from world space vertices, front faces wind counterclockwise unless the transform mirrors them
+vec3 get_face_normal(vec3 v0, vec3 v1, vec3 v2, mat3 transform) {
+    vec3 normal = cross(v1 - v0, v2 - v0);
+    return determinant(transform) < 0.0 ? -normal : normal;
+}
+
 vec3 get_vertex_position(uint instance, uint primitive, vec2 barycentrics) {
     vec3 vert0, vert1, vert2;
     get_vertices(instance, primitive, vert0, vert1, vert2);
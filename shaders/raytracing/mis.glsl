@@ -1,3 +1,14 @@
+#ifndef MIS_GLSL
+#define MIS_GLSL
+
 float balance_heuristic(float n_f, float p_f, float n_g, float p_g) {
     return (n_f * p_f) / (n_f * p_f + n_g * p_g);
-}
\ No newline at end of file
+}
+
+// power heuristic weight of a strategy, the argument is the pdf of the other strategy divided by its own
+// written as a ratio so that the FLT_MAX pdfs of point and directional lights keep the weights finite
+float power_heuristic(float other_pdf_ratio) {
+    return 1.0 / (1.0 + other_pdf_ratio * other_pdf_ratio);
+}
+
+#endif
@@ -1,16 +1,47 @@
 #ifndef OUTPUT_GLSL
 #define OUTPUT_GLSL
 
+#include "interface.glsl"
+
 #ifndef NO_LAYOUT
+// the same descriptors are aliased with packed layouts for half precision and 8 bit outputs
 layout(set = DESCRIPTOR_SET_FRAMEWORK, binding = DESCRIPTOR_BINDING_OUTPUT_BUFFERS) buffer OutputBuffer { vec4 color[]; } output_buffers[];
+layout(set = DESCRIPTOR_SET_FRAMEWORK, binding = DESCRIPTOR_BINDING_OUTPUT_BUFFERS) buffer OutputBufferHalf { uvec2 color[]; } output_buffers_half[];
+layout(set = DESCRIPTOR_SET_FRAMEWORK, binding = DESCRIPTOR_BINDING_OUTPUT_BUFFERS) buffer OutputBufferUnorm8 { uint color[]; } output_buffers_unorm8[];
 #endif
 
+// bit masks over output buffer indices, specialized when the pipeline is built
+layout(constant_id = SPECIALIZATION_CONSTANT_ENABLED_OUTPUTS) const uint enabled_outputs = 0xFFFFFFFF;
+layout(constant_id = SPECIALIZATION_CONSTANT_HALF_OUTPUTS) const uint half_outputs = 0;
+layout(constant_id = SPECIALIZATION_CONSTANT_UNORM8_OUTPUTS) const uint unorm8_outputs = 0;
+
+bool output_enabled(uint buffer_id) {
+    return (enabled_outputs & (1u << buffer_id)) != 0u;
+}
+
+// writes to disabled outputs are removed when the specialization constants are folded
 void write_output(uint buffer_id, uint pixel_index, vec4 value) {
-    output_buffers[buffer_id].color[pixel_index] = value;
+    if (!output_enabled(buffer_id)) return;
+
+    if ((half_outputs & (1u << buffer_id)) != 0u) {
+        output_buffers_half[buffer_id].color[pixel_index] = uvec2(packHalf2x16(value.xy), packHalf2x16(value.zw));
+    } else if ((unorm8_outputs & (1u << buffer_id)) != 0u) {
+        output_buffers_unorm8[buffer_id].color[pixel_index] = packUnorm4x8(value);
+    } else {
+        output_buffers[buffer_id].color[pixel_index] = value;
+    }
 }
 
 vec4 read_output(uint buffer_id, uint pixel_index) {
+    if (!output_enabled(buffer_id)) return vec4(0.0);
+
+    if ((half_outputs & (1u << buffer_id)) != 0u) {
+        uvec2 packed_value = output_buffers_half[buffer_id].color[pixel_index];
+        return vec4(unpackHalf2x16(packed_value.x), unpackHalf2x16(packed_value.y));
+    } else if ((unorm8_outputs & (1u << buffer_id)) != 0u) {
+        return unpackUnorm4x8(output_buffers_unorm8[buffer_id].color[pixel_index]);
+    }
     return output_buffers[buffer_id].color[pixel_index];
 }
 
-#endif
\ No newline at end of file
+#endif
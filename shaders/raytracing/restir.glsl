@@ -17,7 +17,7 @@ layout(std430, set = CUSTOM_DESCRIPTOR_SET_RESTIR, binding = CUSTOM_DESCRIPTOR_B
 float restir_p_hat(uint pixel_index, uint seed) {
     vec3 position = read_output(OUTPUT_BUFFER_POSITION, pixel_index).xyz;
     vec3 normal = read_output(OUTPUT_BUFFER_NORMAL, pixel_index).xyz;
-    LightSample light_sample = sample_direct_light(seed, position);
+    LightSample light_sample = sample_direct_light(sampler_from_seed(seed), position);
     // return luminance(light_sample.weight) * abs(dot(light_sample.direction, normal));
     return length(light_sample.weight);
 }
@@ -0,0 +1,52 @@
+#ifndef SHADE_ENVIRONMENT_GLSL
+#define SHADE_ENVIRONMENT_GLSL
+
+#include "../push_constants.glsl"
+#include "../common.glsl"
+#include "texture_data.glsl"
+#include "environment.glsl"
+#include "light_distributions.glsl"
+#include "output.glsl"
+#include "mis.glsl"
+
+// radiance of the environment along a ray leaving the scene, camera rays also write the first hit outputs
+// last_bsdf_pdf_inv is the inverse pdf of the bounce that sampled the direction
+vec3 shade_environment(vec3 ray_origin, vec3 ray_direction, uint depth, uint pixel_index, float last_bsdf_pdf_inv) {
+    PushConstants constants = get_push_constants();
+
+    // calculate theta and phi for environment map
+    vec2 thetaphi = thetaphi_from_dir(ray_direction);
+
+    // uv coordinates from theta and phi
+    float u = thetaphi.y / (2.0 * PI);
+    float v = thetaphi.x / PI;
+
+    // query environment map color
+    vec3 env_color = sample_texture(TEXTURE_ID_ENVIRONMENT_ALBEDO, vec2(u, v)).rgb;
+
+    if (depth == 1) {
+        write_output(OUTPUT_BUFFER_ALBEDO, pixel_index, vec4(env_color, 1.0));
+        write_output(OUTPUT_BUFFER_NORMAL, pixel_index, vec4(0.0));
+        write_output(OUTPUT_BUFFER_POSITION, pixel_index, vec4(ray_origin, 1.0));
+
+        // sampling probabilities relative to a uniform distribution
+        write_output(OUTPUT_BUFFER_ENVIRONMENT_CONDITIONAL, pixel_index, vec4(sample_texture(TEXTURE_ID_ENVIRONMENT_CONDITIONAL, vec2(u,v)).b * constants.environment_distribution_dimensions.x));
+        write_output(OUTPUT_BUFFER_ENVIRONMENT_MARGINAL, pixel_index, vec4(sample_texture(TEXTURE_ID_ENVIRONMENT_MARGINAL, vec2(u,v)).b * constants.environment_distribution_dimensions.y));
+
+        write_output(OUTPUT_BUFFER_INSTANCE, pixel_index, vec4(encode_uint(NULL_INSTANCE), 0.0));
+        write_output(OUTPUT_BUFFER_INSTANCE_COLOR, pixel_index, vec4(vec3(0.0), 1.0));
+
+        return env_color;
+    }
+
+    if ((constants.flags & ENABLE_INDIRECT_LIGHTING) != ENABLE_INDIRECT_LIGHTING) return vec3(0.0);
+
+    float mis = 1.0;
+    if ((constants.flags & ENABLE_DIRECT_LIGHTING) == ENABLE_DIRECT_LIGHTING) {
+        float env_pdf = pdf_environment(ray_direction, constants.environment_distribution_dimensions) * pdf_environment_selection();
+        mis = power_heuristic(last_bsdf_pdf_inv * env_pdf);
+    }
+    return max(vec3(0.0), env_color * mis);
+}
+
+#endif
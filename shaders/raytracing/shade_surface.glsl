@@ -0,0 +1,129 @@
+#ifndef SHADE_SURFACE_GLSL
+#define SHADE_SURFACE_GLSL
+
+#include "mesh_data.glsl"
+#include "texture_data.glsl"
+#include "material.glsl"
+#include "../common.glsl"
+#include "../random.glsl"
+#include "../push_constants.glsl"
+#include "bsdf.glsl"
+#include "lights.glsl"
+#include "output.glsl"
+#include "mis.glsl"
+
+// shading result of a single path vertex
+struct PathVertex {
+    vec3 emission;
+    // probability density of the sampled bounce
+    float bsdf_pdf;
+    // sampled bsdf weight, already divided by the pdf
+    vec3 weight;
+    // continuation ray in world space, also the origin of the light sample
+    vec3 origin;
+    vec3 direction;
+
+    // next event estimation towards a sampled light, the contribution assumes the light is visible and is zero if direct lighting is disabled
+    vec3 light_direction;
+    float light_distance;
+    vec3 light_contribution;
+};
+
+// shades the hit of a ray, the visibility of the light sample is left to the caller
+// the hit shader traces it right away, compute integrators can batch it with other shadow rays
+// last_bsdf_pdf_inv is the inverse pdf of the bounce that sampled the ray, emission it hits is weighted against next event estimation
+PathVertex shade_surface(uint instance, uint primitive, vec2 barycentrics, mat4x3 transform_world, vec3 ray_origin, vec3 ray_direction, float hit_distance, uint depth, uint pixel_index, uint seed, uint sample_index, float last_bsdf_pdf_inv) {
+    PushConstants constants = get_push_constants();
+
+    vec3 position = ray_origin + ray_direction * hit_distance;
+    vec3 normal = normalize(transform_world * vec4(get_vertex_normal(instance, primitive, barycentrics), 0.0));
+    vec3 tangent = normalize(transform_world * vec4(get_vertex_tangent(instance, primitive, barycentrics), 0.0));
+    vec2 uv = get_vertex_uv(instance, primitive, barycentrics);
+
+    vec3 bitangent = cross(normal, tangent);
+    // ensure perpendicular tangent
+    tangent = cross(bitangent, normal);
+
+    mat3 to_world_space = mat3(tangent, normal, bitangent);
+
+    //normal mapping
+    if (has_texture(instance, TEXTURE_OFFSET_NORMAL)) {
+        vec3 normal_tex = sample_texture(instance, uv, TEXTURE_OFFSET_NORMAL).rbg;
+        vec3 sampled_normal = (normal_tex - 0.5) * 2.0;
+        normal = (to_world_space * sampled_normal);
+        tangent = cross(bitangent, normal);
+        to_world_space = mat3(tangent, normal, bitangent);
+    }
+
+    mat3 to_shading_space = transpose(to_world_space);
+
+    // pointing away from surface
+    vec3 ray_out = normalize(to_shading_space * -ray_direction);
+
+    // material properties
+    Material material = get_material(instance, uv);
+
+    if (depth == 1 && constants.sample_count == 1) {
+        write_output(OUTPUT_BUFFER_INSTANCE, pixel_index, vec4(encode_uint(instance), 0.0));
+        write_output(OUTPUT_BUFFER_INSTANCE_COLOR, pixel_index, vec4(random_vec3(instance), 1.0));
+
+        write_output(OUTPUT_BUFFER_ALBEDO, pixel_index, vec4(material.base_color, 1.0));
+        write_output(OUTPUT_BUFFER_NORMAL, pixel_index, vec4(normal, 0.0));
+        write_output(OUTPUT_BUFFER_ROUGHNESS, pixel_index, vec4(material.roughness));
+        write_output(OUTPUT_BUFFER_POSITION, pixel_index, vec4(position, 1.0));
+        write_output(OUTPUT_BUFFER_UV, pixel_index, vec4(uv, 0.0, 0.0));
+    }
+
+    PathVertex vertex;
+    vertex.emission = max(vec3(0.0), material.emission);
+    if (vertex.emission != vec3(0.0)) {
+        mat3 transform = mat3(transform_world);
+        vec3 v0, v1, v2;
+        get_vertices(instance, primitive, v0, v1, v2);
+        vec3 face_normal = get_face_normal(transform * v0, transform * v1, transform * v2, transform);
+
+        // single sided emitters are dark from behind, matching the cones of the light tree
+        if (!is_double_sided(instance) && dot(face_normal, ray_direction) >= 0.0) vertex.emission = vec3(0.0);
+
+        // next event estimation could have sampled this point from the previous vertex, camera rays and paths without it keep the full emission
+        uint both_lighting = ENABLE_DIRECT_LIGHTING | ENABLE_INDIRECT_LIGHTING;
+        if (depth > 1 && (constants.flags & both_lighting) == both_lighting) {
+            float light_pdf = pdf_area_light(instance, primitive, face_normal, ray_origin, ray_direction, hit_distance);
+            vertex.emission *= power_heuristic(light_pdf * last_bsdf_pdf_inv);
+        }
+    }
+
+    Sampler bsdf_rng = sampler_init(seed, sample_index, sampler_bounce_dimension(depth, SAMPLER_BOUNCE_OFFSET_BSDF));
+    BSDFSample bsdf_sample = sample_bsdf(ray_out, material, bsdf_rng);
+
+    vertex.weight = max(vec3(0.0), bsdf_sample.weight);
+    vertex.bsdf_pdf = bsdf_sample.pdf;
+    vertex.origin = position;
+    vertex.direction = to_world_space * bsdf_sample.direction;
+
+    vertex.light_direction = vec3(0.0, 1.0, 0.0);
+    vertex.light_distance = 0.0;
+    vertex.light_contribution = vec3(0.0);
+
+    // direct lighting
+    if ((constants.flags & ENABLE_DIRECT_LIGHTING) == ENABLE_DIRECT_LIGHTING) {
+        Sampler light_rng = sampler_init(seed, sample_index, sampler_bounce_dimension(depth, SAMPLER_BOUNCE_OFFSET_LIGHT));
+        LightSample light_sample = sample_direct_light(light_rng, position);
+
+        // pointing away from surface
+        vec3 light_dir_local = normalize(to_shading_space * light_sample.direction);
+
+        BSDFEvaluation bsdf_eval = eval_bsdf(ray_out, light_dir_local, material);
+
+        float mis = 1.0;
+        if ((constants.flags & ENABLE_INDIRECT_LIGHTING) == ENABLE_INDIRECT_LIGHTING) mis = power_heuristic(bsdf_eval.pdf / light_sample.pdf);
+
+        vertex.light_direction = light_sample.direction;
+        vertex.light_distance = light_sample.distance;
+        vertex.light_contribution = mis * max(vec3(0.0), bsdf_eval.color * light_sample.weight);
+    }
+
+    return vertex;
+}
+
+#endif
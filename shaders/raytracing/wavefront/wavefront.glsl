@@ -0,0 +1,86 @@
+#ifndef WAVEFRONT_GLSL
+#define WAVEFRONT_GLSL
+
+#include "../interface.glsl"
+#include "../../structs.glsl"
+#include "../../common.glsl"
+#include "../../random.glsl"
+#include "../../push_constants.glsl"
+#include "../material.glsl"
+
+layout(std430, set = DESCRIPTOR_SET_CUSTOM, binding = DESCRIPTOR_BINDING_WAVEFRONT_STATE) buffer WavefrontStateBuffer {WavefrontState state;} wavefront;
+// indexed by pixel
+layout(std430, set = DESCRIPTOR_SET_CUSTOM, binding = DESCRIPTOR_BINDING_WAVEFRONT_PATHS) buffer WavefrontPathBuffer {WavefrontPath paths[];} path_buffer;
+layout(std430, set = DESCRIPTOR_SET_CUSTOM, binding = DESCRIPTOR_BINDING_WAVEFRONT_RAYS) buffer WavefrontRayBuffer {WavefrontRay rays[];} ray_buffers[2];
+// indexed like the rays of the current queue
+layout(std430, set = DESCRIPTOR_SET_CUSTOM, binding = DESCRIPTOR_BINDING_WAVEFRONT_HITS) buffer WavefrontHitBuffer {WavefrontHit hits[];} hit_buffer;
+layout(std430, set = DESCRIPTOR_SET_CUSTOM, binding = DESCRIPTOR_BINDING_WAVEFRONT_SHADOW_RAYS) buffer WavefrontShadowRayBuffer {WavefrontShadowRay rays[];} shadow_ray_buffer;
+// hit count and first slot of each bin, followed by the ray indices ordered by bin
+layout(std430, set = DESCRIPTOR_SET_CUSTOM, binding = DESCRIPTOR_BINDING_WAVEFRONT_SORT) buffer WavefrontSortBuffer {uint bin_counts[WAVEFRONT_SORT_BINS]; uint bin_offsets[WAVEFRONT_SORT_BINS]; uint ray_indices[];} sort_buffer;
+// coherence key and index of the rays of the current queue, radix sort passes alternate between both buffers
+layout(std430, set = DESCRIPTOR_SET_CUSTOM, binding = DESCRIPTOR_BINDING_WAVEFRONT_RAY_SORT) buffer WavefrontRaySortBuffer {uvec2 entries[];} ray_sort_buffers[2];
+// key count of every digit, followed by the count (after the scan the first slot) of every digit in every group, ordered by digit
+layout(std430, set = DESCRIPTOR_SET_CUSTOM, binding = DESCRIPTOR_BINDING_WAVEFRONT_RAY_SORT_HISTOGRAMS) buffer WavefrontRaySortHistogramBuffer {uint digit_counts[WAVEFRONT_RADIX_DIGITS]; uint group_offsets[];} ray_sort_histograms;
+
+// rays of the current bounce are read from one queue while continuation rays are appended to the other
+uint current_ray_queue() {
+    return wavefront.state.depth % 2;
+}
+
+uint next_ray_queue() {
+    return (wavefront.state.depth + 1) % 2;
+}
+
+// every append that starts a new group grows the indirect dispatch of the queue
+void append_ray(WavefrontRay ray) {
+    uint queue = next_ray_queue();
+    uint slot = atomicAdd(wavefront.state.ray_queues[queue].count, 1);
+    if (slot % WAVEFRONT_GROUP_SIZE == 0) atomicAdd(wavefront.state.ray_queues[queue].groups_x, 1);
+    ray_buffers[queue].rays[slot] = ray;
+}
+
+void append_shadow_ray(WavefrontShadowRay shadow_ray) {
+    uint slot = atomicAdd(wavefront.state.shadow_queue.count, 1);
+    if (slot % WAVEFRONT_GROUP_SIZE == 0) atomicAdd(wavefront.state.shadow_queue.groups_x, 1);
+    shadow_ray_buffer.rays[slot] = shadow_ray;
+}
+
+// hits of a material share code paths and textures, also across instances
+uint get_sort_bin(uint instance) {
+    if (instance == NULL_INSTANCE) return WAVEFRONT_SORT_BINS - 1;
+    return get_material_parameters(instance).material_index % (WAVEFRONT_SORT_BINS - 1);
+}
+
+// rays starting close to each other in similar directions traverse the same nodes of the acceleration structure
+uint get_coherence_key(WavefrontRay ray) {
+    WavefrontState state = wavefront.state;
+    uint cells = 1 << WAVEFRONT_COHERENCE_CELL_BITS;
+    uvec3 cell = uvec3(clamp((ray.origin - state.scene_bounds_min.xyz) / state.scene_bounds_size.xyz, 0.0, 1.0) * (cells - 1) + 0.5);
+
+    // interleaved cell coordinates keep neighbouring cells close in key order
+    uint morton = 0;
+    for (uint bit = 0; bit < WAVEFRONT_COHERENCE_CELL_BITS; bit++) {
+        morton |= (((cell.x >> bit) & 1) << (3 * bit)) | (((cell.y >> bit) & 1) << (3 * bit + 1)) | (((cell.z >> bit) & 1) << (3 * bit + 2));
+    }
+
+    uint octant = (ray.direction.x < 0.0 ? 1 : 0) | (ray.direction.y < 0.0 ? 2 : 0) | (ray.direction.z < 0.0 ? 4 : 0);
+    return (octant << (3 * WAVEFRONT_COHERENCE_CELL_BITS)) | morton;
+}
+
+uint get_radix_digit(uint key) {
+    return (key >> (wavefront.state.radix_pass * WAVEFRONT_RADIX_BITS)) & (WAVEFRONT_RADIX_DIGITS - 1);
+}
+
+// same sample sequence as the ray generation shader of the raytracing pipeline
+uint get_path_seed(uint pixel_index) {
+    uint width = get_push_constants().render_extent.x;
+    uvec2 image_pixel = pixel_to_image(uvec2(pixel_index % width, pixel_index / width));
+    return hash_combine(image_pixel.x, hash_combine(image_pixel.y, hash_init));
+}
+
+uint get_path_sample_index() {
+    PushConstants constants = get_push_constants();
+    return (constants.sample_count - 1) * constants.frame_samples + wavefront.state.frame_sample;
+}
+
+#endif
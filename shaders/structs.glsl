@@ -3,6 +3,7 @@
 
 #define NULL_INSTANCE 999999
 #define NULL_TEXTURE_INDEX 10000
+#define NULL_LIGHT_NODE 0xFFFFFFFF
 
 struct Light {
     uint uint_data[4];
@@ -10,7 +11,7 @@ struct Light {
 };
 
 struct PushConstantsPacked {
-    uint stride_lcount_fsample_depth;
+    uint stride_rr_fsample_depth;
     uint sample_count;
     uint frame;
     uint flags;
@@ -20,6 +21,13 @@ struct PushConstantsPacked {
     uint r_ext_xy;
     float exposure;
     //
+    // offset of the rendered region (tile) in the full image and full image extent
+    uint tile_offset_xy;
+    uint img_ext_xy;
+    // adaptive sampling: per-pixel relative error threshold and minimum accumulated frames
+    float adaptive_threshold;
+    uint adaptive_min_frames;
+    //
     mat4 inv_camera_matrix;
     vec4 camera_position;
 };
@@ -28,23 +36,57 @@ struct PushConstants {
     uint sbt_stride;
     uint frame;
     uint sample_count;
-    uint light_count;
+    // bounces before russian roulette starts, 0 disables it
+    uint russian_roulette_depth;
     //
     uint max_depth;
     uint flags;
     uint frame_samples;
     float exposure;
     //
-    uvec2 environment_cdf_dimensions;
-    uvec2 pad;
+    uvec2 environment_distribution_dimensions;
+    float adaptive_threshold;
+    uint adaptive_min_frames;
     //
     uvec2 swapchain_extent;
     uvec2 render_extent;
     //
+    uvec2 tile_offset;
+    uvec2 image_extent;
+    //
     mat4 inv_camera_matrix;
     vec4 camera_position;
 };
 
+// node of the light hierarchy, the children of interior nodes are stored next to each other
+struct LightTreeNode {
+    vec3 bounds_min;
+    // estimated emitted intensity, power / distance^2 approximates the irradiance at a shading point
+    float power;
+    vec3 bounds_max;
+    // first child for interior nodes, light index for leaves
+    uint index;
+    // emitting normals lie within theta_o of the axis, emission spreads by theta_e around each normal
+    vec3 axis;
+    float theta_o;
+    float theta_e;
+    // LIGHT_TREE_NODE_*
+    uint flags;
+    // parent of nodes below the root of the hierarchy
+    uint parent;
+    uint pad_0;
+};
+
+// entry of an alias table for constant time sampling of discrete distributions
+struct AliasTableEntry {
+    // probability of keeping this index, the alias is taken otherwise
+    float threshold;
+    uint alias;
+    // normalized probability of selecting this index
+    float pdf;
+    uint pad_0;
+};
+
 struct LightSample {
     vec3 direction;
     float distance;
@@ -64,6 +106,13 @@ struct MaterialParameters {
     float metallic;
     float transmissive;
     float ior;
+    // MATERIAL_FLAG_*
+    uint flags;
+    // light tree leaf of the area light of the instance, NULL_LIGHT_NODE if it does not emit
+    uint light_node;
+    // scene wide index of the material the instance was loaded with, shared by all instances using it
+    uint material_index;
+    uint pad_0;
 };
 
 struct Material {
@@ -84,4 +133,80 @@ struct Reservoir {
     float weight;
 };
 
+// work queue of the wavefront integrator, the header doubles as indirect dispatch command
+struct WavefrontQueue {
+    uint groups_x;
+    uint groups_y;
+    uint groups_z;
+    uint count;
+};
+
+struct WavefrontState {
+    // rays of the current bounce and continuation rays, the queues swap roles every bounce
+    WavefrontQueue ray_queues[2];
+    WavefrontQueue shadow_queue;
+    uint depth;
+    // index of the sample within the current frame
+    uint frame_sample;
+    // shade hits ordered by material
+    uint sorted;
+    // trace rays of the current queue ordered by coherence key
+    uint coherent;
+    // digit of the coherence key sorted by the current radix sort pass
+    uint radix_pass;
+    uint pad_0;
+    uint pad_1;
+    uint pad_2;
+    // origin cells of the coherence key subdivide the scene bounds
+    vec4 scene_bounds_min;
+    vec4 scene_bounds_size;
+    // rays traced by extend during the frame, not reset between samples
+    uint extended_rays;
+    uint pad_3;
+    uint pad_4;
+    uint pad_5;
+};
+
+// path state of a pixel during a frame
+struct WavefrontPath {
+    // product of the bsdf weights along the path
+    vec3 throughput;
+    uint depth;
+    // summed over all samples of the frame
+    vec3 radiance;
+    uint pad_0;
+};
+
+struct WavefrontRay {
+    vec3 origin;
+    uint pixel_index;
+    vec3 direction;
+    // inverse pdf of the bounce that sampled the direction
+    float last_bsdf_pdf_inv;
+};
+
+// closest intersection of a wavefront ray, misses have a NULL_INSTANCE
+struct WavefrontHit {
+    // rows of the object to world transform
+    vec4 object_to_world[3];
+    vec2 barycentrics;
+    uint instance;
+    uint primitive;
+    float distance;
+    uint pad_0;
+    uint pad_1;
+    uint pad_2;
+};
+
+// light sample waiting for its visibility test
+struct WavefrontShadowRay {
+    vec3 origin;
+    uint pixel_index;
+    vec3 direction;
+    float distance;
+    // weighted by path throughput and mis, added to the path radiance if the light is visible
+    vec3 contribution;
+    uint pad_0;
+};
+
 #endif
\ No newline at end of file
@@ -0,0 +1,50 @@
+#include "alias_table.h"
+
+#include <algorithm>
+
+std::vector<Shaders::AliasTableEntry> build_alias_table(const std::vector<float>& weights) {
+    size_t count = weights.size();
+    std::vector<Shaders::AliasTableEntry> entries(count);
+    if (count == 0) return entries;
+
+    double weight_sum = 0.0;
+    for (float weight : weights) weight_sum += std::max(weight, 0.0f);
+
+    // probabilities scaled so that the average entry holds exactly one
+    std::vector<double> scaled(count);
+    for (size_t i = 0; i < count; i++) {
+        double probability = weight_sum > 0.0 ? std::max(weights[i], 0.0f) / weight_sum : 1.0 / count;
+        entries[i].pdf = (float)probability;
+        entries[i].alias = (uint32_t)i;
+        entries[i].pad_0 = 0;
+        scaled[i] = probability * count;
+    }
+
+    std::vector<uint32_t> small, large;
+    for (uint32_t i = 0; i < count; i++) {
+        if (scaled[i] < 1.0) small.push_back(i);
+        else large.push_back(i);
+    }
+
+    // each underfull entry is topped up by an overfull one
+    while (!small.empty() && !large.empty()) {
+        uint32_t underfull = small.back();
+        small.pop_back();
+        uint32_t overfull = large.back();
+
+        entries[underfull].threshold = (float)scaled[underfull];
+        entries[underfull].alias = overfull;
+
+        scaled[overfull] -= 1.0 - scaled[underfull];
+        if (scaled[overfull] < 1.0) {
+            large.pop_back();
+            small.push_back(overfull);
+        }
+    }
+
+    // remaining entries are full up to rounding errors
+    for (uint32_t i : large) entries[i].threshold = 1.0f;
+    for (uint32_t i : small) entries[i].threshold = 1.0f;
+
+    return entries;
+}
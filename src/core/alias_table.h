@@ -0,0 +1,9 @@
+#pragma once
+
+#include "shader_interface.h"
+
+#include <vector>
+
+// builds an alias table for constant time sampling proportional to the weights
+// entries store the normalized probability of their own index, all zero weights fall back to a uniform distribution
+std::vector<Shaders::AliasTableEntry> build_alias_table(const std::vector<float>& weights);
@@ -48,6 +48,8 @@ VkDeviceAddress Buffer::get_device_address() {
 void Buffer::free()
 {
     if (buffer_handle != VK_NULL_HANDLE) vkDestroyBuffer(device_handle, buffer_handle, nullptr);
-    if (shared) return;
-    if (device_memory != VK_NULL_HANDLE) vkFreeMemory(device_handle, device_memory, nullptr);
+    buffer_handle = VK_NULL_HANDLE;
+    // shared memory is owned by another buffer
+    if (!shared && device_memory != VK_NULL_HANDLE) vkFreeMemory(device_handle, device_memory, nullptr);
+    device_memory = VK_NULL_HANDLE;
 }
\ No newline at end of file
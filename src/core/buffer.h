@@ -3,13 +3,13 @@
 
 struct Buffer
 {
-    size_t buffer_size;
+    size_t buffer_size = 0;
     VkBuffer buffer_handle = VK_NULL_HANDLE;
-    VkDevice device_handle;
-    VkDeviceMemory device_memory;
-    VkDeviceSize device_memory_offset;
+    VkDevice device_handle = VK_NULL_HANDLE;
+    VkDeviceMemory device_memory = VK_NULL_HANDLE;
+    VkDeviceSize device_memory_offset = 0;
 
-    bool shared;
+    bool shared = false;
 
     void map(void* data);
     void unmap();
@@ -19,5 +19,6 @@ struct Buffer
 
     VkDeviceAddress get_device_address();
 
+    // resets the handles, freeing twice is safe
     void free();
 };
\ No newline at end of file
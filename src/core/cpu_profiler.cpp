@@ -0,0 +1,109 @@
+#include "cpu_profiler.h"
+
+#include <chrono>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include <fstream>
+#include <iostream>
+#include <unordered_map>
+
+namespace {
+    struct TraceEvent {
+        const char* name;
+        std::string detail;
+        uint64_t start_us;
+        uint64_t duration_us;
+        uint32_t thread_index;
+    };
+
+    // guards against unbounded growth when tracing long interactive sessions
+    const size_t max_trace_events = 1 << 22;
+
+    std::mutex trace_mutex;
+    std::vector<TraceEvent> trace_events;
+    std::unordered_map<std::thread::id, uint32_t> thread_indices;
+
+    const auto trace_start = std::chrono::steady_clock::now();
+
+    uint64_t now_us() {
+        return std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - trace_start).count();
+    }
+
+    void write_escaped(std::ofstream& out, const std::string& text) {
+        for (char c : text) {
+            if (c == '"' || c == '\\') out << '\\' << c;
+            else if (c == '\n') out << "\\n";
+            else out << c;
+        }
+    }
+}
+
+std::atomic<bool> profiler::enabled{false};
+
+void profiler::enable() {
+    enabled.store(true, std::memory_order_relaxed);
+}
+
+void profiler::disable() {
+    enabled.store(false, std::memory_order_relaxed);
+}
+
+bool profiler::is_enabled() {
+    return enabled.load(std::memory_order_relaxed);
+}
+
+profiler::Zone::Zone(const char* name) : name(name) {
+    if (!enabled.load(std::memory_order_relaxed)) return;
+    active = true;
+    start_us = now_us();
+}
+
+profiler::Zone::Zone(const char* name, const std::string& detail) : Zone(name) {
+    if (active) this->detail = detail;
+}
+
+profiler::Zone::~Zone() {
+    if (!active) return;
+    uint64_t end_us = now_us();
+
+    std::lock_guard<std::mutex> lock(trace_mutex);
+    if (trace_events.size() >= max_trace_events) return;
+
+    auto thread_id = std::this_thread::get_id();
+    if (thread_indices.find(thread_id) == thread_indices.end()) {
+        uint32_t index = thread_indices.size();
+        thread_indices[thread_id] = index;
+    }
+
+    trace_events.push_back(TraceEvent{name, std::move(detail), start_us, end_us - start_us, thread_indices[thread_id]});
+}
+
+void profiler::save_trace(std::string path) {
+    std::lock_guard<std::mutex> lock(trace_mutex);
+
+    std::ofstream out(path);
+    if (!out.is_open()) {
+        std::cout << "could not open " << path << " for writing cpu trace" << std::endl;
+        return;
+    }
+
+    out << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n";
+    for (size_t i = 0; i < trace_events.size(); i++) {
+        const auto& event = trace_events[i];
+        out << "{\"name\":\"";
+        write_escaped(out, event.name);
+        out << "\",\"ph\":\"X\",\"pid\":0,\"tid\":" << event.thread_index << ",\"ts\":" << event.start_us << ",\"dur\":" << event.duration_us;
+        if (!event.detail.empty()) {
+            out << ",\"args\":{\"detail\":\"";
+            write_escaped(out, event.detail);
+            out << "\"}";
+        }
+        out << "}";
+        if (i + 1 < trace_events.size()) out << ",";
+        out << "\n";
+    }
+    out << "]}\n";
+
+    std::cout << "saved " << trace_events.size() << " trace events to " << path << std::endl;
+}
@@ -0,0 +1,45 @@
+#pragma once
+
+#include <string>
+#include <atomic>
+#include <cstdint>
+
+// lightweight scoped cpu zones, written as chrome / perfetto trace json
+// when profiling is disabled a zone only costs a single flag check
+namespace profiler {
+    extern std::atomic<bool> enabled;
+
+    void enable();
+    void disable();
+    bool is_enabled();
+
+    // writes all recorded zones as chrome trace json (load in chrome://tracing or ui.perfetto.dev)
+    void save_trace(std::string path);
+
+    struct Zone {
+        const char* name;
+        std::string detail;
+        uint64_t start_us = 0;
+        bool active = false;
+
+        Zone(const char* name);
+        // detail is only stored while profiling is enabled
+        Zone(const char* name, const std::string& detail);
+        ~Zone();
+    };
+}
+
+#define PROFILER_CONCAT_INNER(a, b) a##b
+#define PROFILER_CONCAT(a, b) PROFILER_CONCAT_INNER(a, b)
+
+#ifndef DISABLE_CPU_PROFILER
+// name has to be a string literal or otherwise outlive the trace
+#define PROFILE_ZONE(name) profiler::Zone PROFILER_CONCAT(profiler_zone_, __LINE__)(name)
+// single declaration, so the zone always covers the enclosing scope
+#define PROFILE_ZONE_DETAIL(name, detail) profiler::Zone PROFILER_CONCAT(profiler_zone_, __LINE__)(name, detail)
+#define PROFILE_FUNCTION() PROFILE_ZONE(__func__)
+#else
+#define PROFILE_ZONE(name)
+#define PROFILE_ZONE_DETAIL(name, detail)
+#define PROFILE_FUNCTION()
+#endif
@@ -6,6 +6,12 @@
 #include "memory.h"
 
 #include <algorithm>
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+#include <iomanip>
+#include <cstring>
+#include <vector>
 
 uint32_t Device::find_memory_type(uint32_t type_filter, VkMemoryPropertyFlags properties) {
     uint32_t memtype_index = 0;
@@ -101,7 +107,7 @@ void Device::end_single_use_command_buffer(VkCommandBuffer cmd_buffer) {
     vkFreeCommandBuffers(vulkan_device, command_pool, 1, &cmd_buffer);
 }
 
-Buffer Device::create_buffer(VkBufferCreateInfo *create_info, size_t alignment, bool exportable)
+Buffer Device::create_buffer(VkBufferCreateInfo *create_info, size_t alignment, bool exportable, VkMemoryPropertyFlags memory_properties)
 {
     Buffer result{};
     result.device_handle = vulkan_device;
@@ -128,11 +134,15 @@ Buffer Device::create_buffer(VkBufferCreateInfo *create_info, size_t alignment,
 
     // find correct memory type
     uint32_t type_filter = mem_requirements.memoryTypeBits;
-    VkMemoryPropertyFlags properties = VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT;
+    VkMemoryPropertyFlags properties = memory_properties;
 
     if (exportable) properties = 0;
 
     uint32_t memtype_index = find_memory_type(type_filter, properties);
+    // cached host memory is optional, fall back to any host visible type
+    if (memtype_index == this->memory_properties.memoryTypeCount && (properties & VK_MEMORY_PROPERTY_HOST_CACHED_BIT)) {
+        memtype_index = find_memory_type(type_filter, properties & ~VK_MEMORY_PROPERTY_HOST_CACHED_BIT);
+    }
 
     VkMemoryAllocateInfo alloc_info{};
     alloc_info.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
@@ -165,13 +175,13 @@ Buffer Device::create_buffer(VkBufferCreateInfo *create_info, size_t alignment,
     return result;
 }
 
-Buffer Device::create_buffer(VkDeviceSize size, VkBufferUsageFlags usage, bool exportable) {
+Buffer Device::create_buffer(VkDeviceSize size, VkBufferUsageFlags usage, bool exportable, VkMemoryPropertyFlags memory_properties) {
     VkBufferCreateInfo create_info {};
     create_info.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
     create_info.size = size;
     create_info.usage = usage;
 
-    return create_buffer(&create_info, 4, exportable);
+    return create_buffer(&create_info, 4, exportable, memory_properties);
 }
 
 Image Device::create_image(uint32_t width, uint32_t height, VkImageUsageFlags usage, uint32_t array_layers, VkMemoryPropertyFlags memory_properties, VkFormat format, VkFilter filter, VkSamplerAddressMode uv_mode) {
@@ -261,4 +271,128 @@ Image Device::create_image(uint32_t width, uint32_t height, VkImageUsageFlags us
     }
 
     return result;
-}
\ No newline at end of file
+}
+// cache file is keyed by the pipeline cache uuid, so driver updates and different gpus do not share data
+static std::filesystem::path pipeline_cache_path(std::string directory, const VkPhysicalDeviceProperties& properties) {
+    std::stringstream name;
+    name << std::hex << std::setfill('0');
+    for (uint32_t i = 0; i < VK_UUID_SIZE; i++) name << std::setw(2) << (uint32_t)properties.pipelineCacheUUID[i];
+    name << ".bin";
+    return std::filesystem::path(directory) / name.str();
+}
+
+void Device::create_pipeline_cache() {
+    std::filesystem::path path = pipeline_cache_path(pipeline_cache_directory, physical_device_properties);
+
+    std::vector<char> data;
+    std::ifstream file(path, std::ios::binary | std::ios::ate);
+    if (file.is_open()) {
+        data.resize((size_t)file.tellg());
+        file.seekg(0);
+        file.read(data.data(), data.size());
+        if (!file) data.clear();
+    }
+
+    // the driver ignores mismatching data, but a stale or truncated file is rejected here to avoid relying on that
+    if (!data.empty()) {
+        VkPipelineCacheHeaderVersionOne header{};
+        bool valid = data.size() >= sizeof(header);
+        if (valid) {
+            std::memcpy(&header, data.data(), sizeof(header));
+            valid = header.headerSize >= sizeof(header) &&
+                header.headerVersion == VK_PIPELINE_CACHE_HEADER_VERSION_ONE &&
+                header.vendorID == physical_device_properties.vendorID &&
+                header.deviceID == physical_device_properties.deviceID &&
+                std::memcmp(header.pipelineCacheUUID, physical_device_properties.pipelineCacheUUID, VK_UUID_SIZE) == 0;
+        }
+        if (!valid) {
+            std::cout << "discarding incompatible pipeline cache " << path << std::endl;
+            data.clear();
+        }
+    }
+
+    VkPipelineCacheCreateInfo cache_create_info{};
+    cache_create_info.sType = VK_STRUCTURE_TYPE_PIPELINE_CACHE_CREATE_INFO;
+    cache_create_info.initialDataSize = data.size();
+    cache_create_info.pInitialData = data.empty() ? nullptr : data.data();
+
+    if (vkCreatePipelineCache(vulkan_device, &cache_create_info, nullptr, &pipeline_cache) != VK_SUCCESS) {
+        // retry without initial data in case the driver rejected it
+        cache_create_info.initialDataSize = 0;
+        cache_create_info.pInitialData = nullptr;
+        if (vkCreatePipelineCache(vulkan_device, &cache_create_info, nullptr, &pipeline_cache) != VK_SUCCESS) {
+            throw std::runtime_error("error creating pipeline cache");
+        }
+    }
+
+    if (!data.empty()) std::cout << "loaded pipeline cache " << path << " (" << data.size() << " bytes)" << std::endl;
+}
+
+void Device::save_pipeline_cache() {
+    if (pipeline_cache == VK_NULL_HANDLE) return;
+
+    size_t size = 0;
+    if (vkGetPipelineCacheData(vulkan_device, pipeline_cache, &size, nullptr) != VK_SUCCESS || size == 0) return;
+    std::vector<char> data(size);
+    if (vkGetPipelineCacheData(vulkan_device, pipeline_cache, &size, data.data()) != VK_SUCCESS) return;
+
+    std::filesystem::path path = pipeline_cache_path(pipeline_cache_directory, physical_device_properties);
+    std::error_code error;
+    std::filesystem::create_directories(path.parent_path(), error);
+
+    // written to a temporary file first so an interrupted write never leaves a truncated cache
+    std::filesystem::path temp_path = path;
+    temp_path += ".tmp";
+    {
+        std::ofstream file(temp_path, std::ios::binary | std::ios::trunc);
+        if (!file.is_open()) {
+            std::cout << "could not open " << temp_path << " for writing pipeline cache" << std::endl;
+            return;
+        }
+        file.write(data.data(), size);
+    }
+    std::filesystem::rename(temp_path, path, error);
+    if (error) {
+        std::cout << "could not write pipeline cache " << path << ": " << error.message() << std::endl;
+        return;
+    }
+
+    std::cout << "saved pipeline cache " << path << " (" << size << " bytes)" << std::endl;
+}
+
+void Device::free_pipeline_cache() {
+    if (pipeline_cache != VK_NULL_HANDLE) {
+        vkDestroyPipelineCache(vulkan_device, pipeline_cache, nullptr);
+        pipeline_cache = VK_NULL_HANDLE;
+    }
+}
+
+VkDescriptorSetLayout Device::get_descriptor_set_layout(const std::vector<VkDescriptorSetLayoutBinding>& bindings) {
+    std::stringstream key;
+    for (auto& binding : bindings) {
+        key << binding.binding << ":" << binding.descriptorType << ":" << binding.descriptorCount << ":" << binding.stageFlags << ";";
+    }
+
+    auto cached_layout = descriptor_set_layouts.find(key.str());
+    if (cached_layout != descriptor_set_layouts.end()) return cached_layout->second;
+
+    VkDescriptorSetLayoutCreateInfo layout_info{};
+    layout_info.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+    layout_info.bindingCount = (uint32_t)bindings.size();
+    layout_info.pBindings = bindings.data();
+
+    VkDescriptorSetLayout layout;
+    if (vkCreateDescriptorSetLayout(vulkan_device, &layout_info, nullptr, &layout) != VK_SUCCESS) {
+        throw std::runtime_error("error creating descriptor set layout");
+    }
+
+    descriptor_set_layouts[key.str()] = layout;
+    return layout;
+}
+
+void Device::free_descriptor_set_layouts() {
+    for (auto& layout : descriptor_set_layouts) {
+        vkDestroyDescriptorSetLayout(vulkan_device, layout.second, nullptr);
+    }
+    descriptor_set_layouts.clear();
+}
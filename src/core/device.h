@@ -5,8 +5,11 @@
 
 #include "image.h"
 
+#include "gpu_profiler.h"
+
 #include <unordered_map>
 #include <string>
+#include <vector>
 
 struct RaytracingPipelineBuilder;
 
@@ -32,11 +35,27 @@ struct Device
 
     uint32_t graphics_queue_family_index;
 
+    VkPhysicalDeviceProperties physical_device_properties{};
     VkPhysicalDeviceMemoryProperties memory_properties{};
     VkPhysicalDeviceRayTracingPipelinePropertiesKHR ray_tracing_pipeline_properties{};
     VkPhysicalDeviceAccelerationStructurePropertiesKHR acceleration_structure_properties{};
 
-    
+    // nanoseconds per timestamp tick and valid timestamp bits of the graphics queue
+    float timestamp_period = 1.0f;
+    uint32_t timestamp_valid_bits = 0;
+
+    // vkCmdTraceRaysIndirectKHR is available (adaptive sampling)
+    bool trace_rays_indirect_supported = false;
+
+    GPUProfiler gpu_profiler;
+
+    // shared by all ray tracing and compute pipelines, persisted across runs in pipeline_cache_directory
+    VkPipelineCache pipeline_cache = VK_NULL_HANDLE;
+    std::string pipeline_cache_directory = "./pipeline_cache";
+
+    // descriptor set layouts of compute shaders, keyed by their bindings
+    std::unordered_map<std::string, VkDescriptorSetLayout> descriptor_set_layouts;
+
 
     uint32_t shared_allocation_size = 1048576;
     // maps memory type index to shared memory
@@ -46,12 +65,21 @@ struct Device
     VkCommandBuffer begin_single_use_command_buffer();
     void end_single_use_command_buffer(VkCommandBuffer cmd_buffer);
 
-    Buffer create_buffer(VkBufferCreateInfo *create_info, size_t alignment = 4, bool exportable = false);
-    Buffer create_buffer(VkDeviceSize size, VkBufferUsageFlags usage = VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, bool exportable = false);
+    Buffer create_buffer(VkBufferCreateInfo *create_info, size_t alignment = 4, bool exportable = false, VkMemoryPropertyFlags memory_properties = VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT);
+    Buffer create_buffer(VkDeviceSize size, VkBufferUsageFlags usage = VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, bool exportable = false, VkMemoryPropertyFlags memory_properties = VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT);
     Image create_image(uint32_t width, uint32_t height, VkImageUsageFlags usage, uint32_t array_layers = 1, VkMemoryPropertyFlags memory_properties = VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, VkFormat format = VK_FORMAT_UNDEFINED, VkFilter filter = VK_FILTER_LINEAR, VkSamplerAddressMode uv_mode = VK_SAMPLER_ADDRESS_MODE_REPEAT);
 
     void allocate_memory(VkMemoryAllocateInfo alloc_info, size_t alignment, VkDeviceMemory* memory, VkDeviceSize* offset, bool* allocation_is_shared);
 
+    // loads cached pipeline data matching this device if available
+    void create_pipeline_cache();
+    void save_pipeline_cache();
+    void free_pipeline_cache();
+
+    // returns a layout shared by all callers with identical bindings
+    VkDescriptorSetLayout get_descriptor_set_layout(const std::vector<VkDescriptorSetLayoutBinding>& bindings);
+    void free_descriptor_set_layouts();
+
     RaytracingPipelineBuilder create_raytracing_pipeline_builder();
     ProcessingPipelineBuilder create_processing_pipeline_builder();
 
@@ -64,6 +92,7 @@ struct Device
     PFN_vkCreateRayTracingPipelinesKHR vkCreateRayTracingPipelinesKHR;
     PFN_vkGetRayTracingShaderGroupHandlesKHR vkGetRayTracingShaderGroupHandlesKHR;
     PFN_vkCmdTraceRaysKHR vkCmdTraceRaysKHR;
+    PFN_vkCmdTraceRaysIndirectKHR vkCmdTraceRaysIndirectKHR;
     PFN_vkGetMemoryWin32HandleKHR vkGetMemoryWin32HandleKHR;
 
     uint32_t find_memory_type(uint32_t type_filter, VkMemoryPropertyFlags properties);
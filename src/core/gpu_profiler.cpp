@@ -0,0 +1,209 @@
+#include "gpu_profiler.h"
+
+#include "device.h"
+
+#include <iostream>
+#include <fstream>
+#include <stdexcept>
+#include <algorithm>
+
+void GPUProfiler::init(Device* device) {
+    this->device = device;
+
+    if (device->timestamp_valid_bits == 0) {
+        std::cout << "timestamp queries not supported by graphics queue, gpu profiling disabled" << std::endl;
+        enabled = false;
+        return;
+    }
+
+    timestamp_period = device->timestamp_period;
+    if (device->timestamp_valid_bits < 64) timestamp_mask = (1ull << device->timestamp_valid_bits) - 1;
+
+    create_query_pool();
+}
+
+void GPUProfiler::create_query_pool() {
+    VkQueryPoolCreateInfo query_pool_info{};
+    query_pool_info.sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO;
+    query_pool_info.queryType = VK_QUERY_TYPE_TIMESTAMP;
+    query_pool_info.queryCount = max_queries;
+
+    if (vkCreateQueryPool(device->vulkan_device, &query_pool_info, nullptr, &query_pool) != VK_SUCCESS) {
+        throw std::runtime_error("error creating timestamp query pool");
+    }
+}
+
+void GPUProfiler::reserve_queries(uint32_t count) {
+    if (query_pool == VK_NULL_HANDLE || base_queries + count <= max_queries) return;
+
+    vkDestroyQueryPool(device->vulkan_device, query_pool, nullptr);
+    max_queries = base_queries + count;
+    create_query_pool();
+}
+
+void GPUProfiler::cmd_begin_frame(VkCommandBuffer command_buffer) {
+    frame_active = enabled && query_pool != VK_NULL_HANDLE;
+    if (!frame_active) return;
+
+    vkCmdResetQueryPool(command_buffer, query_pool, 0, max_queries);
+    query_count = 0;
+    dropped_zones = 0;
+    frame_zones.clear();
+    open_zones.clear();
+}
+
+void GPUProfiler::cmd_begin_zone(VkCommandBuffer command_buffer, std::string name, VkPipelineStageFlagBits stage) {
+    if (!frame_active) return;
+
+    FrameZone zone;
+    zone.name = name;
+    zone.depth = open_zones.size();
+    zone.query_begin = UINT32_MAX;
+    zone.query_end = UINT32_MAX;
+
+    // out of queries, zone is kept on the stack to keep begin/end pairs balanced
+    if (query_count + 2 <= max_queries) {
+        zone.query_begin = query_count++;
+        vkCmdWriteTimestamp(command_buffer, stage, query_pool, zone.query_begin);
+    } else {
+        dropped_zones++;
+    }
+
+    open_zones.push_back(frame_zones.size());
+    frame_zones.push_back(zone);
+}
+
+void GPUProfiler::cmd_end_zone(VkCommandBuffer command_buffer, VkPipelineStageFlagBits stage) {
+    if (!frame_active || open_zones.empty()) return;
+
+    FrameZone& zone = frame_zones[open_zones.back()];
+    open_zones.pop_back();
+
+    if (zone.query_begin != UINT32_MAX) {
+        zone.query_end = query_count++;
+        vkCmdWriteTimestamp(command_buffer, stage, query_pool, zone.query_end);
+    }
+}
+
+void GPUProfiler::end_frame() {
+    if (!frame_active) return;
+    frame_active = false;
+
+    if (!open_zones.empty()) {
+        std::cout << "gpu profiler: " << open_zones.size() << " zones were not closed" << std::endl;
+    }
+
+    // timings of the frame are incomplete, totals of repeated zones are too low
+    if (dropped_zones > 0 && last_dropped_zones == 0) {
+        std::cout << "gpu profiler: " << dropped_zones << " zones were dropped, " << max_queries << " queries are not enough for a frame" << std::endl;
+    }
+    last_dropped_zones = dropped_zones;
+
+    if (query_count == 0) return;
+
+    std::vector<uint64_t> timestamps(query_count);
+    VkResult result = vkGetQueryPoolResults(device->vulkan_device, query_pool, 0, query_count, sizeof(uint64_t) * query_count, timestamps.data(), sizeof(uint64_t), VK_QUERY_RESULT_64_BIT | VK_QUERY_RESULT_WAIT_BIT);
+    if (result != VK_SUCCESS) return;
+
+    std::vector<double> frame_timings(zone_statistics.size(), -1.0);
+    double frame_time = 0.0;
+
+    for (auto& zone : frame_zones) {
+        if (zone.query_begin == UINT32_MAX || zone.query_end == UINT32_MAX) continue;
+
+        uint64_t ticks = (timestamps[zone.query_end] - timestamps[zone.query_begin]) & timestamp_mask;
+        // timestamp period is given in nanoseconds per tick
+        double milliseconds = ticks * (double)timestamp_period * 1e-6;
+        if (zone.depth == 0) frame_time += milliseconds;
+
+        if (zone_indices.find(zone.name) == zone_indices.end()) {
+            zone_indices[zone.name] = zone_statistics.size();
+            GPUProfilerZoneStatistics statistics;
+            statistics.name = zone.name;
+            statistics.depth = zone.depth;
+            zone_statistics.push_back(statistics);
+            frame_timings.push_back(-1.0);
+        }
+
+        // zones recorded multiple times per frame are accumulated
+        size_t index = zone_indices[zone.name];
+        if (frame_timings[index] < 0.0) frame_timings[index] = 0.0;
+        frame_timings[index] += milliseconds;
+    }
+
+    last_frame_time = frame_time;
+
+    std::vector<double> sorted;
+    for (size_t i = 0; i < zone_statistics.size(); i++) {
+        if (frame_timings[i] < 0.0) continue;
+
+        auto& statistics = zone_statistics[i];
+        statistics.last = frame_timings[i];
+        statistics.history.push_back(frame_timings[i]);
+        while (statistics.history.size() > history_length) statistics.history.pop_front();
+
+        sorted.assign(statistics.history.begin(), statistics.history.end());
+        std::sort(sorted.begin(), sorted.end());
+
+        double sum = 0.0;
+        for (double t : sorted) sum += t;
+        statistics.average = sum / sorted.size();
+        statistics.percentile_50 = sorted[(size_t)((sorted.size() - 1) * 0.50)];
+        statistics.percentile_95 = sorted[(size_t)((sorted.size() - 1) * 0.95)];
+        statistics.percentile_99 = sorted[(size_t)((sorted.size() - 1) * 0.99)];
+    }
+
+    if (recording) {
+        recorded_frame_indices.push_back(frame_index);
+        recorded_frames.push_back(frame_timings);
+    }
+
+    frame_index++;
+}
+
+std::vector<GPUProfilerZoneStatistics>& GPUProfiler::get_statistics() {
+    return zone_statistics;
+}
+
+size_t GPUProfiler::get_recorded_frame_count() {
+    return recorded_frames.size();
+}
+
+void GPUProfiler::clear_recording() {
+    recorded_frame_indices.clear();
+    recorded_frames.clear();
+}
+
+void GPUProfiler::save_csv(std::string path) {
+    std::ofstream file(path);
+    if (!file.is_open()) {
+        std::cout << "could not open " << path << " for writing gpu timings" << std::endl;
+        return;
+    }
+
+    file << "frame";
+    for (auto& statistics : zone_statistics) {
+        file << "," << statistics.name;
+    }
+    file << "\n";
+
+    for (size_t frame = 0; frame < recorded_frames.size(); frame++) {
+        file << recorded_frame_indices[frame];
+        auto& timings = recorded_frames[frame];
+        for (size_t i = 0; i < zone_statistics.size(); i++) {
+            file << ",";
+            // zones first seen after this frame or not recorded in this frame are left empty
+            if (i < timings.size() && timings[i] >= 0.0) file << timings[i];
+        }
+        file << "\n";
+    }
+
+    std::cout << "saved " << recorded_frames.size() << " frames of gpu timings to " << path << std::endl;
+}
+
+void GPUProfiler::free() {
+    if (query_pool != VK_NULL_HANDLE) {
+        vkDestroyQueryPool(device->vulkan_device, query_pool, nullptr);
+        query_pool = VK_NULL_HANDLE;
+    }
+}
@@ -0,0 +1,94 @@
+#pragma once
+#include "vulkan.h"
+
+#include <string>
+#include <vector>
+#include <deque>
+#include <unordered_map>
+
+struct Device;
+
+// timing statistics of a single named zone, in milliseconds
+struct GPUProfilerZoneStatistics {
+    std::string name;
+    uint32_t depth = 0;
+
+    // rolling window of the most recent timings
+    std::deque<double> history;
+
+    double last = 0.0;
+    double average = 0.0;
+    double percentile_50 = 0.0;
+    double percentile_95 = 0.0;
+    double percentile_99 = 0.0;
+};
+
+// measures gpu execution time of command buffer regions using timestamp queries
+// zones are recorded with cmd_begin_zone / cmd_end_zone between cmd_begin_frame and end_frame
+struct GPUProfiler {
+    Device* device = nullptr;
+    VkQueryPool query_pool = VK_NULL_HANDLE;
+
+    // queries for the zones of a frame, grown by reserve_queries
+    uint32_t max_queries = 1024;
+    // budget for the zones outside of integrators that record zones per bounce and frame sample
+    uint32_t base_queries = 1024;
+    uint32_t history_length = 256;
+
+    bool enabled = true;
+    // store per-frame timings for csv export
+    bool recording = false;
+
+    // summed time of all top level zones of the last completed frame, in milliseconds
+    double last_frame_time = 0.0;
+    // zones of the last completed frame that were not timed because the queries ran out
+    uint32_t last_dropped_zones = 0;
+
+    void init(Device* device);
+    // grows the pool to base_queries plus the given count, call outside of a frame while no submitted frame uses the pool
+    void reserve_queries(uint32_t count);
+
+    // resets the query pool, has to be recorded outside of a render pass
+    void cmd_begin_frame(VkCommandBuffer command_buffer);
+    void cmd_begin_zone(VkCommandBuffer command_buffer, std::string name, VkPipelineStageFlagBits stage = VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT);
+    void cmd_end_zone(VkCommandBuffer command_buffer, VkPipelineStageFlagBits stage = VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT);
+
+    // reads back query results, call after the frame's command buffers have completed
+    void end_frame();
+
+    std::vector<GPUProfilerZoneStatistics>& get_statistics();
+    size_t get_recorded_frame_count();
+
+    void clear_recording();
+    void save_csv(std::string path);
+
+    void free();
+
+    private:
+    struct FrameZone {
+        std::string name;
+        uint32_t depth;
+        uint32_t query_begin, query_end;
+    };
+
+    bool frame_active = false;
+    uint32_t query_count = 0;
+    uint32_t dropped_zones = 0;
+    uint64_t frame_index = 0;
+
+    float timestamp_period = 1.0f;
+    uint64_t timestamp_mask = ~0ull;
+
+    std::vector<FrameZone> frame_zones;
+    std::vector<size_t> open_zones;
+
+    // maps zone name -> index into zone_statistics
+    std::unordered_map<std::string, size_t> zone_indices;
+    std::vector<GPUProfilerZoneStatistics> zone_statistics;
+
+    // recorded timings per frame, indexed like zone_statistics (negative if zone was not recorded)
+    std::vector<uint64_t> recorded_frame_indices;
+    std::vector<std::vector<double>> recorded_frames;
+
+    void create_query_pool();
+};
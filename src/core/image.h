@@ -14,7 +14,7 @@ struct Image
 {
     Device* device;
 
-    uint32_t width, height;
+    uint32_t width = 0, height = 0;
     VkImageLayout layout;
     VkFormat format;
     VkAccessFlags access;
@@ -0,0 +1,247 @@
+#include "light_tree.h"
+
+#include "alias_table.h"
+
+#include "glm/gtc/constants.hpp"
+
+#include <algorithm>
+#include <array>
+#include <cfloat>
+#include <cmath>
+
+LightBounds LightBounds::point(glm::vec3 position, float power) {
+    LightBounds bounds;
+    bounds.bounds_min = position;
+    bounds.bounds_max = position;
+    bounds.theta_o = glm::pi<float>();
+    bounds.theta_e = glm::half_pi<float>();
+    bounds.power = power;
+    return bounds;
+}
+
+LightBounds LightBounds::directional(float power) {
+    LightBounds bounds;
+    bounds.theta_o = glm::pi<float>();
+    bounds.theta_e = glm::half_pi<float>();
+    bounds.power = power;
+    bounds.infinite = true;
+    return bounds;
+}
+
+// smallest cone containing both cones of normals
+static void merge_cones(glm::vec3 axis_a, float theta_a, glm::vec3 axis_b, float theta_b, glm::vec3& axis, float& theta_o) {
+    if (theta_a < theta_b) {
+        std::swap(axis_a, axis_b);
+        std::swap(theta_a, theta_b);
+    }
+
+    float theta_d = std::acos(std::clamp(glm::dot(axis_a, axis_b), -1.0f, 1.0f));
+    if (std::min(theta_d + theta_b, glm::pi<float>()) <= theta_a) {
+        axis = axis_a;
+        theta_o = theta_a;
+        return;
+    }
+
+    theta_o = 0.5f * (theta_a + theta_d + theta_b);
+    glm::vec3 orthogonal = axis_b - axis_a * glm::dot(axis_a, axis_b);
+    if (theta_o >= glm::pi<float>() || glm::length(orthogonal) < 1e-6f) {
+        axis = axis_a;
+        theta_o = glm::pi<float>();
+        return;
+    }
+
+    // rotate towards the other cone until both fit
+    float theta_r = theta_o - theta_a;
+    axis = glm::normalize(axis_a * std::cos(theta_r) + glm::normalize(orthogonal) * std::sin(theta_r));
+}
+
+void LightBounds::merge_cone(glm::vec3 other_axis, float other_theta_o) {
+    merge_cones(axis, theta_o, other_axis, other_theta_o, axis, theta_o);
+}
+
+static LightBounds merge_bounds(const LightBounds& a, const LightBounds& b) {
+    if (a.power <= 0.0f) return b;
+    if (b.power <= 0.0f) return a;
+
+    LightBounds result;
+    result.bounds_min = glm::min(a.bounds_min, b.bounds_min);
+    result.bounds_max = glm::max(a.bounds_max, b.bounds_max);
+    merge_cones(a.axis, a.theta_o, b.axis, b.theta_o, result.axis, result.theta_o);
+    result.theta_e = std::max(a.theta_e, b.theta_e);
+    result.power = a.power + b.power;
+    return result;
+}
+
+static float get_surface_area(const LightBounds& bounds) {
+    glm::vec3 extent = bounds.bounds_max - bounds.bounds_min;
+    return 2.0f * (extent.x * extent.y + extent.y * extent.z + extent.z * extent.x);
+}
+
+// solid angle measure of the orientation bounds
+static float get_orientation_measure(const LightBounds& bounds) {
+    float theta_w = std::min(bounds.theta_o + bounds.theta_e, glm::pi<float>());
+    return 2.0f * glm::pi<float>() * (1.0f - std::cos(bounds.theta_o)) + glm::half_pi<float>() * (2.0f * theta_w * std::sin(bounds.theta_o) - std::cos(bounds.theta_o - 2.0f * theta_w) - 2.0f * bounds.theta_o * std::sin(bounds.theta_o) + std::cos(bounds.theta_o));
+}
+
+static float get_split_cost(const LightBounds& bounds) {
+    if (bounds.power <= 0.0f) return 0.0f;
+    // points still need a nonzero measure to be compared
+    return bounds.power * get_orientation_measure(bounds) * std::max(get_surface_area(bounds), 1e-6f);
+}
+
+namespace {
+    struct LightTreeBuilder {
+        const std::vector<LightBounds>& lights;
+        std::vector<uint32_t> light_indices;
+        std::vector<Shaders::LightTreeNode>& nodes;
+        std::vector<uint32_t>& leaf_nodes;
+
+        void write_node(uint32_t node_index, const LightBounds& bounds, uint32_t index, uint32_t flags, uint32_t parent) {
+            Shaders::LightTreeNode& node = nodes[node_index];
+            node.bounds_min = bounds.bounds_min;
+            node.bounds_max = bounds.bounds_max;
+            node.power = bounds.power;
+            node.axis = bounds.axis;
+            node.theta_o = bounds.theta_o;
+            node.theta_e = bounds.theta_e;
+            node.index = index;
+            node.flags = flags;
+            node.parent = parent;
+            node.pad_0 = 0;
+            if (flags & LIGHT_TREE_NODE_LEAF) leaf_nodes[index] = node_index;
+        }
+
+        // partitions the lights with the lowest surface area orientation heuristic over bucketed centroids, returns the split position
+        size_t split(size_t begin, size_t end, const LightBounds& bounds) {
+            glm::vec3 centroid_min(FLT_MAX), centroid_max(-FLT_MAX);
+            for (size_t i = begin; i < end; i++) {
+                const LightBounds& light = lights[light_indices[i]];
+                glm::vec3 centroid = 0.5f * (light.bounds_min + light.bounds_max);
+                centroid_min = glm::min(centroid_min, centroid);
+                centroid_max = glm::max(centroid_max, centroid);
+            }
+            glm::vec3 centroid_extent = centroid_max - centroid_min;
+            float max_extent = std::max(centroid_extent.x, std::max(centroid_extent.y, centroid_extent.z));
+
+            const int bucket_count = 12;
+            float best_cost = FLT_MAX;
+            int best_axis = -1;
+            int best_bucket = 0;
+
+            auto get_bucket = [&](uint32_t light_index, int axis) {
+                const LightBounds& light = lights[light_index];
+                float centroid = 0.5f * (light.bounds_min[axis] + light.bounds_max[axis]);
+                int bucket = (int)(bucket_count * (centroid - centroid_min[axis]) / centroid_extent[axis]);
+                return std::clamp(bucket, 0, bucket_count - 1);
+            };
+
+            for (int axis = 0; axis < 3; axis++) {
+                if (centroid_extent[axis] <= 0.0f) continue;
+
+                std::array<LightBounds, bucket_count> buckets{};
+                for (size_t i = begin; i < end; i++) {
+                    int bucket = get_bucket(light_indices[i], axis);
+                    buckets[bucket] = merge_bounds(buckets[bucket], lights[light_indices[i]]);
+                }
+
+                // thin nodes are penalized to avoid slicing along short axes
+                float regularization = max_extent / centroid_extent[axis];
+                for (int split_bucket = 1; split_bucket < bucket_count; split_bucket++) {
+                    LightBounds left, right;
+                    for (int b = 0; b < split_bucket; b++) left = merge_bounds(left, buckets[b]);
+                    for (int b = split_bucket; b < bucket_count; b++) right = merge_bounds(right, buckets[b]);
+
+                    float cost = regularization * (get_split_cost(left) + get_split_cost(right));
+                    if (cost < best_cost) {
+                        best_cost = cost;
+                        best_axis = axis;
+                        best_bucket = split_bucket;
+                    }
+                }
+            }
+
+            size_t mid = begin;
+            if (best_axis >= 0) {
+                auto split_end = std::partition(light_indices.begin() + begin, light_indices.begin() + end, [&](uint32_t light_index) {
+                    return get_bucket(light_index, best_axis) < best_bucket;
+                });
+                mid = split_end - light_indices.begin();
+            }
+
+            // coincident centroids or a one sided split fall back to halving the range
+            if (mid == begin || mid == end) mid = begin + (end - begin) / 2;
+            return mid;
+        }
+
+        void build_node(uint32_t node_index, uint32_t parent, size_t begin, size_t end) {
+            LightBounds bounds;
+            for (size_t i = begin; i < end; i++) bounds = merge_bounds(bounds, lights[light_indices[i]]);
+
+            if (end - begin == 1) {
+                write_node(node_index, lights[light_indices[begin]], light_indices[begin], LIGHT_TREE_NODE_LEAF, parent);
+                return;
+            }
+
+            size_t mid = split(begin, end, bounds);
+
+            uint32_t first_child = nodes.size();
+            nodes.resize(nodes.size() + 2);
+            write_node(node_index, bounds, first_child, 0, parent);
+
+            build_node(first_child, node_index, begin, mid);
+            build_node(first_child + 1, node_index, mid, end);
+        }
+    };
+}
+
+void LightTree::build(const std::vector<LightBounds>& lights, float environment_irradiance, float scene_radius) {
+    nodes.clear();
+    infinite_light_count = 0;
+    light_count = lights.size();
+
+    std::vector<uint32_t> local_lights;
+    for (uint32_t i = 0; i < lights.size(); i++) {
+        if (lights[i].infinite) infinite_light_count++;
+        else local_lights.push_back(i);
+    }
+
+    leaf_nodes.assign(lights.size(), NULL_LIGHT_NODE);
+    LightTreeBuilder builder{lights, local_lights, nodes, leaf_nodes};
+    nodes.resize(infinite_light_count);
+    uint32_t infinite_index = 0;
+    for (uint32_t i = 0; i < lights.size(); i++) {
+        if (!lights[i].infinite) continue;
+        builder.write_node(infinite_index, lights[i], i, LIGHT_TREE_NODE_LEAF | LIGHT_TREE_NODE_INFINITE, infinite_index);
+        infinite_index++;
+    }
+
+    // the root is its own parent
+    if (!local_lights.empty()) {
+        nodes.resize(infinite_light_count + 1);
+        builder.build_node(infinite_light_count, infinite_light_count, 0, local_lights.size());
+    }
+
+    // directional lights already store their irradiance, local lights are assumed to be seen from the scene radius
+    std::vector<float> weights;
+    weights.push_back(environment_irradiance);
+    for (uint32_t i = 0; i < infinite_light_count; i++) weights.push_back(nodes[i].power);
+    if (!local_lights.empty()) weights.push_back(nodes[infinite_light_count].power / std::max(scene_radius * scene_radius, 1e-6f));
+    top_level_distribution = build_alias_table(weights);
+}
+
+size_t LightTree::get_buffer_size(size_t light_count) {
+    // a binary tree over n leaves has 2n - 1 nodes, at least one node is allocated
+    return sizeof(glm::uvec4) + sizeof(Shaders::LightTreeNode) * std::max<size_t>(2 * light_count, 1);
+}
+
+size_t LightTree::get_top_level_distribution_size(const std::vector<LightBounds>& lights) {
+    size_t infinite_lights = std::count_if(lights.begin(), lights.end(), [](const LightBounds& light) { return light.infinite; });
+    return 1 + infinite_lights + (infinite_lights < lights.size() ? 1 : 0);
+}
+
+void LightTree::upload(Buffer& buffer, Buffer& distribution_buffer) {
+    glm::uvec4 header(infinite_light_count, (uint32_t)nodes.size(), light_count, (uint32_t)top_level_distribution.size());
+    buffer.set_data(&header, 0, sizeof(header));
+    if (!nodes.empty()) buffer.set_data(nodes.data(), sizeof(header), sizeof(Shaders::LightTreeNode) * nodes.size());
+    distribution_buffer.set_data(top_level_distribution.data(), 0, sizeof(Shaders::AliasTableEntry) * top_level_distribution.size());
+}
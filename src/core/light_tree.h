@@ -0,0 +1,50 @@
+#pragma once
+
+#include "core/buffer.h"
+#include "shader_interface.h"
+
+#include <vector>
+
+// conservative bounds of the emission of a light or a group of lights
+struct LightBounds {
+    glm::vec3 bounds_min = glm::vec3(0.0f);
+    glm::vec3 bounds_max = glm::vec3(0.0f);
+    // emitting normals lie within theta_o of the axis, emission spreads by theta_e around each normal
+    glm::vec3 axis = glm::vec3(0.0f, 0.0f, 1.0f);
+    float theta_o = 0.0f;
+    float theta_e = 0.0f;
+    // estimated emitted intensity, power / distance^2 approximates the irradiance at a shading point
+    float power = 0.0f;
+    // emitting surface of area lights in world space
+    float area = 0.0f;
+    // directional lights are not bounded in space
+    bool infinite = false;
+
+    static LightBounds point(glm::vec3 position, float power);
+    static LightBounds directional(float power);
+    // grows the cone of emitting normals to contain the other cone
+    void merge_cone(glm::vec3 other_axis, float other_theta_o);
+};
+
+// binary hierarchy over all lights for importance sampling by estimated contribution
+// directional lights are stored first, followed by the root of the hierarchy over all other lights
+struct LightTree {
+    std::vector<Shaders::LightTreeNode> nodes;
+    uint32_t infinite_light_count = 0;
+    uint32_t light_count = 0;
+    // leaf node of each light
+    std::vector<uint32_t> leaf_nodes;
+
+    // alias table choosing between the environment, each directional light and the root of the hierarchy by emitted power
+    std::vector<Shaders::AliasTableEntry> top_level_distribution;
+
+    // lights are referenced by their index in the given vector
+    // the environment and the hierarchy are weighted by the irradiance they cause at the scale of the scene
+    void build(const std::vector<LightBounds>& lights, float environment_irradiance, float scene_radius);
+
+    // gpu buffer layout: uvec4 header (infinite light count, node count, light count, top level distribution size) followed by the nodes
+    static size_t get_buffer_size(size_t light_count);
+    // the top level distribution is the first table of the light distribution buffer
+    static size_t get_top_level_distribution_size(const std::vector<LightBounds>& lights);
+    void upload(Buffer& buffer, Buffer& distribution_buffer);
+};
@@ -0,0 +1,35 @@
+#include "quality_controller.h"
+
+#include <algorithm>
+#include <cmath>
+
+bool QualityController::update(double frame_time, float& render_scale, int& frame_samples) {
+    if (!enabled || frame_time <= 0.0) return false;
+
+    if (frames_since_change == 0) filtered_frame_time = frame_time;
+    else filtered_frame_time = filtered_frame_time * 0.8 + frame_time * 0.2;
+
+    frames_since_change++;
+    if (frames_since_change < settle_frames) return false;
+
+    double ratio = target_frame_time / filtered_frame_time;
+    bool at_lower_limit = render_scale <= min_render_scale && frame_samples <= 1;
+    bool at_upper_limit = render_scale >= max_render_scale && frame_samples >= max_frame_samples;
+    if (std::abs(ratio - 1.0) < tolerance || (ratio < 1.0 && at_lower_limit) || (ratio > 1.0 && at_upper_limit)) return false;
+
+    // resolution is raised before samples per frame and lowered after them
+    double work = render_scale * render_scale * frame_samples * ratio;
+    float new_render_scale = std::clamp((float)std::sqrt(work), min_render_scale, max_render_scale);
+    // quantized so small timing fluctuations do not reset accumulation
+    new_render_scale = std::round(new_render_scale * 64.0f) / 64.0f;
+    int new_frame_samples = std::clamp((int)(work / (new_render_scale * new_render_scale)), 1, std::max(max_frame_samples, 1));
+
+    bool render_scale_changed = new_render_scale != render_scale;
+    if (!render_scale_changed && new_frame_samples == frame_samples) return false;
+
+    render_scale = new_render_scale;
+    frame_samples = new_frame_samples;
+    frames_since_change = 0;
+
+    return render_scale_changed;
+}
@@ -0,0 +1,31 @@
+#pragma once
+
+#include <cstdint>
+
+// adjusts render scale and samples per frame to hold a target frame time
+// the cost of a frame is assumed to be proportional to render_scale^2 * frame_samples
+struct QualityController {
+    bool enabled = false;
+
+    // in milliseconds
+    float target_frame_time = 16.6f;
+
+    float min_render_scale = 0.25f;
+    float max_render_scale = 1.0f;
+    int max_frame_samples = 8;
+
+    // relative deviation from the target that is tolerated without adjusting
+    float tolerance = 0.1f;
+    // frames to wait after an adjustment until new timings are trusted
+    uint32_t settle_frames = 8;
+
+    // exponentially smoothed frame time
+    double filtered_frame_time = 0.0;
+
+    // feeds the measured frame time (ms) and adjusts the given settings
+    // returns true if the render scale changed
+    bool update(double frame_time, float& render_scale, int& frame_samples);
+
+    private:
+    uint32_t frames_since_change = 0;
+};
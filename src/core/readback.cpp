@@ -0,0 +1,157 @@
+#include "readback.h"
+
+#include "device.h"
+
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+
+void ReadbackRing::init(Device* device) {
+    this->device = device;
+    slots.resize(slot_count);
+}
+
+void ReadbackRing::request(ReadbackRegion region, ReadbackCallback callback) {
+    Request request;
+    request.region = region;
+    request.callback = callback;
+    queued_requests.push_back(request);
+}
+
+void ReadbackRing::cmd_copy(VkCommandBuffer command_buffer, Image& image, uint64_t frame) {
+    if (queued_requests.empty()) return;
+
+    // all slots are still in flight, requests wait for the next frame
+    Slot& slot = slots[next_slot];
+    if (slot.state != SlotState::Free) return;
+
+    slot.pixel_size = Image::num_channels(image.format) * Image::bytes_per_channel(image.format);
+    slot.requests.clear();
+
+    std::vector<VkBufferImageCopy> copies;
+    VkDeviceSize size = 0;
+    for (auto& request : queued_requests) {
+        // regions are clipped to the image, requests outside of it are dropped
+        ReadbackRegion& region = request.region;
+        if (region.x >= image.width || region.y >= image.height) continue;
+        region.width = std::min(region.width, image.width - region.x);
+        region.height = std::min(region.height, image.height - region.y);
+        if (region.width == 0 || region.height == 0) continue;
+
+        request.offset = size;
+        size += (VkDeviceSize)region.width * region.height * slot.pixel_size;
+        // copy offsets have to be a multiple of the texel size and 4
+        size = (size + 15) & ~(VkDeviceSize)15;
+
+        VkBufferImageCopy copy {};
+        copy.bufferOffset = request.offset;
+        copy.imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+        copy.imageSubresource.layerCount = 1;
+        copy.imageOffset = VkOffset3D{(int32_t)region.x, (int32_t)region.y, 0};
+        copy.imageExtent = VkExtent3D{region.width, region.height, 1};
+        copies.push_back(copy);
+        slot.requests.push_back(request);
+    }
+    queued_requests.clear();
+
+    if (copies.empty()) return;
+
+    reserve(slot, size);
+    vkCmdCopyImageToBuffer(command_buffer, image.image_handle, image.layout, slot.buffer.buffer_handle, (uint32_t)copies.size(), copies.data());
+    cmd_finish_slot(command_buffer, slot, frame);
+}
+
+void ReadbackRing::cmd_copy_buffer(VkCommandBuffer command_buffer, Buffer& buffer, VkDeviceSize offset, VkDeviceSize size, uint64_t frame, ReadbackCallback callback) {
+    // all slots are still in flight, the copy is skipped
+    Slot& slot = slots[next_slot];
+    if (slot.state != SlotState::Free) return;
+
+    // buffer ranges are delivered as a single row of bytes
+    Request request;
+    request.region = ReadbackRegion{0, 0, (uint32_t)size, 1};
+    request.callback = callback;
+    slot.pixel_size = 1;
+    slot.requests.clear();
+    slot.requests.push_back(request);
+
+    reserve(slot, size);
+    VkBufferCopy copy {};
+    copy.srcOffset = offset;
+    copy.dstOffset = 0;
+    copy.size = size;
+    vkCmdCopyBuffer(command_buffer, buffer.buffer_handle, slot.buffer.buffer_handle, 1, &copy);
+    cmd_finish_slot(command_buffer, slot, frame);
+}
+
+void ReadbackRing::reserve(Slot& slot, VkDeviceSize size) {
+    // staging buffers only grow, the slot is not in flight here
+    if (size <= slot.capacity) return;
+    slot.buffer.free();
+    slot.buffer = device->create_buffer(size, VK_BUFFER_USAGE_TRANSFER_DST_BIT, false, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_CACHED_BIT);
+    slot.capacity = size;
+}
+
+void ReadbackRing::cmd_finish_slot(VkCommandBuffer command_buffer, Slot& slot, uint64_t frame) {
+    VkMemoryBarrier barrier {};
+    barrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+    barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+    barrier.dstAccessMask = VK_ACCESS_HOST_READ_BIT;
+    vkCmdPipelineBarrier(command_buffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_HOST_BIT, 0, 1, &barrier, 0, nullptr, 0, nullptr);
+
+    slot.state = SlotState::Recorded;
+    slot.frame = frame;
+    next_slot = (next_slot + 1) % slot_count;
+}
+
+void ReadbackRing::complete_frame(uint64_t frame) {
+    for (auto& slot : slots) {
+        if (slot.state == SlotState::Recorded && slot.frame <= frame) slot.state = SlotState::Finished;
+    }
+}
+
+void ReadbackRing::deliver() {
+    // oldest slots first, so callbacks are invoked in request order
+    for (uint32_t i = 0; i < slot_count; i++) {
+        Slot& slot = slots[(next_slot + i) % slot_count];
+        if (slot.state != SlotState::Finished) continue;
+
+        uint8_t* data;
+        if (vkMapMemory(slot.buffer.device_handle, slot.buffer.device_memory, 0, VK_WHOLE_SIZE, 0, (void**)&data) != VK_SUCCESS) {
+            throw std::runtime_error("error mapping readback buffer memory");
+        }
+
+        // cached memory is not necessarily coherent
+        VkMappedMemoryRange range {};
+        range.sType = VK_STRUCTURE_TYPE_MAPPED_MEMORY_RANGE;
+        range.memory = slot.buffer.device_memory;
+        range.offset = 0;
+        range.size = VK_WHOLE_SIZE;
+        vkInvalidateMappedMemoryRanges(slot.buffer.device_handle, 1, &range);
+
+        std::vector<ReadbackResult> results(slot.requests.size());
+        for (size_t r = 0; r < slot.requests.size(); r++) {
+            Request& request = slot.requests[r];
+            results[r].region = request.region;
+            results[r].pixel_size = slot.pixel_size;
+            results[r].data.resize((size_t)request.region.width * request.region.height * slot.pixel_size);
+            memcpy(results[r].data.data(), data + slot.buffer.device_memory_offset + request.offset, results[r].data.size());
+        }
+        vkUnmapMemory(slot.buffer.device_handle, slot.buffer.device_memory);
+
+        // callbacks can issue new requests
+        std::vector<Request> requests = std::move(slot.requests);
+        slot.requests.clear();
+        slot.state = SlotState::Free;
+        for (size_t r = 0; r < requests.size(); r++) {
+            if (requests[r].callback) requests[r].callback(results[r]);
+        }
+    }
+}
+
+void ReadbackRing::free() {
+    for (auto& slot : slots) {
+        slot.buffer.free();
+        slot = Slot();
+    }
+    queued_requests.clear();
+}
@@ -0,0 +1,80 @@
+#pragma once
+#include "vulkan.h"
+
+#include "buffer.h"
+#include "image.h"
+
+#include <vector>
+#include <functional>
+
+struct Device;
+
+// image region in pixels
+struct ReadbackRegion {
+    uint32_t x = 0, y = 0;
+    uint32_t width = 1, height = 1;
+};
+
+struct ReadbackResult {
+    ReadbackRegion region;
+    // bytes per pixel of the source image
+    uint32_t pixel_size;
+    // tightly packed rows of the region
+    std::vector<uint8_t> data;
+};
+
+using ReadbackCallback = std::function<void(ReadbackResult& result)>;
+
+// asynchronous image and buffer readback through a ring of host cached staging buffers
+// requests are copied in a later frame and delivered through their callback once that frame has completed,
+// reading back never waits on the gpu
+struct ReadbackRing {
+    Device* device = nullptr;
+
+    // frames that can have copies in flight, requests are delayed while all slots are in use
+    uint32_t slot_count = 3;
+
+    void init(Device* device);
+
+    void request(ReadbackRegion region, ReadbackCallback callback);
+
+    // records copies of all queued requests, image has to be in VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL
+    void cmd_copy(VkCommandBuffer command_buffer, Image& image, uint64_t frame);
+    // records a copy of a buffer range into its own slot, delivered like an image request, buffer needs VK_BUFFER_USAGE_TRANSFER_SRC_BIT
+    void cmd_copy_buffer(VkCommandBuffer command_buffer, Buffer& buffer, VkDeviceSize offset, VkDeviceSize size, uint64_t frame, ReadbackCallback callback);
+    // marks copies recorded up to frame as finished, call after the frame's fence has signaled
+    void complete_frame(uint64_t frame);
+    // invokes callbacks of finished copies
+    void deliver();
+
+    void free();
+
+    private:
+    struct Request {
+        ReadbackRegion region;
+        ReadbackCallback callback;
+        VkDeviceSize offset = 0;
+    };
+
+    enum class SlotState {
+        Free,
+        Recorded,
+        Finished
+    };
+
+    struct Slot {
+        Buffer buffer{};
+        VkDeviceSize capacity = 0;
+        SlotState state = SlotState::Free;
+        uint64_t frame = 0;
+        uint32_t pixel_size = 0;
+        std::vector<Request> requests;
+    };
+
+    void reserve(Slot& slot, VkDeviceSize size);
+    void cmd_finish_slot(VkCommandBuffer command_buffer, Slot& slot, uint64_t frame);
+
+    std::vector<Request> queued_requests;
+    std::vector<Slot> slots;
+    uint32_t next_slot = 0;
+};
@@ -1,4 +1,10 @@
+#include "exr_export.h"
+
 #include <iostream>
+#include <cstring>
+#include <algorithm>
+
+#include "glm/gtc/packing.hpp"
 
 #define TINYEXR_USE_MINIZ 0
 #define TINYEXR_USE_STB_ZLIB 1
@@ -67,4 +73,127 @@ void save_exr_image(const char* path, void* data, uint32_t width, uint32_t heigh
     free(header.channels);
     free(header.pixel_types);
     free(header.requested_pixel_types);
-}
\ No newline at end of file
+}
+
+#pragma region tiled exr writer
+// little endian helpers for the OpenEXR file layout
+static void write_bytes(std::ofstream& file, const void* data, size_t size) {
+    file.write((const char*)data, size);
+}
+
+static void write_int(std::ofstream& file, int32_t value) {
+    write_bytes(file, &value, sizeof(int32_t));
+}
+
+static void write_attribute(std::ofstream& file, const char* name, const char* type, const void* data, int32_t size) {
+    write_bytes(file, name, strlen(name) + 1);
+    write_bytes(file, type, strlen(type) + 1);
+    write_int(file, size);
+    write_bytes(file, data, size);
+}
+
+bool ExrTileWriter::open(const char* path, uint32_t width, uint32_t height, uint32_t tile_size) {
+    this->width = width;
+    this->height = height;
+    this->tile_size = tile_size;
+    tiles_x = (width + tile_size - 1) / tile_size;
+    tiles_y = (height + tile_size - 1) / tile_size;
+
+    file.open(path, std::ios::binary | std::ios::out | std::ios::trunc);
+    if (!file.is_open()) {
+        std::cout << "could not open " << path << " for writing" << std::endl;
+        return false;
+    }
+
+    // magic number and version 2 with tiled flag
+    const uint8_t magic[] = {0x76, 0x2f, 0x31, 0x01};
+    write_bytes(file, magic, 4);
+    write_int(file, 2 | 0x200);
+
+    // channels in alphabetical order, half precision
+    std::vector<uint8_t> channel_list;
+    for (const char* channel : {"B", "G", "R"}) {
+        channel_list.push_back(channel[0]);
+        channel_list.push_back(0);
+        int32_t channel_data[4] = {1 /* HALF */, 0 /* pLinear + reserved */, 1, 1};
+        channel_list.insert(channel_list.end(), (uint8_t*)channel_data, (uint8_t*)channel_data + sizeof(channel_data));
+    }
+    channel_list.push_back(0);
+    write_attribute(file, "channels", "chlist", channel_list.data(), channel_list.size());
+
+    uint8_t compression = 0; // NO_COMPRESSION
+    write_attribute(file, "compression", "compression", &compression, 1);
+
+    int32_t window[4] = {0, 0, (int32_t)width - 1, (int32_t)height - 1};
+    write_attribute(file, "dataWindow", "box2i", window, sizeof(window));
+    write_attribute(file, "displayWindow", "box2i", window, sizeof(window));
+
+    uint8_t line_order = 0; // INCREASING_Y
+    write_attribute(file, "lineOrder", "lineOrder", &line_order, 1);
+
+    float pixel_aspect_ratio = 1.0f;
+    write_attribute(file, "pixelAspectRatio", "float", &pixel_aspect_ratio, sizeof(float));
+
+    float screen_window_center[2] = {0.0f, 0.0f};
+    write_attribute(file, "screenWindowCenter", "v2f", screen_window_center, sizeof(screen_window_center));
+
+    float screen_window_width = 1.0f;
+    write_attribute(file, "screenWindowWidth", "float", &screen_window_width, sizeof(float));
+
+    // tile size x/y and ONE_LEVEL mode
+    uint8_t tile_description[9];
+    memcpy(tile_description, &tile_size, 4);
+    memcpy(tile_description + 4, &tile_size, 4);
+    tile_description[8] = 0;
+    write_attribute(file, "tiles", "tiledesc", tile_description, sizeof(tile_description));
+
+    // end of header
+    uint8_t header_end = 0;
+    write_bytes(file, &header_end, 1);
+
+    // offset table is filled in on close
+    offset_table_position = file.tellp();
+    tile_offsets.assign(tiles_x * tiles_y, 0);
+    write_bytes(file, tile_offsets.data(), tile_offsets.size() * sizeof(uint64_t));
+
+    return true;
+}
+
+void ExrTileWriter::write_tile(uint32_t tile_x, uint32_t tile_y, void* data, uint32_t stride) {
+    if (!file.is_open()) return;
+
+    uint32_t x0 = tile_x * tile_size;
+    uint32_t y0 = tile_y * tile_size;
+    uint32_t tile_width = std::min(tile_size, width - x0);
+    uint32_t tile_height = std::min(tile_size, height - y0);
+
+    tile_offsets[tile_x + tile_y * tiles_x] = file.tellp();
+
+    // per scanline: all B values, then G, then R
+    std::vector<uint16_t> tile_data(tile_width * tile_height * 3);
+    size_t index = 0;
+    for (uint32_t y = 0; y < tile_height; y++) {
+        for (int channel = 2; channel >= 0; channel--) {
+            for (uint32_t x = 0; x < tile_width; x++) {
+                float* pixel_data = reinterpret_cast<float*>((uint8_t*)data + (x + y * tile_width) * stride);
+                tile_data[index++] = glm::packHalf1x16(pixel_data[channel]);
+            }
+        }
+    }
+
+    write_int(file, tile_x);
+    write_int(file, tile_y);
+    write_int(file, 0);
+    write_int(file, 0);
+    write_int(file, tile_data.size() * sizeof(uint16_t));
+    write_bytes(file, tile_data.data(), tile_data.size() * sizeof(uint16_t));
+}
+
+void ExrTileWriter::close() {
+    if (!file.is_open()) return;
+
+    file.seekp(offset_table_position);
+    write_bytes(file, tile_offsets.data(), tile_offsets.size() * sizeof(uint64_t));
+    file.close();
+}
+#pragma endregion
@@ -1 +1,23 @@
-void save_exr_image(const char* path, void* data, uint32_t width, uint32_t height, uint32_t stride);
\ No newline at end of file
+#pragma once
+
+#include <cstdint>
+#include <fstream>
+#include <vector>
+
+void save_exr_image(const char* path, void* data, uint32_t width, uint32_t height, uint32_t stride);
+
+// writes a single-level tiled EXR image (half RGB, uncompressed) tile by tile
+// only the tile offset table is kept in memory, tiles have to be written in increasing y order
+struct ExrTileWriter {
+    bool open(const char* path, uint32_t width, uint32_t height, uint32_t tile_size);
+    // data holds the tile's pixels tightly packed (tile width * tile height entries of stride bytes)
+    void write_tile(uint32_t tile_x, uint32_t tile_y, void* data, uint32_t stride);
+    void close();
+
+    private:
+    std::ofstream file;
+    uint32_t width = 0, height = 0, tile_size = 0;
+    uint32_t tiles_x = 0, tiles_y = 0;
+    std::streampos offset_table_position;
+    std::vector<uint64_t> tile_offsets;
+};
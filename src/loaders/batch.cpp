@@ -0,0 +1,85 @@
+#include "batch.h"
+
+#include "toml.hpp"
+#include "core/cpu_profiler.h"
+#include <iostream>
+#include <filesystem>
+#include <stdexcept>
+#include <optional>
+
+std::vector<BatchJob> loaders::load_batch_jobs(std::string path) {
+    PROFILE_ZONE_DETAIL("load_batch_jobs", path);
+    toml::table batch_table = toml::parse_file(path);
+    std::filesystem::path batch_directory = std::filesystem::absolute(std::filesystem::path(path)).parent_path();
+
+    auto jobs_array = batch_table["jobs"].as_array();
+    if (jobs_array == nullptr) throw std::runtime_error("batch file " + path + " contains no [[jobs]]");
+
+    std::vector<BatchJob> jobs;
+    for (size_t i = 0; i < jobs_array->size(); i++) {
+        auto data = batch_table["jobs"][i];
+        auto data_table = data.as_table();
+        BatchJob job;
+
+        job.name = std::string("job_") + std::to_string(i);
+        if (data_table == nullptr) throw std::runtime_error("batch job " + job.name + " is not a table");
+        job.name = data["name"].value_or(job.name);
+
+        // settings with a limited range use the same bounds as the inspector
+        auto read_int = [&](const char* key, int64_t min_value, int64_t max_value) {
+            std::optional<int64_t> value = data[key].value<int64_t>();
+            if (!value || *value < min_value || *value > max_value) {
+                throw std::runtime_error("batch job " + job.name + ": '" + key + "' has to be an integer between " + std::to_string(min_value) + " and " + std::to_string(max_value));
+            }
+            return (int)*value;
+        };
+
+        auto scene = data["scene"].as_string();
+        if (scene == nullptr) throw std::runtime_error("batch job " + job.name + " requires a 'scene' string");
+        job.scene_path = (batch_directory / scene->get()).lexically_normal().string();
+        job.output_directory = (batch_directory / data["output_dir"].value_or(job.name)).lexically_normal().string();
+
+        if (data_table->contains("outputs")) {
+            auto outputs = data["outputs"].as_array();
+            if (outputs == nullptr) throw std::runtime_error("batch job " + job.name + ": 'outputs' has to be an array of output names");
+            for (size_t o = 0; o < outputs->size(); o++) {
+                auto output = data["outputs"][o].as_string();
+                if (output == nullptr) throw std::runtime_error("batch job " + job.name + ": 'outputs' has to be an array of output names");
+                job.outputs.push_back(output->get());
+            }
+        }
+
+        job.width = data["width"].value_or(job.width);
+        job.height = data["height"].value_or(job.height);
+        job.sample_count = data["samples"].value_or(job.sample_count);
+        job.time_budget = data["time"].value_or(job.time_budget);
+        job.tile_size = data["tile_size"].value_or(job.tile_size);
+        job.adaptive_threshold = data["adaptive_threshold"].value_or(job.adaptive_threshold);
+        job.benchmark = data["benchmark"].value_or(job.benchmark);
+
+        // camera uses the same layout as the persisted camera data
+        if (data_table->contains("camera")) {
+            auto camera = data["camera"];
+            auto camera_table = camera.as_table();
+            if (camera_table == nullptr) throw std::runtime_error("batch job " + job.name + ": 'camera' has to be a table");
+            if (camera_table->contains("position")) {
+                job.camera_position = vec3(camera["position"][0].value_or(0.0), camera["position"][1].value_or(0.0), camera["position"][2].value_or(0.0));
+            }
+            if (camera_table->contains("pitch")) job.camera_pitch = camera["pitch"].value_or(0.0);
+            if (camera_table->contains("yaw")) job.camera_yaw = camera["yaw"].value_or(0.0);
+            if (camera_table->contains("fov")) job.camera_fov = camera["fov"].value_or(60.0);
+        }
+
+        if (data_table->contains("max_depth")) job.max_depth = read_int("max_depth", 1, 16);
+        if (data_table->contains("frame_samples")) job.frame_samples = read_int("frame_samples", 1, 64);
+        if (data_table->contains("russian_roulette_depth")) job.russian_roulette_depth = read_int("russian_roulette_depth", 0, 16);
+        if (data_table->contains("integrator")) job.integrator = parse_integrator(data["integrator"].value_or(std::string()));
+        if (data_table->contains("material_sorting")) job.material_sorting = data["material_sorting"].value_or(true);
+        if (data_table->contains("coherence_sorting")) job.coherence_sorting = data["coherence_sorting"].value_or(false);
+
+        jobs.push_back(job);
+    }
+
+    std::cout << "loaded " << jobs.size() << " batch jobs from " << path << std::endl;
+    return jobs;
+}
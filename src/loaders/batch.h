@@ -0,0 +1,41 @@
+#pragma once
+
+#include <vector>
+#include <string>
+#include <optional>
+#include "glm/vec3.hpp"
+#include "pipeline/raytracing/integrator.h"
+using vec3 = glm::vec3;
+
+// single render job of a batch file
+struct BatchJob {
+    std::string name;
+    // scene and output paths are resolved relative to the batch file
+    std::string scene_path;
+    std::string output_directory;
+    std::vector<std::string> outputs;
+
+    uint32_t width = 1280;
+    uint32_t height = 720;
+    uint32_t sample_count = 0;
+    double time_budget = 0.0;
+    uint32_t tile_size = 0;
+    float adaptive_threshold = 0.0f;
+    bool benchmark = false;
+
+    // values not given by the job keep the persisted camera / ui settings
+    std::optional<vec3> camera_position;
+    std::optional<float> camera_pitch;
+    std::optional<float> camera_yaw;
+    std::optional<float> camera_fov;
+    std::optional<int> max_depth;
+    std::optional<int> frame_samples;
+    std::optional<int> russian_roulette_depth;
+    std::optional<Integrator> integrator;
+    std::optional<bool> material_sorting;
+    std::optional<bool> coherence_sorting;
+};
+
+namespace loaders {
+    std::vector<BatchJob> load_batch_jobs(std::string path);
+}
@@ -4,106 +4,235 @@
 #include "core/vulkan.h"
 
 #include "core/color.h"
+#include "core/alias_table.h"
+#include "core/cpu_profiler.h"
 
 #define _USE_MATH_DEFINES
 #include <math.h>
 
 #include <iostream>
+#include <fstream>
+#include <filesystem>
+#include <algorithm>
+#include <cstring>
+#include <future>
+#include <thread>
+
+// texels of the distribution images hold the acceptance threshold, the alias and the probability of their own index
+static void write_alias_table(const std::vector<float>& weights, float* texels) {
+    auto table = build_alias_table(weights);
+    for (size_t i = 0; i < table.size(); i++) {
+        texels[i * 4 + 0] = table[i].threshold;
+        texels[i * 4 + 1] = (float)table[i].alias;
+        texels[i * 4 + 2] = table[i].pdf;
+        texels[i * 4 + 3] = 0.0f;
+    }
+}
 
-EnvironmentMap loaders::load_environment_map(Device* device, const std::string& path) {
-    EnvironmentMap result {};
-    int width = 200;
-    int height = 100;
+namespace {
+    // rgba texels of the distribution images
+    struct EnvironmentDistribution {
+        uint32_t width = 0, height = 0;
+        float average_luminance = 0.0f;
+        std::vector<float> conditional;
+        std::vector<float> marginal;
+    };
+
+    struct EnvironmentDistributionCacheHeader {
+        char magic[4] = {'E', 'N', 'V', 'D'};
+        uint32_t version = 1;
+        // the cache is discarded when the map is modified
+        uint64_t source_size = 0;
+        int64_t source_time = 0;
+        uint32_t width = 0, height = 0;
+        float average_luminance = 0.0f;
+        // fills the tail padding, aggregate initialization alone does not clear it
+        uint32_t reserved = 0;
+    };
+}
+
+// rows are split into bands that are built in parallel, each band only writes its own rows
+static EnvironmentDistribution build_distribution(const ImageData& image, uint32_t width, uint32_t height) {
+    PROFILE_ZONE("build environment distribution");
+    EnvironmentDistribution result;
+    result.width = width;
+    result.height = height;
+    result.conditional.resize((size_t)width * height * 4);
+    result.marginal.resize((size_t)height * 4);
+
+    const float* pixels = reinterpret_cast<const float*>(image.pixels);
+    std::vector<float> row_weights(height);
+
+    auto build_rows = [&](uint32_t row_begin, uint32_t row_end) {
+        std::vector<float> column_weights(width);
+        for (uint32_t v = row_begin; v < row_end; v++) {
+            // every texel averages the map pixels it covers
+            int pixel_y_begin = (int64_t)v * image.height / height;
+            int pixel_y_end = std::max(pixel_y_begin + 1, (int)((int64_t)(v + 1) * image.height / height));
+            float sin_theta = std::sin(M_PI * (v + 0.5) / height);
 
-    result.image = loaders::load_image(device, path, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT);
-    Buffer image_data_buffer = device->create_buffer(result.image.memory_requirements.size, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT);
-    // copy on separate command buffer to make sure copy is finished when processing starts
-    result.image.copy_image_to_buffer(image_data_buffer);
+            float row_weight = 0;
+            for (uint32_t u = 0; u < width; u++) {
+                int pixel_x_begin = (int64_t)u * image.width / width;
+                int pixel_x_end = std::max(pixel_x_begin + 1, (int)((int64_t)(u + 1) * image.width / width));
+
+                float texel_luminance = 0;
+                for (int pixel_y = pixel_y_begin; pixel_y < pixel_y_end; pixel_y++) {
+                    const float* pixel = pixels + ((size_t)pixel_y * image.width + pixel_x_begin) * 4;
+                    for (int pixel_x = pixel_x_begin; pixel_x < pixel_x_end; pixel_x++, pixel += 4) {
+                        texel_luminance += color::luminance(vec3(pixel[0], pixel[1], pixel[2]));
+                    }
+                }
+                texel_luminance /= (pixel_x_end - pixel_x_begin) * (pixel_y_end - pixel_y_begin);
+
+                // texels near the poles cover less solid angle
+                column_weights[u] = texel_luminance * sin_theta;
+                row_weight += column_weights[u];
+            }
 
-    // generate cdf texture from image
-    result.conditional_cdf_map = device->create_image(width, height, VK_IMAGE_USAGE_SAMPLED_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT, 1, 1, VK_FORMAT_R32_SFLOAT, VK_FILTER_NEAREST);
-    float* conditional_cdf_data = new float[width * height];
-    Buffer conditional_cdf_data_buffer = device->create_buffer(sizeof(float) * width * height, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_SRC_BIT);
+            write_alias_table(column_weights, &result.conditional[(size_t)v * width * 4]);
+            row_weights[v] = row_weight;
+        }
+    };
 
-    result.marginal_cdf_map = device->create_image(1, height, VK_IMAGE_USAGE_SAMPLED_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT, 1, 1, VK_FORMAT_R32_SFLOAT, VK_FILTER_NEAREST);
-    float* marginal_cdf_data = new float[height];
-    Buffer marginal_cdf_data_buffer = device->create_buffer(sizeof(float) * height, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_SRC_BIT);
+    uint32_t band_count = std::clamp<uint32_t>(std::thread::hardware_concurrency(), 1, height);
+    std::vector<std::future<void>> bands;
+    for (uint32_t band = 0; band < band_count; band++) {
+        bands.push_back(std::async(std::launch::async, build_rows, band * height / band_count, (band + 1) * height / band_count));
+    }
+    for (auto& band : bands) band.get();
 
-    int scan_pixels_x = std::floor(result.image.width / width);
-    int scan_pixels_y = std::floor(result.image.height / height);
+    write_alias_table(row_weights, result.marginal.data());
 
-    VkCommandBuffer cmd_buffer = device->begin_single_use_command_buffer();
-    result.image.transition_layout(cmd_buffer, VK_IMAGE_LAYOUT_GENERAL);
-    result.conditional_cdf_map.transition_layout(cmd_buffer, VK_IMAGE_LAYOUT_GENERAL);
-    result.marginal_cdf_map.transition_layout(cmd_buffer, VK_IMAGE_LAYOUT_GENERAL);
+    double luminance_sum = 0;
+    double solid_angle_sum = 0;
+    for (uint32_t v = 0; v < height; v++) {
+        luminance_sum += row_weights[v];
+        solid_angle_sum += width * std::sin(M_PI * (v + 0.5) / height);
+    }
+    result.average_luminance = luminance_sum / solid_angle_sum;
 
+    return result;
+}
 
-    float* image_data;
-    vkMapMemory(device->vulkan_device, image_data_buffer.device_memory, image_data_buffer.device_memory_offset, image_data_buffer.buffer_size, 0, (void**)&image_data);
-
-    float marginal_sum = 0;
-    for (int v = 0; v < height; v++) {
-        float marginal = 0;
-        for (int u = 0; u < width; u++) {
-            float luminance_sum = 0;
-            for (int scan_x = 0; scan_x < scan_pixels_x; scan_x++) {
-                for (int scan_y = 0; scan_y < scan_pixels_y; scan_y++) {
-                    int pixel_x = (float)u / width * result.image.width + scan_x;
-                    int pixel_y = (float)v / height * result.image.height + scan_y;
-                    
-                    int pixel_offset = (pixel_x + pixel_y * result.image.width) * 4;
-                    vec3 pixel_color = vec3(image_data[pixel_offset + 0], image_data[pixel_offset + 1], image_data[pixel_offset + 2]);
-
-                    luminance_sum += color::luminance(pixel_color);
-                }   
-            }
-            float luminance = luminance_sum / (scan_pixels_x * scan_pixels_y);
-            float sin_theta = std::sin(M_PI * (v + 0.5) / height);
-            float cdf_value = luminance * sin_theta;
-            marginal += cdf_value;
-            conditional_cdf_data[u + v * width] = marginal;
-        }
-        if (marginal < FLT_EPSILON) {
-            for (int u = 0; u < width; u++) {
-                conditional_cdf_data[u + v * width] = (float)u / (width-1);
-            }
-        } else {
-            for (int u = 0; u < width; u++) {
-                // normalize cdf along row to 1
-                conditional_cdf_data[u + v * width] /= marginal;
-            }
-        }
-        marginal_sum += marginal;
-        marginal_cdf_data[v] = marginal_sum;
+// stored next to the map, one file per distribution resolution
+static std::filesystem::path get_distribution_cache_path(const std::string& path, uint32_t width, uint32_t height) {
+    return std::filesystem::path(path + "." + std::to_string(width) + "x" + std::to_string(height) + ".envdist");
+}
+
+static EnvironmentDistributionCacheHeader get_distribution_cache_header(const std::string& path, uint32_t width, uint32_t height) {
+    // value initialized so the padding written to the cache is zero
+    EnvironmentDistributionCacheHeader header{};
+    std::error_code error;
+    header.source_size = std::filesystem::file_size(path, error);
+    header.source_time = std::filesystem::last_write_time(path, error).time_since_epoch().count();
+    header.width = width;
+    header.height = height;
+    return header;
+}
+
+static bool read_distribution_cache(const std::string& path, uint32_t width, uint32_t height, EnvironmentDistribution& distribution) {
+    std::filesystem::path cache_path = get_distribution_cache_path(path, width, height);
+    std::ifstream file(cache_path, std::ios::binary);
+    if (!file.is_open()) return false;
+
+    EnvironmentDistributionCacheHeader expected = get_distribution_cache_header(path, width, height);
+    EnvironmentDistributionCacheHeader header;
+    file.read((char*)&header, sizeof(header));
+    if (!file || std::memcmp(header.magic, expected.magic, sizeof(header.magic)) != 0 || header.version != expected.version ||
+        header.source_size != expected.source_size || header.source_time != expected.source_time || header.width != width || header.height != height) {
+        std::cout << "discarding outdated environment distribution cache " << cache_path << std::endl;
+        return false;
+    }
+
+    distribution.width = width;
+    distribution.height = height;
+    distribution.average_luminance = header.average_luminance;
+    distribution.conditional.resize((size_t)width * height * 4);
+    distribution.marginal.resize((size_t)height * 4);
+    file.read((char*)distribution.conditional.data(), sizeof(float) * distribution.conditional.size());
+    file.read((char*)distribution.marginal.data(), sizeof(float) * distribution.marginal.size());
+    if (!file) {
+        std::cout << "discarding truncated environment distribution cache " << cache_path << std::endl;
+        return false;
     }
-    if (marginal_sum < FLT_EPSILON) {
-        for (int v = 0; v < height; v++) {
-            marginal_cdf_data[v] = (float)v / (height - 1);
+
+    std::cout << "loaded environment distribution cache " << cache_path << std::endl;
+    return true;
+}
+
+static void write_distribution_cache(const std::string& path, const EnvironmentDistribution& distribution) {
+    std::filesystem::path cache_path = get_distribution_cache_path(path, distribution.width, distribution.height);
+    EnvironmentDistributionCacheHeader header = get_distribution_cache_header(path, distribution.width, distribution.height);
+    header.average_luminance = distribution.average_luminance;
+
+    // written to a temporary file first so an interrupted write never leaves a truncated cache
+    std::filesystem::path temp_path = cache_path;
+    temp_path += ".tmp";
+    {
+        std::ofstream file(temp_path, std::ios::binary | std::ios::trunc);
+        if (!file.is_open()) {
+            std::cout << "could not open " << temp_path << " for writing environment distribution cache" << std::endl;
+            return;
         }
-    } else {
-        for (int v = 0; v < height; v++) {
-            // normalize marginal pdf along column to 1
-            marginal_cdf_data[v] /= marginal_sum;
+        file.write((const char*)&header, sizeof(header));
+        file.write((const char*)distribution.conditional.data(), sizeof(float) * distribution.conditional.size());
+        file.write((const char*)distribution.marginal.data(), sizeof(float) * distribution.marginal.size());
+        if (!file) {
+            std::cout << "error writing environment distribution cache " << temp_path << std::endl;
+            return;
         }
     }
 
-    vkUnmapMemory(device->vulkan_device, image_data_buffer.device_memory);
+    std::error_code error;
+    std::filesystem::rename(temp_path, cache_path, error);
+    if (error) std::cout << "could not write environment distribution cache " << cache_path << ": " << error.message() << std::endl;
+}
+
+EnvironmentMap loaders::load_environment_map(Device* device, const std::string& path, uint32_t sampling_width) {
+    PROFILE_ZONE_DETAIL("load_environment_map", path);
+    EnvironmentMap result {};
+
+    // the distribution is built from the decoded pixels, the map is never read back from the gpu
+    ImageData image_data = loaders::decode_image(path, true);
+    result.image = loaders::upload_image(device, image_data, 0, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, VK_ACCESS_SHADER_READ_BIT);
+
+    // the distribution follows the map resolution unless a smaller width is requested, texels keep the aspect ratio of the map
+    if (sampling_width == 0) sampling_width = ENVIRONMENT_MAX_SAMPLING_WIDTH;
+    uint32_t width = std::min<uint32_t>(image_data.width, sampling_width);
+    uint32_t height = std::max<uint32_t>(1, (uint32_t)std::lround((double)width * image_data.height / image_data.width));
+
+    EnvironmentDistribution distribution;
+    if (!read_distribution_cache(path, width, height, distribution)) {
+        std::cout << "building " << width << "x" << height << " environment distribution" << std::endl;
+        distribution = build_distribution(image_data, width, height);
+        write_distribution_cache(path, distribution);
+    }
+    image_data.free();
+    result.average_luminance = distribution.average_luminance;
+
+    // alias table per row over its columns and one over all rows
+    result.conditional_distribution = device->create_image(width, height, VK_IMAGE_USAGE_SAMPLED_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT, 1, 1, VK_FORMAT_R32G32B32A32_SFLOAT, VK_FILTER_NEAREST);
+    Buffer conditional_data_buffer = device->create_buffer(sizeof(float) * distribution.conditional.size(), VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_SRC_BIT);
+    conditional_data_buffer.set_data(distribution.conditional.data());
 
-    conditional_cdf_data_buffer.set_data(conditional_cdf_data);
-    result.conditional_cdf_map.copy_buffer_to_image(cmd_buffer, conditional_cdf_data_buffer);
+    result.marginal_distribution = device->create_image(1, height, VK_IMAGE_USAGE_SAMPLED_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT, 1, 1, VK_FORMAT_R32G32B32A32_SFLOAT, VK_FILTER_NEAREST);
+    Buffer marginal_data_buffer = device->create_buffer(sizeof(float) * distribution.marginal.size(), VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_SRC_BIT);
+    marginal_data_buffer.set_data(distribution.marginal.data());
 
-    marginal_cdf_data_buffer.set_data(marginal_cdf_data);
-    result.marginal_cdf_map.copy_buffer_to_image(cmd_buffer, marginal_cdf_data_buffer);
+    VkCommandBuffer cmd_buffer = device->begin_single_use_command_buffer();
+    result.conditional_distribution.transition_layout(cmd_buffer, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL);
+    result.marginal_distribution.transition_layout(cmd_buffer, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL);
 
-    result.image.transition_layout(cmd_buffer, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, VK_ACCESS_SHADER_READ_BIT);
-    result.conditional_cdf_map.transition_layout(cmd_buffer, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, VK_ACCESS_SHADER_READ_BIT);
-    result.marginal_cdf_map.transition_layout(cmd_buffer, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, VK_ACCESS_SHADER_READ_BIT);
+    result.conditional_distribution.copy_buffer_to_image(cmd_buffer, conditional_data_buffer);
+    result.marginal_distribution.copy_buffer_to_image(cmd_buffer, marginal_data_buffer);
 
+    result.conditional_distribution.transition_layout(cmd_buffer, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, VK_ACCESS_SHADER_READ_BIT);
+    result.marginal_distribution.transition_layout(cmd_buffer, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, VK_ACCESS_SHADER_READ_BIT);
     device->end_single_use_command_buffer(cmd_buffer);
 
-    image_data_buffer.free();
-    conditional_cdf_data_buffer.free();
-    marginal_cdf_data_buffer.free();
+    conditional_data_buffer.free();
+    marginal_data_buffer.free();
 
     return result;
 }
@@ -112,10 +241,11 @@ EnvironmentMap loaders::load_default_environment_map(Device* device, vec3 color)
     EnvironmentMap result {};
     int width = 1;
     int height = 1;
+    result.average_luminance = color::luminance(color);
 
     result.image = device->create_image(1, 1, VK_IMAGE_USAGE_SAMPLED_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT, 1, 1, VK_FORMAT_R32G32B32A32_SFLOAT, VK_FILTER_NEAREST);
-    result.conditional_cdf_map = device->create_image(1, 1, VK_IMAGE_USAGE_SAMPLED_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT, 1, 1, VK_FORMAT_R32G32B32A32_SFLOAT, VK_FILTER_NEAREST);
-    result.marginal_cdf_map = device->create_image(1, 1, VK_IMAGE_USAGE_SAMPLED_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT, 1, 1, VK_FORMAT_R32G32B32A32_SFLOAT, VK_FILTER_NEAREST);
+    result.conditional_distribution = device->create_image(1, 1, VK_IMAGE_USAGE_SAMPLED_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT, 1, 1, VK_FORMAT_R32G32B32A32_SFLOAT, VK_FILTER_NEAREST);
+    result.marginal_distribution = device->create_image(1, 1, VK_IMAGE_USAGE_SAMPLED_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT, 1, 1, VK_FORMAT_R32G32B32A32_SFLOAT, VK_FILTER_NEAREST);
 
     auto cmd_buffer = device->begin_single_use_command_buffer();
     Buffer image_buffer = device->create_buffer(result.image.memory_requirements.size, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_SRC_BIT);
@@ -130,25 +260,29 @@ EnvironmentMap loaders::load_default_environment_map(Device* device, vec3 color)
     result.image.transition_layout(VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_ACCESS_SHADER_READ_BIT);
     result.image.copy_buffer_to_image(cmd_buffer, image_buffer);
 
-    Buffer cdf_buffer = device->create_buffer(result.marginal_cdf_map.memory_requirements.size, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_SRC_BIT);
-    float* cdf_data;
-    vkMapMemory(cdf_buffer.device_handle, cdf_buffer.device_memory, cdf_buffer.device_memory_offset, VK_WHOLE_SIZE, 0, (void**)&cdf_data);
-    cdf_data[0] = 1.0;
-    vkUnmapMemory(cdf_buffer.device_handle, cdf_buffer.device_memory);
-
-    result.marginal_cdf_map.transition_layout(VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_ACCESS_SHADER_READ_BIT);
-    result.marginal_cdf_map.copy_buffer_to_image(cmd_buffer, cdf_buffer);
-    result.conditional_cdf_map.transition_layout(VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_ACCESS_SHADER_READ_BIT);
-    result.conditional_cdf_map.copy_buffer_to_image(cmd_buffer, cdf_buffer);
+    // single texel tables always keep their only entry
+    Buffer distribution_buffer = device->create_buffer(result.marginal_distribution.memory_requirements.size, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_SRC_BIT);
+    float* distribution_data;
+    vkMapMemory(distribution_buffer.device_handle, distribution_buffer.device_memory, distribution_buffer.device_memory_offset, VK_WHOLE_SIZE, 0, (void**)&distribution_data);
+    distribution_data[0] = 1.0;
+    distribution_data[1] = 0.0;
+    distribution_data[2] = 1.0;
+    distribution_data[3] = 0.0;
+    vkUnmapMemory(distribution_buffer.device_handle, distribution_buffer.device_memory);
+
+    result.marginal_distribution.transition_layout(VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_ACCESS_SHADER_READ_BIT);
+    result.marginal_distribution.copy_buffer_to_image(cmd_buffer, distribution_buffer);
+    result.conditional_distribution.transition_layout(VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_ACCESS_SHADER_READ_BIT);
+    result.conditional_distribution.copy_buffer_to_image(cmd_buffer, distribution_buffer);
 
     result.image.transition_layout(cmd_buffer, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, VK_ACCESS_SHADER_READ_BIT);
-    result.conditional_cdf_map.transition_layout(cmd_buffer, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, VK_ACCESS_SHADER_READ_BIT);
-    result.marginal_cdf_map.transition_layout(cmd_buffer, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, VK_ACCESS_SHADER_READ_BIT);
+    result.conditional_distribution.transition_layout(cmd_buffer, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, VK_ACCESS_SHADER_READ_BIT);
+    result.marginal_distribution.transition_layout(cmd_buffer, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, VK_ACCESS_SHADER_READ_BIT);
 
     device->end_single_use_command_buffer(cmd_buffer);
 
     image_buffer.free();
-    cdf_buffer.free();
+    distribution_buffer.free();
 
     return result;
 }
\ No newline at end of file
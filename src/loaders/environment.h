@@ -5,13 +5,21 @@
 
 #include <string>
 
+// default upper limit of the environment distribution width, larger maps are averaged down
+#define ENVIRONMENT_MAX_SAMPLING_WIDTH 2048
+
 struct EnvironmentMap {
     Image image;
-    Image conditional_cdf_map;
-    Image marginal_cdf_map;
+    // alias tables for importance sampling, rgba: threshold, alias, probability
+    // one table per row of texels and a 1 x height table over the rows
+    Image conditional_distribution;
+    Image marginal_distribution;
+    // mean luminance over the sphere, pi times this approximates the irradiance on an unoccluded surface
+    float average_luminance = 0.0f;
 };
 
 namespace loaders {
-    EnvironmentMap load_environment_map(Device* device, const std::string& path);
+    // sampling_width limits the resolution of the sampling distribution, 0 uses the map resolution up to ENVIRONMENT_MAX_SAMPLING_WIDTH
+    EnvironmentMap load_environment_map(Device* device, const std::string& path, uint32_t sampling_width = 0);
     EnvironmentMap load_default_environment_map(Device* device, vec3 color = vec3(0.0));
 }
\ No newline at end of file
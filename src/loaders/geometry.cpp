@@ -3,6 +3,7 @@
 #include <iostream>
 
 #include "mikktspace/mikktspace.h"
+#include "core/cpu_profiler.h"
 
 int get_num_faces(const SMikkTSpaceContext* ctx) {
     GLTFPrimitive* mesh_data = (GLTFPrimitive*)ctx->m_pUserData;
@@ -69,6 +70,7 @@ void set_tangent(const SMikkTSpaceContext* ctx, const float* in, float f_sign, i
 }
 
 void TangentGenerator::calculate_tangents() {
+    PROFILE_ZONE("calculate_tangents");
     SMikkTSpaceInterface interface{};
     SMikkTSpaceContext ctx{};
 
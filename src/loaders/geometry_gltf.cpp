@@ -4,6 +4,7 @@
 
 #include "glm/gtc/type_ptr.hpp"
 #include "geometry.h"
+#include "core/cpu_profiler.h"
 
 #define TINYGLTF_IMPLEMENTATION
 #define STB_IMAGE_WRITE_IMPLEMENTATION
@@ -11,11 +12,16 @@
 
 
 GLTFData loaders::load_gltf(const std::string path) {
+    PROFILE_ZONE_DETAIL("load_gltf", path);
     std::cout << "Loading GLTF file at: " << path << std::endl;
     tinygltf::TinyGLTF loader;
     tinygltf::Model model;
     std::string err, warn;
-    bool loaded = loader.LoadASCIIFromFile(&model, &err, &warn, path);
+    bool loaded;
+    {
+        PROFILE_ZONE("parse gltf");
+        loaded = loader.LoadASCIIFromFile(&model, &err, &warn, path);
+    }
     
     if (!warn.empty()) {
         std::cout << "GLTF Warning: " << warn << std::endl;
@@ -157,6 +163,8 @@ GLTFData loaders::load_gltf(const std::string path) {
         result_material.emissive_factor.g = material.emissiveFactor[1];
         result_material.emissive_factor.b = material.emissiveFactor[2];
 
+        result_material.double_sided = material.doubleSided;
+
         result.materials.push_back(result_material);
     }
 
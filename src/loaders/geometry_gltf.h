@@ -26,6 +26,8 @@ struct GLTFMaterial {
     vec3 emissive_factor = vec3(0);
     float transmission_factor = 0;
     float ior = 1.1;
+    // single sided emitters only emit from their front faces
+    bool double_sided = false;
 };
 
 struct GLTFPrimitive {
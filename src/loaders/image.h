@@ -5,6 +5,19 @@
 
 struct Device;
 
+// decoded pixels on the host, rgba8 for ldr images and rgba32f for hdr images or when requested
+struct ImageData {
+    int width = 0, height = 0;
+    VkFormat format;
+    unsigned char* pixels = nullptr;
+
+    size_t get_size() const;
+    void free();
+};
+
 namespace loaders {
     Image load_image(Device* device, const std::string& path, VkMemoryPropertyFlags additional_memory_properties = 0, VkImageLayout layout = VK_IMAGE_LAYOUT_GENERAL, VkAccessFlags access = 0);
-}
\ No newline at end of file
+
+    ImageData decode_image(const std::string& path, bool force_float = false);
+    Image upload_image(Device* device, const ImageData& data, VkMemoryPropertyFlags additional_memory_properties = 0, VkImageLayout layout = VK_IMAGE_LAYOUT_GENERAL, VkAccessFlags access = 0);
+}
@@ -1,19 +1,23 @@
 #include "scene.h"
 
 #include "toml.hpp"
+#include "core/cpu_profiler.h"
 #include <iostream>
 #include <unordered_map>
 
 #include "glm/gtc/matrix_transform.hpp"
 
 SceneData loaders::load_scene_description(std::string path) {
+    PROFILE_ZONE_DETAIL("load_scene_description", path);
     toml::table scene_table = toml::parse_file(path);
 
     // environment
     std::string environment_path;
     vec3 environment_color = vec3(0.0);
+    uint32_t environment_sampling_width = 0;
     if (scene_table.contains("environment")) {
         auto environment = scene_table["environment"].as_table();
+        if (environment->contains("sampling_width")) environment_sampling_width = scene_table["environment"]["sampling_width"].as_integer()->get();
         if (environment->contains("path")) environment_path = scene_table["environment"]["path"].as_string()->get();
         else if (environment->contains("color")) {
             environment_color.x = scene_table["environment"]["color"][0].as_floating_point()->get();
@@ -116,6 +120,7 @@ SceneData loaders::load_scene_description(std::string path) {
     SceneData result;
     result.environment_path = environment_path;
     result.environment_color = environment_color;
+    result.environment_sampling_width = environment_sampling_width;
     result.object_paths = object_paths;
     result.instances = instances;
     result.lights = lights;
@@ -22,6 +22,13 @@ struct InstanceData
         vec4 emissive_factor;
         // roughness x, metallic y, transmissive z, ior a
         vec4 roughness_metallic_transmissive_ior;
+        // MATERIAL_FLAG_*
+        uint32_t flags = 0;
+        // light tree leaf of the area light of the instance, written when the tree is built
+        uint32_t light_node = 0xFFFFFFFF;
+        // scene wide index of the loaded material, shared by all instances using it
+        uint32_t material_index = 0;
+        uint32_t pad_0 = 0;
     } material_parameters;
 
     std::string object_name;
@@ -47,6 +54,8 @@ struct SceneData
 {
     std::string environment_path = "";
     vec3 environment_color = vec3(0.0);
+    // width of the environment sampling distribution, 0 follows the map resolution
+    uint32_t environment_sampling_width = 0;
     // tuples containing object name and path
     std::vector<std::tuple<std::string, std::string>> object_paths;
     // instance data
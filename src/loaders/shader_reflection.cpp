@@ -0,0 +1,199 @@
+#include "shader_reflection.h"
+
+#include <unordered_map>
+#include <stdexcept>
+#include <cstring>
+
+namespace {
+    // subset of the spir-v specification needed to find descriptors and workgroup sizes
+    const uint32_t spirv_magic = 0x07230203;
+
+    enum Op : uint32_t {
+        OpExecutionMode = 16,
+        OpTypeImage = 25,
+        OpTypeSampler = 26,
+        OpTypeSampledImage = 27,
+        OpTypeArray = 28,
+        OpTypeRuntimeArray = 29,
+        OpTypeStruct = 30,
+        OpTypePointer = 32,
+        OpConstant = 43,
+        OpConstantComposite = 44,
+        OpSpecConstant = 50,
+        OpSpecConstantComposite = 51,
+        OpVariable = 59,
+        OpDecorate = 71,
+        OpExecutionModeId = 331,
+        OpTypeAccelerationStructureKHR = 5341,
+    };
+
+    enum Decoration : uint32_t {
+        DecorationBufferBlock = 3,
+        DecorationBuiltIn = 11,
+        DecorationBinding = 33,
+        DecorationDescriptorSet = 34,
+    };
+
+    enum StorageClass : uint32_t {
+        StorageClassUniformConstant = 0,
+        StorageClassUniform = 2,
+        StorageClassStorageBuffer = 12,
+    };
+
+    const uint32_t ExecutionModeLocalSize = 17;
+    const uint32_t ExecutionModeLocalSizeId = 38;
+    const uint32_t BuiltInWorkgroupSize = 25;
+    const uint32_t ImageDimBuffer = 5;
+
+    struct SpirvType {
+        uint32_t opcode = 0;
+        // element type of arrays and pointers
+        uint32_t element_type = 0;
+        // constant id of the array length
+        uint32_t length_id = 0;
+        // OpTypeImage: dimension and sampled operand
+        uint32_t image_dim = 0;
+        uint32_t image_sampled = 0;
+    };
+}
+
+namespace loaders {
+    ShaderReflection reflect_spirv(const std::vector<char>& code) {
+        if (code.size() < 5 * sizeof(uint32_t) || code.size() % sizeof(uint32_t) != 0) throw std::runtime_error("invalid spir-v module size");
+
+        std::vector<uint32_t> words(code.size() / sizeof(uint32_t));
+        std::memcpy(words.data(), code.data(), code.size());
+        if (words[0] != spirv_magic) throw std::runtime_error("invalid spir-v magic number");
+
+        std::unordered_map<uint32_t, SpirvType> types;
+        std::unordered_map<uint32_t, uint32_t> constants;
+        std::unordered_map<uint32_t, std::vector<uint32_t>> composites;
+        std::unordered_map<uint32_t, uint32_t> descriptor_sets, bindings;
+        std::unordered_map<uint32_t, bool> buffer_blocks;
+        uint32_t workgroup_size_id = 0;
+        // variable id -> pointer type id and storage class
+        std::vector<std::pair<uint32_t, std::pair<uint32_t, uint32_t>>> variables;
+        std::vector<uint32_t> local_size_ids;
+
+        ShaderReflection result;
+
+        // instructions start after the 5 word header
+        for (size_t offset = 5; offset < words.size();) {
+            uint32_t word_count = words[offset] >> 16;
+            uint32_t opcode = words[offset] & 0xFFFF;
+            if (word_count == 0 || offset + word_count > words.size()) throw std::runtime_error("malformed spir-v instruction");
+            const uint32_t* operands = &words[offset + 1];
+
+            switch (opcode) {
+            case OpExecutionMode:
+                if (operands[1] == ExecutionModeLocalSize && word_count >= 6) {
+                    result.local_size_x = operands[2];
+                    result.local_size_y = operands[3];
+                    result.local_size_z = operands[4];
+                }
+                break;
+            case OpExecutionModeId:
+                if (operands[1] == ExecutionModeLocalSizeId && word_count >= 6) local_size_ids = {operands[2], operands[3], operands[4]};
+                break;
+            case OpDecorate:
+                if (operands[1] == DecorationDescriptorSet) descriptor_sets[operands[0]] = operands[2];
+                else if (operands[1] == DecorationBinding) bindings[operands[0]] = operands[2];
+                else if (operands[1] == DecorationBufferBlock) buffer_blocks[operands[0]] = true;
+                else if (operands[1] == DecorationBuiltIn && operands[2] == BuiltInWorkgroupSize) workgroup_size_id = operands[0];
+                break;
+            case OpTypeImage:
+                types[operands[0]].opcode = opcode;
+                types[operands[0]].image_dim = operands[2];
+                types[operands[0]].image_sampled = operands[6];
+                break;
+            case OpTypeSampler:
+            case OpTypeSampledImage:
+            case OpTypeStruct:
+            case OpTypeAccelerationStructureKHR:
+                types[operands[0]].opcode = opcode;
+                break;
+            case OpTypeArray:
+                types[operands[0]] = SpirvType{opcode, operands[1], operands[2]};
+                break;
+            case OpTypeRuntimeArray:
+                types[operands[0]] = SpirvType{opcode, operands[1]};
+                break;
+            case OpTypePointer:
+                types[operands[0]] = SpirvType{opcode, operands[2]};
+                break;
+            case OpConstant:
+            case OpSpecConstant:
+                constants[operands[1]] = operands[2];
+                break;
+            case OpConstantComposite:
+            case OpSpecConstantComposite:
+                composites[operands[1]] = std::vector<uint32_t>(operands + 2, operands + word_count - 1);
+                break;
+            case OpVariable:
+                variables.push_back({operands[1], {operands[0], operands[2]}});
+                break;
+            }
+
+            offset += word_count;
+        }
+
+        // LocalSizeId and the WorkgroupSize builtin take precedence over literal sizes
+        if (local_size_ids.size() == 3) {
+            result.local_size_x = constants[local_size_ids[0]];
+            result.local_size_y = constants[local_size_ids[1]];
+            result.local_size_z = constants[local_size_ids[2]];
+        }
+        auto workgroup_size = composites.find(workgroup_size_id);
+        if (workgroup_size_id != 0 && workgroup_size != composites.end() && workgroup_size->second.size() == 3) {
+            result.local_size_x = constants[workgroup_size->second[0]];
+            result.local_size_y = constants[workgroup_size->second[1]];
+            result.local_size_z = constants[workgroup_size->second[2]];
+        }
+
+        for (auto& variable : variables) {
+            uint32_t id = variable.first;
+            uint32_t storage_class = variable.second.second;
+            if (storage_class != StorageClassUniformConstant && storage_class != StorageClassUniform && storage_class != StorageClassStorageBuffer) continue;
+            if (descriptor_sets.find(id) == descriptor_sets.end() || bindings.find(id) == bindings.end()) continue;
+
+            ShaderDescriptorBinding binding;
+            binding.set = descriptor_sets[id];
+            binding.binding = bindings[id];
+            binding.count = 1;
+
+            // unwrap descriptor arrays
+            uint32_t type_id = types[variable.second.first].element_type;
+            SpirvType type = types[type_id];
+            if (type.opcode == OpTypeArray) {
+                binding.count = constants[type.length_id];
+                type_id = type.element_type;
+            } else if (type.opcode == OpTypeRuntimeArray) {
+                binding.count = 0;
+                type_id = type.element_type;
+            }
+            type = types[type_id];
+
+            if (storage_class == StorageClassStorageBuffer) {
+                binding.type = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+            } else if (storage_class == StorageClassUniform) {
+                binding.type = buffer_blocks[type_id] ? VK_DESCRIPTOR_TYPE_STORAGE_BUFFER : VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
+            } else if (type.opcode == OpTypeSampledImage) {
+                binding.type = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+            } else if (type.opcode == OpTypeSampler) {
+                binding.type = VK_DESCRIPTOR_TYPE_SAMPLER;
+            } else if (type.opcode == OpTypeAccelerationStructureKHR) {
+                binding.type = VK_DESCRIPTOR_TYPE_ACCELERATION_STRUCTURE_KHR;
+            } else if (type.opcode == OpTypeImage) {
+                // sampled operand 2: used without a sampler (storage image)
+                if (type.image_dim == ImageDimBuffer) binding.type = type.image_sampled == 2 ? VK_DESCRIPTOR_TYPE_STORAGE_TEXEL_BUFFER : VK_DESCRIPTOR_TYPE_UNIFORM_TEXEL_BUFFER;
+                else binding.type = type.image_sampled == 2 ? VK_DESCRIPTOR_TYPE_STORAGE_IMAGE : VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE;
+            } else {
+                continue;
+            }
+
+            result.bindings.push_back(binding);
+        }
+
+        return result;
+    }
+}
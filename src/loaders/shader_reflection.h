@@ -0,0 +1,27 @@
+#pragma once
+
+#include "core/vulkan.h"
+
+#include <vector>
+#include <string>
+#include <cstdint>
+
+namespace loaders {
+    // descriptor declared by a shader module
+    struct ShaderDescriptorBinding {
+        uint32_t set;
+        uint32_t binding;
+        VkDescriptorType type;
+        // array size, 0 for runtime sized arrays
+        uint32_t count;
+    };
+
+    // resources and workgroup size of a compiled shader, read from the spir-v module
+    struct ShaderReflection {
+        uint32_t local_size_x = 1, local_size_y = 1, local_size_z = 1;
+        std::vector<ShaderDescriptorBinding> bindings;
+    };
+
+    // descriptors removed by the optimizer because they are unused are not reported
+    ShaderReflection reflect_spirv(const std::vector<char>& code);
+}
@@ -9,29 +9,118 @@
 #include "glm/mat4x4.hpp"
 
 #include "vulkan_application.h"
+#include "core/cpu_profiler.h"
 
 #include "glslang/SPIRV/GlslangToSpv.h"
 
+static void print_usage() {
+    std::cout << "usage: renderer <scene file> [options] | renderer --batch <job file> [options]" << std::endl;
+    std::cout << "options: --trace <file> --headless --benchmark --width <pixels> --height <pixels> --samples <count> --time <seconds>" << std::endl;
+    std::cout << "         --output <name> --output-dir <directory> --tile-size <pixels> --adaptive-threshold <error>" << std::endl;
+    std::cout << "         --integrator <name> --no-material-sorting --coherence-sorting" << std::endl;
+}
+
 int main(int argc, char** argv)
 {
     std::cout << "TEST" << std::endl;
-    // initialize glfw
-    glfwInit();
-
     VulkanApplication app;
     if (argc < 2) {
-        std::cout << "please provide a scene file as the first argument to program execution" << std::endl;
+        std::cout << "please provide a scene file (or --batch <job file>) as the first argument to program execution" << std::endl;
+        exit(1);
+    }
+
+    // batch mode replaces the scene argument with a job file
+    std::vector<BatchJob> batch_jobs;
+    int first_option = 2;
+    if (std::string(argv[1]) == "--batch") {
+        if (argc < 3) {
+            std::cout << "please provide a job file after --batch" << std::endl;
+            exit(1);
+        }
+        try {
+            batch_jobs = loaders::load_batch_jobs(argv[2]);
+        } catch (std::exception& err) {
+            std::cerr << "ENCOUNTERED ERROR: " << "\033[31m" << err.what() << "\033[m" << std::endl;
+            exit(1);
+        }
+        if (batch_jobs.empty()) {
+            std::cout << "job file contains no jobs" << std::endl;
+            exit(0);
+        }
+        app.set_scene_path(batch_jobs[0].scene_path);
+        first_option = 3;
+    } else {
+        app.set_scene_path(argv[1]);
+    }
+
+    // optional arguments
+    std::string trace_path;
+    bool headless = !batch_jobs.empty();
+    HeadlessSettings headless_settings;
+    if (!batch_jobs.empty()) headless_settings.extent = {batch_jobs[0].width, batch_jobs[0].height};
+    std::string arg;
+    try {
+        for (int i = first_option; i < argc; i++) {
+            arg = argv[i];
+            if (arg == "--trace" && i + 1 < argc) {
+                trace_path = argv[++i];
+            } else if (arg == "--headless") {
+                headless = true;
+            } else if (arg == "--width" && i + 1 < argc) {
+                headless_settings.extent.width = std::stoul(argv[++i]);
+            } else if (arg == "--height" && i + 1 < argc) {
+                headless_settings.extent.height = std::stoul(argv[++i]);
+            } else if (arg == "--samples" && i + 1 < argc) {
+                headless_settings.sample_count = std::stoul(argv[++i]);
+            } else if (arg == "--time" && i + 1 < argc) {
+                headless_settings.time_budget = std::stod(argv[++i]);
+            } else if (arg == "--output" && i + 1 < argc) {
+                headless_settings.outputs.push_back(argv[++i]);
+            } else if (arg == "--output-dir" && i + 1 < argc) {
+                headless_settings.output_directory = argv[++i];
+            } else if (arg == "--tile-size" && i + 1 < argc) {
+                headless_settings.tile_size = std::stoul(argv[++i]);
+            } else if (arg == "--adaptive-threshold" && i + 1 < argc) {
+                headless_settings.adaptive_threshold = std::stof(argv[++i]);
+            } else if (arg == "--integrator" && i + 1 < argc) {
+                headless_settings.integrator = parse_integrator(argv[++i]);
+            } else if (arg == "--no-material-sorting") {
+                headless_settings.material_sorting = false;
+            } else if (arg == "--coherence-sorting") {
+                headless_settings.coherence_sorting = true;
+            } else if (arg == "--benchmark") {
+                headless = true;
+                headless_settings.benchmark = true;
+            } else {
+                std::cout << "ignoring unknown argument " << arg << std::endl;
+            }
+        }
+    } catch (const std::exception& err) {
+        // malformed numbers and unknown integrator names
+        std::cerr << "invalid value for " << arg << ": " << "\033[31m" << err.what() << "\033[m" << std::endl;
+        print_usage();
         exit(1);
     }
-    app.set_scene_path(argv[1]);
+
+    // initialize glfw
+    if (!headless) glfwInit();
+
+    if (!trace_path.empty()) profiler::enable();
+
+    int exit_code = 0;
     try {
+        if (headless) app.set_headless(headless_settings);
+        if (!batch_jobs.empty()) app.set_batch_jobs(batch_jobs);
         app.setup();
         app.run();
         app.cleanup();
-    } catch (std::runtime_error err) {
+    } catch (const std::runtime_error& err) {
         std::cerr << "ENCOUNTERED ERROR: " << "\033[31m" << err.what() << "\033[m" << std::endl;
+        exit_code = 1;
     }
 
+    if (!trace_path.empty()) profiler::save_trace(trace_path);
+
 
-    return 0;
+    return exit_code;
 }
\ No newline at end of file
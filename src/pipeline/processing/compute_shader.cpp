@@ -4,233 +4,291 @@
 #include <array>
 #include <iostream>
 #include <sstream>
+#include <stdexcept>
+#include <algorithm>
+#include <type_traits>
 
 #include "core/device.h"
 #include "loaders/shader_spirv.h"
 #include "shader_compiler.h"
 #include "shader_interface.h"
+#include "core/cpu_profiler.h"
+#include "loaders/shader_reflection.h"
 
 #include <glm/vec2.hpp>
 
 
+// states of shadowed descriptors
+static const uint8_t DESCRIPTOR_UNWRITTEN = 0;
+static const uint8_t DESCRIPTOR_WRITTEN = 1;
+static const uint8_t DESCRIPTOR_DIRTY = 2;
+// written, but the resource might have been recreated with the same handle
+static const uint8_t DESCRIPTOR_STALE = 3;
+
+static bool is_descriptor_current(uint8_t state) {
+    return state == DESCRIPTOR_WRITTEN || state == DESCRIPTOR_DIRTY;
+}
+
 void ComputeShader::set_image(int index, Image* img, int array_index) {
-    VkDescriptorImageInfo compute_descriptor_image_info{};
-    compute_descriptor_image_info.imageLayout = img->layout;
-    compute_descriptor_image_info.imageView = img->view_handle;
-    compute_descriptor_image_info.sampler = img->sampler_handle;
-
-    VkWriteDescriptorSet compute_descriptor_write{};
-    compute_descriptor_write.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
-    compute_descriptor_write.dstSet = descriptor_set_images;
-    compute_descriptor_write.dstBinding = index;
-    compute_descriptor_write.dstArrayElement = array_index;
-    compute_descriptor_write.descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
-    compute_descriptor_write.descriptorCount = 1;
-    compute_descriptor_write.pImageInfo = &compute_descriptor_image_info;
-
-    vkUpdateDescriptorSets(device->vulkan_device, 1, &compute_descriptor_write, 0, nullptr);
+    // descriptors the shader does not use are not part of the layout
+    if (index >= image_descriptor_counts.size() || (uint32_t)array_index >= image_descriptor_counts[index]) return;
+
+    // unchanged descriptors are not written again
+    uint32_t element = image_info_offsets[index] + array_index;
+    VkDescriptorImageInfo& image_info = image_infos[element];
+    if (is_descriptor_current(image_states[element]) && image_info.imageView == img->view_handle && image_info.sampler == img->sampler_handle && image_info.imageLayout == img->layout) return;
+
+    image_info.imageLayout = img->layout;
+    image_info.imageView = img->view_handle;
+    image_info.sampler = img->sampler_handle;
+    image_states[element] = DESCRIPTOR_DIRTY;
+    descriptors_dirty = true;
 }
 
 void ComputeShader::set_images(int index, std::vector<Image>* images) {
-    for (int i = 0; i < image_descriptor_counts[index]; i++) {
+    if (index >= image_descriptor_counts.size()) return;
+    for (uint32_t i = 0; i < image_descriptor_counts[index]; i++) {
         if (i < images->size()) set_image(index, &images->at(i), i);
         else set_image(index, &images->at(0), i);
     }
 }
 
 void ComputeShader::set_buffer(int index, Buffer* buffer, int array_index) {
-    VkDescriptorBufferInfo compute_descriptor_buffer_info{};
-    compute_descriptor_buffer_info.buffer = buffer->buffer_handle;
-    compute_descriptor_buffer_info.offset = 0;
-    compute_descriptor_buffer_info.range = VK_WHOLE_SIZE;
-
-    VkWriteDescriptorSet compute_descriptor_write{};
-    compute_descriptor_write.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
-    compute_descriptor_write.dstSet = descriptor_set_buffers;
-    compute_descriptor_write.dstBinding = index;
-    compute_descriptor_write.dstArrayElement = array_index;
-    compute_descriptor_write.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
-    compute_descriptor_write.descriptorCount = 1;
-    compute_descriptor_write.pBufferInfo = &compute_descriptor_buffer_info;
-
-    vkUpdateDescriptorSets(device->vulkan_device, 1, &compute_descriptor_write, 0, nullptr);
+    if (index >= buffer_descriptor_counts.size() || (uint32_t)array_index >= buffer_descriptor_counts[index]) return;
+
+    uint32_t element = buffer_info_offsets[index] + array_index;
+    VkDescriptorBufferInfo& buffer_info = buffer_infos[element];
+    if (is_descriptor_current(buffer_states[element]) && buffer_info.buffer == buffer->buffer_handle) return;
+
+    buffer_info.buffer = buffer->buffer_handle;
+    buffer_info.offset = 0;
+    buffer_info.range = VK_WHOLE_SIZE;
+    buffer_states[element] = DESCRIPTOR_DIRTY;
+    descriptors_dirty = true;
 }
 
 void ComputeShader::set_acceleration_structure(int index, VkAccelerationStructureKHR acceleration_structure) {
-    VkWriteDescriptorSetAccelerationStructureKHR descriptor_write_as_data{};
-    descriptor_write_as_data.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET_ACCELERATION_STRUCTURE_KHR;
-    descriptor_write_as_data.accelerationStructureCount = 1;
-    descriptor_write_as_data.pAccelerationStructures = &acceleration_structure;
-
-    VkWriteDescriptorSet compute_descriptor_write{};
-    compute_descriptor_write.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
-    compute_descriptor_write.dstSet = descriptor_set_as;
-    compute_descriptor_write.dstBinding = index;
-    compute_descriptor_write.dstArrayElement = 0;
-    compute_descriptor_write.descriptorType = VK_DESCRIPTOR_TYPE_ACCELERATION_STRUCTURE_KHR;
-    compute_descriptor_write.descriptorCount = 1;
-
-    compute_descriptor_write.pNext = &descriptor_write_as_data;
-    vkUpdateDescriptorSets(device->vulkan_device, 1, &compute_descriptor_write, 0, nullptr);
+    if (index >= as_descriptor_counts.size() || as_descriptor_counts[index] == 0) return;
+    if (is_descriptor_current(as_states[index]) && acceleration_structures[index] == acceleration_structure) return;
+
+    acceleration_structures[index] = acceleration_structure;
+    as_states[index] = DESCRIPTOR_DIRTY;
+    descriptors_dirty = true;
 }
 
-void ComputeShader::build() {
-    // preprocess shader code
-    std::ifstream in_file(code_path);
-    std::string line;
-    std::cout << "detecting shader information for compute shader at " << this->code_path << std::endl;
-    while(std::getline(in_file, line)) {
-        line.erase(remove_if(line.begin(), line.end(), isspace), line.end());
-        if (line.find("layout") == 0) {
-            size_t size_x_pos = line.find("local_size_x");
-            size_t size_y_pos = line.find("local_size_y");
-            size_t size_z_pos = line.find("local_size_z");
-            // shader group size declaration
-            if (size_x_pos != std::string::npos && size_y_pos != std::string::npos && size_z_pos != std::string::npos) {
-                size_t size_x_string_start = line.find("=", size_x_pos) + 1;
-                size_t size_x_string_end = line.find(",", size_x_string_start);
-                size_t size_y_string_start = line.find("=", size_y_pos) + 1;
-                size_t size_y_string_end = line.find(",", size_y_string_start);
-                size_t size_z_string_start = line.find("=", size_z_pos) + 1;
-                size_t size_z_string_end = line.find(")", size_z_string_start);
-                
-                std::string size_x_string = line.substr(size_x_string_start, size_x_string_end - size_x_string_start);
-                std::string size_y_string = line.substr(size_y_string_start, size_y_string_end - size_y_string_start);
-                std::string size_z_string = line.substr(size_z_string_start, size_z_string_end - size_z_string_start);
-
-                local_dispatch_size_x = std::stoi(size_x_string);
-                local_dispatch_size_y = std::stoi(size_y_string);
-                local_dispatch_size_z = std::stoi(size_z_string);
-
-                std::cout << "shader group sizes detected: " << (int)local_dispatch_size_x << ", " << (int)local_dispatch_size_y << ", " << (int)local_dispatch_size_z << std::endl;
-            }
+void ComputeShader::invalidate_descriptors() {
+    for (auto* states : {&buffer_states, &image_states, &as_states}) {
+        for (auto& state : *states) {
+            if (state == DESCRIPTOR_WRITTEN) state = DESCRIPTOR_STALE;
+        }
+    }
+}
 
-            // buffer declaration
-            auto buffer_set_pos = line.find("set=DESCRIPTOR_SET_BUFFERS");
-            auto image_set_pos = line.find("set=DESCRIPTOR_SET_IMAGES");
-            if (buffer_set_pos != std::string::npos || image_set_pos != std::string::npos) {
-                size_t count = 1;
-                auto array_brace_start = line.rfind("[");
-                auto array_brace_end = line.rfind("];");
-                // descriptor is array descriptor
-                if (array_brace_start != std::string::npos && array_brace_end != std::string::npos) {
-                    // check if closing brace is at end of line
-                    if (array_brace_end + 2 == line.size()) {
-                        auto count_literal_length = array_brace_end - array_brace_start;
-                        // array has count literal
-                        if (count_literal_length > 1) {
-                            count = std::stoi(line.substr(array_brace_start+1, count_literal_length-1));
-                        } else {
-                            count = 16;
-                        }
-                    }
-                }
-
-                if (buffer_set_pos != std::string::npos) {
-                    buffer_descriptor_counts.push_back(count);
-                    std::cout << "buffer descriptor detected, descriptor count: " << count << std::endl;
-                } else {
-                    image_descriptor_counts.push_back(count);
-                    std::cout << "image descriptor detected, descriptor count: " << count << std::endl;
-                }
+// appends one write per run of consecutive dirty array elements
+template <typename Info>
+static void append_dirty_writes(std::vector<VkWriteDescriptorSet>& writes, VkDescriptorSet set, VkDescriptorType type, const std::vector<uint32_t>& counts, const std::vector<uint32_t>& offsets, std::vector<Info>& infos, std::vector<uint8_t>& states) {
+    for (uint32_t binding = 0; binding < counts.size(); binding++) {
+        uint32_t element = 0;
+        while (element < counts[binding]) {
+            if (states[offsets[binding] + element] != DESCRIPTOR_DIRTY) {
+                element++;
+                continue;
             }
 
-            // acceleration structure declaration
-            auto as_set_pos = line.find("set=DESCRIPTOR_SET_ACCELERATION_STRUCTURES");
-            if (as_set_pos != std::string::npos) {
-                as_descriptor_count++;
-                std::cout << "acceleration structure descriptor detected" << std::endl;
-            }
+            uint32_t first = element;
+            while (element < counts[binding] && states[offsets[binding] + element] == DESCRIPTOR_DIRTY) element++;
+
+            VkWriteDescriptorSet write{};
+            write.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+            write.dstSet = set;
+            write.dstBinding = binding;
+            write.dstArrayElement = first;
+            write.descriptorType = type;
+            write.descriptorCount = element - first;
+            if constexpr (std::is_same_v<Info, VkDescriptorBufferInfo>) write.pBufferInfo = &infos[offsets[binding] + first];
+            else write.pImageInfo = &infos[offsets[binding] + first];
+            writes.push_back(write);
         }
     }
+}
 
+// sets with only current descriptors are rewritten with their update template, everything else is batched into one vkUpdateDescriptorSets call
+void ComputeShader::flush_descriptor_writes() {
+    if (!descriptors_dirty) return;
+    descriptors_dirty = false;
 
-    std::filesystem::path compiled_shader_path = compile_shader(code_path);
-
-    std::cout << "before load" << code_path << std::endl;
+    auto is_complete = [](const std::vector<uint8_t>& states) {
+        return std::all_of(states.begin(), states.end(), is_descriptor_current);
+    };
+    auto is_dirty = [](const std::vector<uint8_t>& states) {
+        return std::find(states.begin(), states.end(), DESCRIPTOR_DIRTY) != states.end();
+    };
 
-    VkPipelineShaderStageCreateInfo stage_create_info{};
-    stage_create_info.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
-    stage_create_info.stage = VK_SHADER_STAGE_COMPUTE_BIT;
-    stage_create_info.module = loaders::load_shader_module(device->vulkan_device, compiled_shader_path.string());
-    stage_create_info.pName = "main";
+    std::vector<VkWriteDescriptorSet> writes;
 
-    std::cout << "after load" << std::endl;
+    if (is_dirty(buffer_states)) {
+        if (buffer_update_template != VK_NULL_HANDLE && is_complete(buffer_states)) vkUpdateDescriptorSetWithTemplate(device->vulkan_device, descriptor_set_buffers, buffer_update_template, buffer_infos.data());
+        else append_dirty_writes(writes, descriptor_set_buffers, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, buffer_descriptor_counts, buffer_info_offsets, buffer_infos, buffer_states);
+    }
 
-    std::vector<VkDescriptorSetLayoutBinding> buffer_layout_bindings;
+    if (is_dirty(image_states)) {
+        if (image_update_template != VK_NULL_HANDLE && is_complete(image_states)) vkUpdateDescriptorSetWithTemplate(device->vulkan_device, descriptor_set_images, image_update_template, image_infos.data());
+        else append_dirty_writes(writes, descriptor_set_images, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, image_descriptor_counts, image_info_offsets, image_infos, image_states);
+    }
 
-    for (int i = 0; i < buffer_descriptor_counts.size(); i++) {
-        VkDescriptorSetLayoutBinding layout_binding;
-        layout_binding.stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
-        layout_binding.binding = i;
-        layout_binding.descriptorCount = buffer_descriptor_counts[i];
-        layout_binding.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
-        buffer_layout_bindings.push_back(layout_binding);
+    // acceleration structures are chained through pNext, kept alive until the update
+    std::vector<VkWriteDescriptorSetAccelerationStructureKHR> as_writes(as_states.size());
+    for (uint32_t binding = 0; binding < as_states.size(); binding++) {
+        if (as_states[binding] != DESCRIPTOR_DIRTY) continue;
+
+        as_writes[binding].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET_ACCELERATION_STRUCTURE_KHR;
+        as_writes[binding].accelerationStructureCount = 1;
+        as_writes[binding].pAccelerationStructures = &acceleration_structures[binding];
+
+        VkWriteDescriptorSet write{};
+        write.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+        write.dstSet = descriptor_set_as;
+        write.dstBinding = binding;
+        write.dstArrayElement = 0;
+        write.descriptorType = VK_DESCRIPTOR_TYPE_ACCELERATION_STRUCTURE_KHR;
+        write.descriptorCount = 1;
+        write.pNext = &as_writes[binding];
+        writes.push_back(write);
     }
 
+    if (!writes.empty()) vkUpdateDescriptorSets(device->vulkan_device, (uint32_t)writes.size(), writes.data(), 0, nullptr);
 
-    std::vector<VkDescriptorSetLayoutBinding> image_layout_bindings;
+    for (auto* states : {&buffer_states, &image_states, &as_states}) {
+        for (auto& state : *states) {
+            if (state == DESCRIPTOR_DIRTY) state = DESCRIPTOR_WRITTEN;
+        }
+    }
+}
 
-    for (int i = 0; i < image_descriptor_counts.size(); i++) {
-        VkDescriptorSetLayoutBinding layout_binding;
-        layout_binding.stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
-        layout_binding.binding = i;
-        layout_binding.descriptorCount = image_descriptor_counts[i];
-        layout_binding.descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
-        layout_binding.pImmutableSamplers = nullptr;
-        image_layout_bindings.push_back(layout_binding);
+// one entry per binding, array elements are consecutive in the shadow copy
+static VkDescriptorUpdateTemplate create_update_template(VkDevice device, VkDescriptorSetLayout layout, VkDescriptorType type, const std::vector<uint32_t>& counts, const std::vector<uint32_t>& offsets, size_t stride) {
+    std::vector<VkDescriptorUpdateTemplateEntry> entries;
+    for (uint32_t binding = 0; binding < counts.size(); binding++) {
+        if (counts[binding] == 0) continue;
+        VkDescriptorUpdateTemplateEntry entry{};
+        entry.dstBinding = binding;
+        entry.dstArrayElement = 0;
+        entry.descriptorCount = counts[binding];
+        entry.descriptorType = type;
+        entry.offset = offsets[binding] * stride;
+        entry.stride = stride;
+        entries.push_back(entry);
+    }
+    if (entries.empty()) return VK_NULL_HANDLE;
+
+    VkDescriptorUpdateTemplateCreateInfo template_info{};
+    template_info.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_UPDATE_TEMPLATE_CREATE_INFO;
+    template_info.descriptorUpdateEntryCount = (uint32_t)entries.size();
+    template_info.pDescriptorUpdateEntries = entries.data();
+    template_info.templateType = VK_DESCRIPTOR_UPDATE_TEMPLATE_TYPE_DESCRIPTOR_SET;
+    template_info.descriptorSetLayout = layout;
+
+    VkDescriptorUpdateTemplate update_template;
+    if (vkCreateDescriptorUpdateTemplate(device, &template_info, nullptr, &update_template) != VK_SUCCESS) {
+        throw std::runtime_error("error creating descriptor update template");
     }
+    return update_template;
+}
 
-    std::vector<VkDescriptorSetLayoutBinding> as_layout_bindings;
+// offsets of each binding's first element in a shadow copy, returns the total element count
+static uint32_t get_shadow_offsets(const std::vector<uint32_t>& counts, std::vector<uint32_t>& offsets) {
+    uint32_t total = 0;
+    offsets.resize(counts.size());
+    for (size_t binding = 0; binding < counts.size(); binding++) {
+        offsets[binding] = total;
+        total += counts[binding];
+    }
+    return total;
+}
 
-    for (int i = 0; i < as_descriptor_count; i++) {
-        VkDescriptorSetLayoutBinding layout_binding;
-        layout_binding.stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
-        layout_binding.binding = i;
-        layout_binding.descriptorCount = 1;
-        layout_binding.descriptorType = VK_DESCRIPTOR_TYPE_ACCELERATION_STRUCTURE_KHR;
-        as_layout_bindings.push_back(layout_binding);
+// descriptor counts per set and binding of a compiled compute shader, 0 for bindings the shader does not declare
+struct ComputeShaderLayout {
+    uint32_t local_size_x, local_size_y, local_size_z;
+    std::array<std::vector<uint32_t>, 3> descriptor_counts;
+};
+
+// each set holds a single kind of descriptor
+static VkDescriptorType get_set_descriptor_type(uint32_t set) {
+    switch (set) {
+    case DESCRIPTOR_SET_BUFFERS: return VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+    case DESCRIPTOR_SET_IMAGES: return VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+    default: return VK_DESCRIPTOR_TYPE_ACCELERATION_STRUCTURE_KHR;
     }
+}
 
-    VkDescriptorSetLayoutCreateInfo descriptor_set_layout_create_info{};
-    descriptor_set_layout_create_info.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
-    descriptor_set_layout_create_info.bindingCount = buffer_layout_bindings.size();
-    descriptor_set_layout_create_info.pBindings = buffer_layout_bindings.data();
+static ComputeShaderLayout reflect_compute_shader(std::filesystem::path compiled_shader_path, std::string code_path) {
+    loaders::ShaderReflection reflection = loaders::reflect_spirv(loaders::read_spirv(compiled_shader_path.string()));
 
-    vkCreateDescriptorSetLayout(device->vulkan_device, &descriptor_set_layout_create_info, nullptr, &descriptor_set_layout_buffers);
+    ComputeShaderLayout layout;
+    layout.local_size_x = reflection.local_size_x;
+    layout.local_size_y = reflection.local_size_y;
+    layout.local_size_z = reflection.local_size_z;
 
-    descriptor_set_layout_create_info.bindingCount = image_layout_bindings.size();
-    descriptor_set_layout_create_info.pBindings = image_layout_bindings.data();
+    for (auto& binding : reflection.bindings) {
+        if (binding.set > DESCRIPTOR_SET_ACCELERATION_STRUCTURES || binding.type != get_set_descriptor_type(binding.set)) {
+            throw std::runtime_error("unsupported descriptor in set " + std::to_string(binding.set) + ", binding " + std::to_string(binding.binding) + " of compute shader " + code_path);
+        }
 
-    vkCreateDescriptorSetLayout(device->vulkan_device, &descriptor_set_layout_create_info, nullptr, &descriptor_set_layout_images);
+        // runtime sized descriptor arrays are bound with a fixed size
+        uint32_t count = binding.count == 0 ? 16 : binding.count;
 
-    descriptor_set_layout_create_info.bindingCount = as_layout_bindings.size();
-    descriptor_set_layout_create_info.pBindings = as_layout_bindings.data();
+        auto& counts = layout.descriptor_counts[binding.set];
+        if (counts.size() <= binding.binding) counts.resize(binding.binding + 1, 0);
+        counts[binding.binding] = count;
+    }
 
-    vkCreateDescriptorSetLayout(device->vulkan_device, &descriptor_set_layout_create_info, nullptr, &descriptor_set_layout_as);
+    return layout;
+}
 
-    VkDescriptorPoolSize pool_size_buffers{};
-    pool_size_buffers.type = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
-    pool_size_buffers.descriptorCount = 0;
-    for (auto count : buffer_descriptor_counts) pool_size_buffers.descriptorCount += count;
-    if (pool_size_buffers.descriptorCount < 1) pool_size_buffers.descriptorCount = 1;
+void ComputeShader::build() {
+    PROFILE_ZONE_DETAIL("ComputeShader::build", code_path);
+    std::filesystem::path compiled_shader_path = compile_shader(code_path);
 
-    VkDescriptorPoolSize pool_size_images{};
-    pool_size_images.type = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
-    pool_size_images.descriptorCount = 0;
-    for (auto count : image_descriptor_counts) pool_size_images.descriptorCount += count;
-    if (pool_size_images.descriptorCount < 1) pool_size_images.descriptorCount = 1;
+    // workgroup size and descriptors are read from the compiled module
+    ComputeShaderLayout reflected_layout = reflect_compute_shader(compiled_shader_path, code_path);
+    local_dispatch_size_x = reflected_layout.local_size_x;
+    local_dispatch_size_y = reflected_layout.local_size_y;
+    local_dispatch_size_z = reflected_layout.local_size_z;
+    buffer_descriptor_counts = reflected_layout.descriptor_counts[DESCRIPTOR_SET_BUFFERS];
+    image_descriptor_counts = reflected_layout.descriptor_counts[DESCRIPTOR_SET_IMAGES];
+    as_descriptor_counts = reflected_layout.descriptor_counts[DESCRIPTOR_SET_ACCELERATION_STRUCTURES];
+
+    std::array<VkDescriptorSetLayout, 3> set_layouts;
+    std::array<uint32_t, 3> set_descriptor_counts = {};
+    for (uint32_t set = 0; set < set_layouts.size(); set++) {
+        std::vector<VkDescriptorSetLayoutBinding> layout_bindings;
+        auto& counts = reflected_layout.descriptor_counts[set];
+        for (uint32_t binding = 0; binding < counts.size(); binding++) {
+            if (counts[binding] == 0) continue;
+            VkDescriptorSetLayoutBinding layout_binding{};
+            layout_binding.stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+            layout_binding.binding = binding;
+            layout_binding.descriptorCount = counts[binding];
+            layout_binding.descriptorType = get_set_descriptor_type(set);
+            layout_binding.pImmutableSamplers = nullptr;
+            layout_bindings.push_back(layout_binding);
+            set_descriptor_counts[set] += counts[binding];
+        }
+        // shared between all shaders with identical bindings
+        set_layouts[set] = device->get_descriptor_set_layout(layout_bindings);
+    }
+    descriptor_set_layout_buffers = set_layouts[DESCRIPTOR_SET_BUFFERS];
+    descriptor_set_layout_images = set_layouts[DESCRIPTOR_SET_IMAGES];
+    descriptor_set_layout_as = set_layouts[DESCRIPTOR_SET_ACCELERATION_STRUCTURES];
 
-    VkDescriptorPoolSize pool_size_as{};
-    pool_size_as.type = VK_DESCRIPTOR_TYPE_ACCELERATION_STRUCTURE_KHR;
-    pool_size_as.descriptorCount = as_descriptor_count;
-    if (pool_size_as.descriptorCount < 1) pool_size_as.descriptorCount = 1;
+    std::cout << "compute shader " << code_path << ": group size " << local_dispatch_size_x << ", " << local_dispatch_size_y << ", " << local_dispatch_size_z << " | " << set_descriptor_counts[DESCRIPTOR_SET_BUFFERS] << " buffers, " << set_descriptor_counts[DESCRIPTOR_SET_IMAGES] << " images, " << set_descriptor_counts[DESCRIPTOR_SET_ACCELERATION_STRUCTURES] << " acceleration structures" << std::endl;
 
-    VkDescriptorPoolSize pool_sizes[] = {
-        pool_size_buffers,
-        pool_size_images,
-        pool_size_as
-    };
+    // pool sizes follow the reflected descriptor counts
+    VkDescriptorPoolSize pool_sizes[3];
+    for (uint32_t set = 0; set < 3; set++) {
+        pool_sizes[set].type = get_set_descriptor_type(set);
+        pool_sizes[set].descriptorCount = std::max(set_descriptor_counts[set], 1u);
+    }
 
     VkDescriptorPoolCreateInfo descriptor_pool_create_info{};
     descriptor_pool_create_info.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
@@ -259,6 +317,18 @@ void ComputeShader::build() {
     descriptor_set_images = descriptor_sets[DESCRIPTOR_SET_IMAGES];
     descriptor_set_as = descriptor_sets[DESCRIPTOR_SET_ACCELERATION_STRUCTURES];
 
+    // descriptor writes go to shadow copies and are applied before the next dispatch
+    buffer_infos.assign(get_shadow_offsets(buffer_descriptor_counts, buffer_info_offsets), VkDescriptorBufferInfo{});
+    buffer_states.assign(buffer_infos.size(), DESCRIPTOR_UNWRITTEN);
+    image_infos.assign(get_shadow_offsets(image_descriptor_counts, image_info_offsets), VkDescriptorImageInfo{});
+    image_states.assign(image_infos.size(), DESCRIPTOR_UNWRITTEN);
+    acceleration_structures.assign(as_descriptor_counts.size(), VK_NULL_HANDLE);
+    as_states.assign(as_descriptor_counts.size(), DESCRIPTOR_UNWRITTEN);
+    descriptors_dirty = false;
+
+    buffer_update_template = create_update_template(device->vulkan_device, descriptor_set_layout_buffers, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, buffer_descriptor_counts, buffer_info_offsets, sizeof(VkDescriptorBufferInfo));
+    image_update_template = create_update_template(device->vulkan_device, descriptor_set_layout_images, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, image_descriptor_counts, image_info_offsets, sizeof(VkDescriptorImageInfo));
+
     VkPushConstantRange push_constant_range {};
     push_constant_range.offset = 0;
     push_constant_range.size = sizeof(Shaders::PushConstantsPacked);
@@ -272,20 +342,50 @@ void ComputeShader::build() {
     layout_create_info.pPushConstantRanges = &push_constant_range;
     vkCreatePipelineLayout(device->vulkan_device, &layout_create_info, nullptr, &layout);
 
+    // owned by the device and shared with all other pipelines
+    cache = device->pipeline_cache;
+
+    pipeline = create_pipeline(compiled_shader_path);
+
+    std::cout << "compute shader built" << std::endl;
+}
+
+VkPipeline ComputeShader::create_pipeline(std::filesystem::path compiled_shader_path) {
+    VkPipelineShaderStageCreateInfo stage_create_info{};
+    stage_create_info.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+    stage_create_info.stage = VK_SHADER_STAGE_COMPUTE_BIT;
+    stage_create_info.module = loaders::load_shader_module(device->vulkan_device, compiled_shader_path.string());
+    stage_create_info.pName = "main";
+
     VkComputePipelineCreateInfo pipeline_create_info{};
     pipeline_create_info.sType = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO;
     pipeline_create_info.layout = layout;
     pipeline_create_info.stage = stage_create_info;
 
-    VkPipelineCacheCreateInfo cache_create_info{};
-    cache_create_info.sType = VK_STRUCTURE_TYPE_PIPELINE_CACHE_CREATE_INFO;
-    vkCreatePipelineCache(device->vulkan_device, &cache_create_info, nullptr, &cache);
-
-    vkCreateComputePipelines(device->vulkan_device, cache, 1, &pipeline_create_info, nullptr, &pipeline);
+    VkPipeline result = VK_NULL_HANDLE;
+    VkResult err = vkCreateComputePipelines(device->vulkan_device, cache, 1, &pipeline_create_info, nullptr, &result);
 
     vkDestroyShaderModule(device->vulkan_device, stage_create_info.module, nullptr);
 
-    std::cout << "compute shader built" << std::endl;
+    if (err != VK_SUCCESS) throw std::runtime_error("error creating compute pipeline for " + code_path);
+    return result;
+}
+
+void ComputeShader::reload(std::filesystem::path compiled_shader_path) {
+    PROFILE_ZONE_DETAIL("ComputeShader::reload", code_path);
+    ComputeShaderLayout reflected_layout = reflect_compute_shader(compiled_shader_path, code_path);
+    bool layout_changed = reflected_layout.local_size_x != local_dispatch_size_x || reflected_layout.local_size_y != local_dispatch_size_y || reflected_layout.local_size_z != local_dispatch_size_z ||
+        reflected_layout.descriptor_counts[DESCRIPTOR_SET_BUFFERS] != buffer_descriptor_counts ||
+        reflected_layout.descriptor_counts[DESCRIPTOR_SET_IMAGES] != image_descriptor_counts ||
+        reflected_layout.descriptor_counts[DESCRIPTOR_SET_ACCELERATION_STRUCTURES] != as_descriptor_counts;
+    if (layout_changed) throw std::runtime_error("descriptors or group size of " + code_path + " changed, the pipeline has to be rebuilt");
+
+    VkPipeline reloaded = create_pipeline(compiled_shader_path);
+
+    // the previous pipeline might still be executing
+    vkDeviceWaitIdle(device->vulkan_device);
+    vkDestroyPipeline(device->vulkan_device, pipeline, nullptr);
+    pipeline = reloaded;
 }
 
 void ComputeShader::dispatch(VkCommandBuffer command_buffer, VkExtent2D swapchain_extent, VkExtent2D render_extent, Shaders::PushConstantsPacked &push_constants_packed) {
@@ -293,6 +393,10 @@ void ComputeShader::dispatch(VkCommandBuffer command_buffer, VkExtent2D swapchai
 }
 
 void ComputeShader::dispatch(VkCommandBuffer command_buffer, uint32_t groups_x, uint32_t groups_y, uint32_t groups_z, Shaders::PushConstantsPacked &push_constants_packed) {
+    // the sets are updated on the host while recording, without update-after-bind this is only valid because
+    // every shader is dispatched at most once per command buffer and frames are recorded after the previous submission completed
+    flush_descriptor_writes();
+
     std::array<VkDescriptorSet, 3> descriptor_sets = {
         descriptor_set_buffers,
         descriptor_set_images,
@@ -305,12 +409,10 @@ void ComputeShader::dispatch(VkCommandBuffer command_buffer, uint32_t groups_x,
 }
 
 void ComputeShader::free() {
-    vkDestroyPipelineCache(device->vulkan_device, cache, nullptr);
     vkDestroyPipeline(device->vulkan_device, pipeline, nullptr);
     vkDestroyDescriptorPool(device->vulkan_device, descriptor_pool, nullptr);
-    vkDestroyDescriptorSetLayout(device->vulkan_device, descriptor_set_layout_buffers, nullptr);
-    vkDestroyDescriptorSetLayout(device->vulkan_device, descriptor_set_layout_images, nullptr);
-    vkDestroyDescriptorSetLayout(device->vulkan_device, descriptor_set_layout_as, nullptr);
+    if (buffer_update_template != VK_NULL_HANDLE) vkDestroyDescriptorUpdateTemplate(device->vulkan_device, buffer_update_template, nullptr);
+    if (image_update_template != VK_NULL_HANDLE) vkDestroyDescriptorUpdateTemplate(device->vulkan_device, image_update_template, nullptr);
     vkDestroyPipelineLayout(device->vulkan_device, layout, nullptr);
 }
 
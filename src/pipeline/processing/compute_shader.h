@@ -5,6 +5,8 @@
 #include "shader_interface.h"
 
 #include <string>
+#include <vector>
+#include <filesystem>
 
 struct Device;
 
@@ -19,21 +21,43 @@ struct ComputeShader {
     VkPipelineCache cache;
 
     VkPipelineLayout layout;
-    uint8_t local_dispatch_size_x, local_dispatch_size_y, local_dispatch_size_z;
-    std::vector<uint8_t> buffer_descriptor_counts, image_descriptor_counts;
-    uint8_t as_descriptor_count;
+    uint32_t local_dispatch_size_x, local_dispatch_size_y, local_dispatch_size_z;
+    // descriptor count per binding, reflected from the compiled shader (0 = binding unused)
+    std::vector<uint32_t> buffer_descriptor_counts, image_descriptor_counts, as_descriptor_counts;
 
     std::string code_path;
 
+    // descriptor writes are cached and applied in a single update before the next dispatch, unchanged descriptors are skipped
     void set_image(int index, Image* image, int array_index = 0);
     void set_images(int index, std::vector<Image>* images);
     void set_buffer(int index, Buffer* buffer, int array_index = 0);
     void set_acceleration_structure(int index, VkAccelerationStructureKHR acceleration_structure);
+    // forces the next writes of all descriptors, call when bound resources were recreated
+    void invalidate_descriptors();
 
     void build();
+    // replaces the pipeline with a recompiled module, throws if descriptors or group size changed
+    void reload(std::filesystem::path compiled_shader_path);
+    // applies cached descriptor writes to the shader's only descriptor sets, so a shader may be dispatched at most once per command buffer
+    // and only while no earlier submission that uses it is in flight
     void dispatch(VkCommandBuffer command_buffer, VkExtent2D swapchain_extent, VkExtent2D render_extent, Shaders::PushConstantsPacked &push_constants_packed);
     void dispatch(VkCommandBuffer command_buffer, uint32_t groups_x, uint32_t groups_y, uint32_t groups_z, Shaders::PushConstantsPacked &push_constants_packed);
     void free();
 
     ComputeShader(Device* device, std::string code_path);
+
+    private:
+    // shadow copies of all descriptors, array elements of a binding are consecutive
+    std::vector<VkDescriptorBufferInfo> buffer_infos;
+    std::vector<VkDescriptorImageInfo> image_infos;
+    std::vector<VkAccelerationStructureKHR> acceleration_structures;
+    std::vector<uint32_t> buffer_info_offsets, image_info_offsets;
+    std::vector<uint8_t> buffer_states, image_states, as_states;
+    bool descriptors_dirty = false;
+
+    VkDescriptorUpdateTemplate buffer_update_template = VK_NULL_HANDLE;
+    VkDescriptorUpdateTemplate image_update_template = VK_NULL_HANDLE;
+
+    void flush_descriptor_writes();
+    VkPipeline create_pipeline(std::filesystem::path compiled_shader_path);
 };
\ No newline at end of file
@@ -18,7 +18,9 @@ ProcessingPipelineBuilder Device::create_processing_pipeline_builder() {
 
 void ProcessingPipeline::run(VkCommandBuffer command_buffer, VkExtent2D swapchain_extent, VkExtent2D render_extent, Shaders::PushConstantsPacked &push_constants_packed) {
     for (auto stage: builder->stages) {
+        device->gpu_profiler.cmd_begin_zone(command_buffer, stage->get_name());
         stage->process(command_buffer, swapchain_extent, render_extent, push_constants_packed);
+        device->gpu_profiler.cmd_end_zone(command_buffer);
     }
 }
 
@@ -50,6 +52,11 @@ Buffer ProcessingPipelineBuilder::create_buffer(uint32_t size) {
 }
 
 void ProcessingPipelineBuilder::cmd_on_resize(VkCommandBuffer command_buffer, VkExtent2D swapchain_extent, VkExtent2D render_extent) {
+    // recreated buffers can reuse previous handles
+    for (auto created_compute_shader: created_compute_shaders) {
+        created_compute_shader->invalidate_descriptors();
+    }
+
     for (auto stage: stages) {
         stage->on_resize(swapchain_extent, render_extent);
     }
@@ -65,6 +72,24 @@ void ProcessingPipelineBuilder::cmd_on_resize(VkCommandBuffer command_buffer, Vk
     }
 }
 
+void ProcessingPipelineBuilder::on_scene_changed() {
+    for (auto created_compute_shader: created_compute_shaders) {
+        created_compute_shader->invalidate_descriptors();
+    }
+
+    for (auto stage: stages) {
+        stage->on_scene_changed();
+    }
+}
+
+std::vector<std::string> ProcessingPipelineBuilder::get_required_outputs() {
+    std::vector<std::string> outputs;
+    for (auto stage: stages) {
+        for (auto& output: stage->get_required_outputs()) outputs.push_back(output);
+    }
+    return outputs;
+}
+
 ProcessingPipelineBuilder ProcessingPipelineBuilder::with_stage(std::shared_ptr<ProcessingPipelineStage> stage) {
     std::cout << "adding stage" << std::endl;
     stages.push_back(stage);
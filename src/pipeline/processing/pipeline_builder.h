@@ -52,6 +52,8 @@ struct ProcessingPipelineBuilder {
     ProcessingPipelineBuilder with_stage(std::shared_ptr<ProcessingPipelineStage> stage);
 
     void cmd_on_resize(VkCommandBuffer command_buffer, VkExtent2D swapchain_extent, VkExtent2D render_extent);
+    void on_scene_changed();
+    std::vector<std::string> get_required_outputs();
     ProcessingPipeline build();
 
     void free_stage_resources();
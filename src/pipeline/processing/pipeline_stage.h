@@ -3,6 +3,9 @@
 #include "core/vulkan.h"
 #include "shader_interface.h"
 
+#include <string>
+#include <vector>
+
 struct ProcessingPipelineBuilder;
 
 // single processing pipeline stage
@@ -10,12 +13,21 @@ struct ProcessingPipelineBuilder;
 struct ProcessingPipelineStage {
     ProcessingPipelineBuilder* builder;
 
+    // display name, used for profiling zones
+    virtual std::string get_name() = 0;
+
     // called when renderer is resized
     virtual void on_resize(VkExtent2D swapchain_extent, VkExtent2D render_extent) = 0;
 
     // allocate data buffers, perform processor initialization
     virtual void initialize() = 0;
 
+    // called when scene data (acceleration structure, mesh and material buffers) was replaced
+    virtual void on_scene_changed() {}
+
+    // names of raytracing output buffers read by this stage
+    virtual std::vector<std::string> get_required_outputs() { return {}; }
+
     // perform processing step
     virtual void process(VkCommandBuffer command_buffer, VkExtent2D swapchain_extent, VkExtent2D render_extent, Shaders::PushConstantsPacked &push_constants_packed) = 0;
 
@@ -12,6 +12,8 @@ struct ProcessingPipelineStageOIDN : ProcessingPipelineStage {
     OIDNFilter oidn_filter;
     OIDNBuffer oidn_buffer, oidn_buffer_albedo, oidn_buffer_normal;
 
+    std::string get_name() override { return "OIDN"; }
+    std::vector<std::string> get_required_outputs() override { return {"Result Image", "Albedo", "Normals"}; }
     void initialize() override;
     void on_resize(VkExtent2D swapchain_extent, VkExtent2D render_extent) override;
     void process(VkCommandBuffer command_buffer, VkExtent2D swapchain_extent, VkExtent2D render_extent, Shaders::PushConstantsPacked &push_constants_packed) override;
@@ -8,7 +8,7 @@
 
 #include <iostream>
 
-ProcessingPipelineStageRestir::ProcessingPipelineStageRestir(VkAccelerationStructureKHR acceleration_structure, Buffer* indices, Buffer* vertices, Buffer* normals, Buffer* texcoords, Buffer* tangents, Buffer* mesh_data_offsets, Buffer* mesh_offset_indices, std::vector<Image>* loaded_textures, Buffer* texture_indices, Buffer* material_parameters, Buffer* lights, Buffer* previous_camera_data) {
+ProcessingPipelineStageRestir::ProcessingPipelineStageRestir(VkAccelerationStructureKHR* acceleration_structure, Buffer* indices, Buffer* vertices, Buffer* normals, Buffer* texcoords, Buffer* tangents, Buffer* mesh_data_offsets, Buffer* mesh_offset_indices, std::vector<Image>* loaded_textures, Buffer* texture_indices, Buffer* material_parameters, Buffer* lights, Buffer* light_tree, Buffer* light_distributions, Buffer* previous_camera_data) {
     this->acceleration_structure = acceleration_structure;
     this->indices = indices;
     this->vertices = vertices;
@@ -21,6 +21,8 @@ ProcessingPipelineStageRestir::ProcessingPipelineStageRestir(VkAccelerationStruc
     this->texture_indices = texture_indices;
     this->material_parameters = material_parameters;
     this->lights = lights;
+    this->light_tree = light_tree;
+    this->light_distributions = light_distributions;
     this->previous_camera_data = previous_camera_data;
 }
 
@@ -31,8 +33,12 @@ void ProcessingPipelineStageRestir::initialize() {
     compute_shader_spatial = builder->create_compute_shader("./shaders/processing/restir_spatial.comp");
     compute_shader_spatial->build();
 
+    on_scene_changed();
+}
+
+void ProcessingPipelineStageRestir::on_scene_changed() {
     // set shader variables (initial and temporal resampling)
-    compute_shader_initial_temporal->set_acceleration_structure(0, acceleration_structure);
+    compute_shader_initial_temporal->set_acceleration_structure(0, *acceleration_structure);
     compute_shader_initial_temporal->set_buffer(3, lights);
     compute_shader_initial_temporal->set_buffer(4, indices);
     compute_shader_initial_temporal->set_buffer(5, vertices);
@@ -44,9 +50,12 @@ void ProcessingPipelineStageRestir::initialize() {
     compute_shader_initial_temporal->set_buffer(11, texture_indices);
     compute_shader_initial_temporal->set_images(0, loaded_textures);
     compute_shader_initial_temporal->set_buffer(12, material_parameters);
+    compute_shader_initial_temporal->set_buffer(13, previous_camera_data);
+    compute_shader_initial_temporal->set_buffer(14, light_tree);
+    compute_shader_initial_temporal->set_buffer(15, light_distributions);
 
     // set shader variables (spatial resampling)
-    compute_shader_spatial->set_acceleration_structure(0, acceleration_structure);
+    compute_shader_spatial->set_acceleration_structure(0, *acceleration_structure);
     compute_shader_spatial->set_buffer(3, lights);
     compute_shader_spatial->set_buffer(4, indices);
     compute_shader_spatial->set_buffer(5, vertices);
@@ -58,9 +67,15 @@ void ProcessingPipelineStageRestir::initialize() {
     compute_shader_spatial->set_buffer(11, texture_indices);
     compute_shader_spatial->set_images(0, loaded_textures);
     compute_shader_spatial->set_buffer(12, material_parameters);
+    compute_shader_spatial->set_buffer(14, light_tree);
+    compute_shader_spatial->set_buffer(15, light_distributions);
 }
 
 void ProcessingPipelineStageRestir::on_resize(VkExtent2D swapchain_extent, VkExtent2D render_extent) {
+    Buffer* image_buffer = &builder->rt_pipeline->get_output_buffer("Result Image").buffer;
+    compute_shader_initial_temporal->set_buffer(0, image_buffer);
+    compute_shader_spatial->set_buffer(0, image_buffer);
+
     // required AOVs
     compute_shader_initial_temporal->set_buffer(1, &builder->rt_pipeline->get_output_buffer("Instance Indices").buffer, 0);
     compute_shader_initial_temporal->set_buffer(1, &builder->rt_pipeline->get_output_buffer("Position").buffer, 1);
@@ -82,13 +97,11 @@ void ProcessingPipelineStageRestir::on_resize(VkExtent2D swapchain_extent, VkExt
 }
 
 void ProcessingPipelineStageRestir::process(VkCommandBuffer command_buffer, VkExtent2D swapchain_extent, VkExtent2D render_extent, Shaders::PushConstantsPacked &push_constants_packed) {
-    Buffer* image_buffer = &builder->rt_pipeline->get_output_buffer("Result Image").buffer;
-    compute_shader_initial_temporal->set_buffer(0, image_buffer);
-    compute_shader_initial_temporal->set_buffer(13, previous_camera_data);
+    GPUProfiler& profiler = builder->device->gpu_profiler;
 
-    compute_shader_spatial->set_buffer(0, image_buffer);
-    
+    profiler.cmd_begin_zone(command_buffer, "ReSTIR Initial/Temporal");
     compute_shader_initial_temporal->dispatch(command_buffer, swapchain_extent, render_extent, push_constants_packed);
+    profiler.cmd_end_zone(command_buffer);
 
     VkBufferMemoryBarrier barrier {};
     barrier.sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER;
@@ -99,9 +112,11 @@ void ProcessingPipelineStageRestir::process(VkCommandBuffer command_buffer, VkEx
 
     vkCmdPipelineBarrier(command_buffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, 0, 0, nullptr, 1, &barrier, 0, nullptr);
 
+    profiler.cmd_begin_zone(command_buffer, "ReSTIR Spatial");
     compute_shader_spatial->dispatch(command_buffer, swapchain_extent, render_extent, push_constants_packed);
+    profiler.cmd_end_zone(command_buffer);
 
-    builder->image_buffer = image_buffer;
+    builder->image_buffer = &builder->rt_pipeline->get_output_buffer("Result Image").buffer;
     builder->image_extent = render_extent;
 }
 
@@ -9,6 +9,7 @@ struct ProcessingPipelineStageUpscale : ProcessingPipelineStage {
     Buffer output_buffer;
     ComputeShader* compute_shader;
 
+    std::string get_name() override { return "Upscale"; }
     void initialize();
     void on_resize(VkExtent2D swapchain_extent, VkExtent2D render_extent);
     void process(VkCommandBuffer command_buffer, VkExtent2D swapchain_extent, VkExtent2D render_extent, Shaders::PushConstantsPacked &push_constants_packed) override;
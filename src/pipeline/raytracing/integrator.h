@@ -0,0 +1,33 @@
+#pragma once
+
+#include <string>
+#include <stdexcept>
+
+// algorithm tracing the paths of a frame, all integrators share outputs, descriptors and push constants
+enum class Integrator {
+    // ray generation shader tracing all bounces of a pixel, hits are shaded in closest hit shaders
+    RaytracingPipeline,
+    // compute kernels advancing the paths of all pixels one bounce at a time through queues in device memory
+    Wavefront,
+    // single compute kernel tracing all bounces of a pixel with ray queries and shading hits inline
+    Megakernel,
+};
+
+const Integrator INTEGRATORS[] = {Integrator::RaytracingPipeline, Integrator::Wavefront, Integrator::Megakernel};
+
+// name used by the inspector, batch files and the command line
+inline const char* get_integrator_name(Integrator integrator) {
+    switch (integrator) {
+        case Integrator::RaytracingPipeline: return "pipeline";
+        case Integrator::Wavefront: return "wavefront";
+        case Integrator::Megakernel: return "megakernel";
+    }
+    return "unknown";
+}
+
+inline Integrator parse_integrator(const std::string& name) {
+    for (Integrator integrator : INTEGRATORS) {
+        if (name == get_integrator_name(integrator)) return integrator;
+    }
+    throw std::runtime_error("unknown integrator " + name);
+}
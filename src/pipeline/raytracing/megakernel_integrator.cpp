@@ -0,0 +1,60 @@
+#include "megakernel_integrator.h"
+
+#include "core/device.h"
+#include "core/cpu_profiler.h"
+#include "shader_compiler.h"
+
+static const std::string kernel_code_path = "./shaders/raytracing/megakernel/trace_paths.comp";
+
+void MegakernelIntegrator::build(Device* device, RaytracingPipelineBuilder* builder) {
+    PROFILE_ZONE("build megakernel integrator");
+    this->device = device;
+    this->builder = builder;
+
+    free();
+    compiled_path = compile_shader(kernel_code_path);
+    pipeline = builder->create_compute_pipeline(compiled_path);
+}
+
+VkPipeline MegakernelIntegrator::get_pipeline(const RaytracingPipelineSettings* settings) {
+    if (settings == nullptr) return pipeline;
+    auto variant = variants.find(*settings);
+    if (variant == variants.end()) {
+        PROFILE_ZONE("create megakernel variant");
+        variant = variants.emplace(*settings, builder->create_compute_pipeline(compiled_path, settings)).first;
+    }
+    return variant->second;
+}
+
+void MegakernelIntegrator::cmd_render(VkCommandBuffer command_buffer, Shaders::PushConstantsPacked& push_constants_packed, VkExtent2D render_extent, const RaytracingPipelineSettings* settings) {
+    VkPipeline pipeline_handle = get_pipeline(settings);
+
+    vkCmdPushConstants(command_buffer, builder->pipeline_layout, RAYTRACING_PIPELINE_LAYOUT_STAGES, 0, sizeof(Shaders::PushConstantsPacked), &push_constants_packed);
+    vkCmdBindDescriptorSets(command_buffer, VK_PIPELINE_BIND_POINT_COMPUTE, builder->pipeline_layout, 0, builder->max_set + 1, builder->descriptor_sets.data(), 0, nullptr);
+    vkCmdBindPipeline(command_buffer, VK_PIPELINE_BIND_POINT_COMPUTE, pipeline_handle);
+
+    // outputs of the previous frame are read and written
+    VkMemoryBarrier barrier {};
+    barrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+    barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT | VK_ACCESS_SHADER_WRITE_BIT;
+    barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT;
+    vkCmdPipelineBarrier(command_buffer, VK_PIPELINE_STAGE_TRANSFER_BIT | VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, 0, 1, &barrier, 0, nullptr, 0, nullptr);
+
+    device->gpu_profiler.cmd_begin_zone(command_buffer, "Megakernel");
+    uint32_t groups_x = (render_extent.width + MEGAKERNEL_GROUP_SIZE - 1) / MEGAKERNEL_GROUP_SIZE;
+    uint32_t groups_y = (render_extent.height + MEGAKERNEL_GROUP_SIZE - 1) / MEGAKERNEL_GROUP_SIZE;
+    vkCmdDispatch(command_buffer, groups_x, groups_y, 1);
+    device->gpu_profiler.cmd_end_zone(command_buffer);
+}
+
+bool MegakernelIntegrator::depends_on(const std::vector<std::filesystem::path>& files) {
+    return shader_depends_on(kernel_code_path, files);
+}
+
+void MegakernelIntegrator::free() {
+    if (device == nullptr) return;
+    if (pipeline != VK_NULL_HANDLE) vkDestroyPipeline(device->vulkan_device, pipeline, nullptr);
+    pipeline = VK_NULL_HANDLE;
+    for (auto& variant : variants) vkDestroyPipeline(device->vulkan_device, variant.second, nullptr);
+    variants.clear();
+}
@@ -0,0 +1,37 @@
+#pragma once
+
+#include "core/vulkan.h"
+#include "shader_interface.h"
+#include "pipeline/raytracing/pipeline_builder.h"
+
+#include <vector>
+#include <unordered_map>
+#include <filesystem>
+
+struct Device;
+
+// path tracer in a single compute kernel that traces all bounces of a pixel with ray queries
+// hits are shaded inline, so no shader binding table or ray recursion is involved
+// the kernel binds the layout, descriptor sets and push constants of the raytracing pipeline
+struct MegakernelIntegrator {
+    Device* device = nullptr;
+    RaytracingPipelineBuilder* builder = nullptr;
+
+    // compiles the kernel, call after the raytracing pipeline was built
+    void build(Device* device, RaytracingPipelineBuilder* builder);
+    // traces all samples of a frame and accumulates them into the outputs
+    // with settings, a kernel specialized for them is used, it is created on first use
+    void cmd_render(VkCommandBuffer command_buffer, Shaders::PushConstantsPacked& push_constants_packed, VkExtent2D render_extent, const RaytracingPipelineSettings* settings = nullptr);
+    // the generic kernel without settings, otherwise the variant for them, created if it does not exist yet
+    VkPipeline get_pipeline(const RaytracingPipelineSettings* settings = nullptr);
+
+    // hot reload: true if the kernel uses one of the files
+    bool depends_on(const std::vector<std::filesystem::path>& files);
+
+    void free();
+
+    private:
+    std::filesystem::path compiled_path;
+    VkPipeline pipeline = VK_NULL_HANDLE;
+    std::unordered_map<RaytracingPipelineSettings, VkPipeline, RaytracingPipelineSettings::Hash> variants;
+};
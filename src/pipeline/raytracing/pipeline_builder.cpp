@@ -6,10 +6,12 @@
 #include "shader_compiler.h"
 #include "loaders/shader_spirv.h"
 #include "shader_interface.h"
+#include "core/cpu_profiler.h"
 
 #include "pipeline/raytracing/pipeline_stage_simple.h"
 
 #include <iostream>
+#include <array>
 #include <unordered_set>
 #include <sstream>
 #include <filesystem>
@@ -33,6 +35,33 @@ vec3 OutputBuffer::get_color(uint32_t pixel_index) {
     return result;
 }
 
+std::vector<vec4> OutputBuffer::get_colors(size_t pixel_count) {
+    std::vector<vec4> result(pixel_count);
+    if (format == OUTPUT_FORMAT_RGBA32F) {
+        buffer.get_data(result.data(), 0, pixel_count * sizeof(vec4));
+        return result;
+    }
+
+    std::vector<uint32_t> packed(pixel_count * entry_size / sizeof(uint32_t));
+    buffer.get_data(packed.data(), 0, packed.size() * sizeof(uint32_t));
+    for (size_t i = 0; i < pixel_count; i++) {
+        if (format == OUTPUT_FORMAT_RGBA16F) {
+            result[i] = vec4(glm::unpackHalf2x16(packed[i * 2]), glm::unpackHalf2x16(packed[i * 2 + 1]));
+        } else {
+            result[i] = glm::unpackUnorm4x8(packed[i]);
+        }
+    }
+    return result;
+}
+
+static size_t get_output_format_size(uint32_t format) {
+    switch (format) {
+        case OUTPUT_FORMAT_RGBA16F: return sizeof(uint16_t) * 4;
+        case OUTPUT_FORMAT_RGBA8: return sizeof(uint8_t) * 4;
+        default: return sizeof(float) * 4;
+    }
+}
+
 void RaytracingPipelineBuilder::add_stage(std::shared_ptr<RaytracingPipelineStage> stage) {
     auto insert_position = shader_stages.begin();
     auto stage_flag = stage->get_shader_stage();
@@ -68,8 +97,10 @@ void RaytracingPipelineBuilder::add_descriptor(std::string name, uint32_t set, u
 }
 
 // adds the specified image to the pipelines' output images
+// format: storage format of one entry, packed formats are unpacked on display and export
 // hidden: hide in display selection UI
-void RaytracingPipelineBuilder::add_output_buffer(std::string name, size_t entry_size, bool hidden, bool exportable) {
+// required: allocated regardless of requested outputs
+void RaytracingPipelineBuilder::add_output_buffer(std::string name, uint32_t format, bool hidden, bool exportable, bool required) {
     if (name.empty()) {
         std::cerr << "unnamed output images are not allowed" << std::endl;
         exit(1);
@@ -77,29 +108,58 @@ void RaytracingPipelineBuilder::add_output_buffer(std::string name, size_t entry
 
     output_buffers.push_back(RaytracingPipelineBuilderOutputBuffer {
         name,
-        entry_size,
+        format,
         hidden,
-        exportable
+        exportable,
+        required
     });
 }
 
+bool RaytracingPipelineBuilder::set_requested_outputs(std::vector<std::string> names) {
+    if (output_buffers.size() > 32) throw std::runtime_error("output buffer masks are limited to 32 outputs");
+
+    uint32_t mask = 0;
+    for (uint32_t i = 0; i < output_buffers.size(); i++) {
+        if (output_buffers[i].required) mask |= 1u << i;
+        for (auto& name : names) {
+            if (output_buffers[i].name == name) mask |= 1u << i;
+        }
+    }
+
+    bool changed = mask != enabled_output_mask;
+    enabled_output_mask = mask;
+    return changed;
+}
+
 RaytracingPipelineBuilder RaytracingPipelineBuilder::with_default_pipeline() {
     // framework descriptors (set 0)
     add_descriptor("acceleration_structure", DESCRIPTOR_SET_FRAMEWORK, DESCRIPTOR_BINDING_ACCELERATION_STRUCTURE, VK_DESCRIPTOR_TYPE_ACCELERATION_STRUCTURE_KHR, VK_SHADER_STAGE_RAYGEN_BIT_KHR | VK_SHADER_STAGE_CLOSEST_HIT_BIT_KHR);
-    add_output_buffer("Result Image", sizeof(vec4), false, true);
-    add_output_buffer("Accumulated Color");
-    add_output_buffer("Albedo", 16, false, true);
-    add_output_buffer("Normals", 16, false, true);
-    add_output_buffer("Instance Indices", sizeof(vec4), true, false);
-    add_output_buffer("Instance Indices(Colored)");
+    // outputs read by processing stages or instance picking stay at full precision
+    add_output_buffer("Result Image", OUTPUT_FORMAT_RGBA32F, false, true, true);
+    add_output_buffer("Accumulated Color", OUTPUT_FORMAT_RGBA32F, false, false, true);
+    add_output_buffer("Albedo", OUTPUT_FORMAT_RGBA32F, false, true);
+    add_output_buffer("Normals", OUTPUT_FORMAT_RGBA32F, false, true);
+    add_output_buffer("Instance Indices", OUTPUT_FORMAT_RGBA32F, true, false);
+    add_output_buffer("Instance Indices(Colored)", OUTPUT_FORMAT_RGBA8);
     add_output_buffer("UV");
-    add_output_buffer("Roughness");
+    add_output_buffer("Roughness", OUTPUT_FORMAT_RGBA8);
     add_output_buffer("Position");
-    add_output_buffer("Ray Depth");
-    add_output_buffer("Environment Conditional");
-    add_output_buffer("Environment Marginal");
+    add_output_buffer("Ray Depth", OUTPUT_FORMAT_RGBA8);
+    add_output_buffer("Environment Conditional", OUTPUT_FORMAT_RGBA16F);
+    add_output_buffer("Environment Marginal", OUTPUT_FORMAT_RGBA16F);
+    add_output_buffer("Variance", OUTPUT_FORMAT_RGBA32F, false, false, true);
     add_descriptor("restir_reservoirs", DESCRIPTOR_SET_CUSTOM, DESCRIPTOR_BINDING_RESTIR_RESERVOIRS, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_RAYGEN_BIT_KHR | VK_SHADER_STAGE_CLOSEST_HIT_BIT_KHR, 2);
     add_descriptor("previous_camera_matrix", DESCRIPTOR_SET_CUSTOM, DESCRIPTOR_BINDING_PREVIOUS_CAMERA_MATRIX, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, VK_SHADER_STAGE_RAYGEN_BIT_KHR);
+    add_descriptor("adaptive_sampling", DESCRIPTOR_SET_CUSTOM, DESCRIPTOR_BINDING_ADAPTIVE_SAMPLING, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_RAYGEN_BIT_KHR);
+    // queues and path state of the wavefront integrator, only written while it is selected
+    add_descriptor("wavefront_state", DESCRIPTOR_SET_CUSTOM, DESCRIPTOR_BINDING_WAVEFRONT_STATE, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_COMPUTE_BIT);
+    add_descriptor("wavefront_paths", DESCRIPTOR_SET_CUSTOM, DESCRIPTOR_BINDING_WAVEFRONT_PATHS, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_COMPUTE_BIT);
+    add_descriptor("wavefront_rays", DESCRIPTOR_SET_CUSTOM, DESCRIPTOR_BINDING_WAVEFRONT_RAYS, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_COMPUTE_BIT, 2);
+    add_descriptor("wavefront_hits", DESCRIPTOR_SET_CUSTOM, DESCRIPTOR_BINDING_WAVEFRONT_HITS, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_COMPUTE_BIT);
+    add_descriptor("wavefront_shadow_rays", DESCRIPTOR_SET_CUSTOM, DESCRIPTOR_BINDING_WAVEFRONT_SHADOW_RAYS, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_COMPUTE_BIT);
+    add_descriptor("wavefront_sort", DESCRIPTOR_SET_CUSTOM, DESCRIPTOR_BINDING_WAVEFRONT_SORT, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_COMPUTE_BIT);
+    add_descriptor("wavefront_ray_sort", DESCRIPTOR_SET_CUSTOM, DESCRIPTOR_BINDING_WAVEFRONT_RAY_SORT, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_COMPUTE_BIT, 2);
+    add_descriptor("wavefront_ray_sort_histograms", DESCRIPTOR_SET_CUSTOM, DESCRIPTOR_BINDING_WAVEFRONT_RAY_SORT_HISTOGRAMS, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_COMPUTE_BIT);
     // object (meshes + materials + textures) descriptors (set 1)
     add_descriptor("mesh_indices", DESCRIPTOR_SET_OBJECTS, DESCRIPTOR_BINDING_MESH_INDICES, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_RAYGEN_BIT_KHR | VK_SHADER_STAGE_CLOSEST_HIT_BIT_KHR);
     add_descriptor("mesh_vertices", DESCRIPTOR_SET_OBJECTS, DESCRIPTOR_BINDING_MESH_VERTICES, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_RAYGEN_BIT_KHR | VK_SHADER_STAGE_CLOSEST_HIT_BIT_KHR);
@@ -200,41 +260,59 @@ void RaytracingPipeline::set_descriptor_buffer_binding(std::string name, Buffer&
 void RaytracingPipeline::set_descriptor_sampler_binding(std::string name, Image* images, size_t image_count) {
     DescriptorSetBinding set_binding = get_descriptor_set_binding(name);
 
-    for (int i = 0; i < 128; i++) {
-        VkWriteDescriptorSet descriptor_write_sampler{};
-        descriptor_write_sampler.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
-        descriptor_write_sampler.dstSet = builder->descriptor_sets[set_binding.set];
-        descriptor_write_sampler.dstBinding = set_binding.binding;
-        descriptor_write_sampler.dstArrayElement = i;
-        descriptor_write_sampler.descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
-        descriptor_write_sampler.descriptorCount = 1;
-
-        VkDescriptorImageInfo image_info{};
-        if (i < image_count) {
-            image_info.imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
-            image_info.imageView = images[i].view_handle;
-            image_info.sampler = images[i].sampler_handle;
-            descriptor_write_sampler.pImageInfo = &image_info;
-        } else {
-            image_info.imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
-            image_info.imageView = images[0].view_handle;
-            image_info.sampler = images[0].sampler_handle;
-            descriptor_write_sampler.pImageInfo = &image_info;
-        }
-
-        vkUpdateDescriptorSets(device->vulkan_device, 1, &descriptor_write_sampler, 0, nullptr);
+    // all array elements are written at once, unused slots repeat the first image
+    std::vector<VkDescriptorImageInfo> image_infos(128);
+    for (int i = 0; i < image_infos.size(); i++) {
+        Image& image = i < image_count ? images[i] : images[0];
+        image_infos[i].imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+        image_infos[i].imageView = image.view_handle;
+        image_infos[i].sampler = image.sampler_handle;
     }
+
+    VkWriteDescriptorSet descriptor_write_sampler{};
+    descriptor_write_sampler.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+    descriptor_write_sampler.dstSet = builder->descriptor_sets[set_binding.set];
+    descriptor_write_sampler.dstBinding = set_binding.binding;
+    descriptor_write_sampler.dstArrayElement = 0;
+    descriptor_write_sampler.descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+    descriptor_write_sampler.descriptorCount = image_infos.size();
+    descriptor_write_sampler.pImageInfo = image_infos.data();
+
+    vkUpdateDescriptorSets(device->vulkan_device, 1, &descriptor_write_sampler, 0, nullptr);
 }
 
 void RaytracingPipeline::cmd_on_resize(VkCommandBuffer command_buffer, VkExtent2D image_extent) {
     for (int i = 0; i < created_output_buffers.size(); i++) {
         created_output_buffers[i].buffer.free();
 
+        // disabled outputs keep a single entry so the descriptor stays valid
+        size_t entry_count = created_output_buffers[i].enabled ? image_extent.width * image_extent.height : 1;
         size_t entry_size = created_output_buffers[i].entry_size;
-        created_output_buffers[i].buffer = device->create_buffer(image_extent.width * image_extent.height * entry_size, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_SRC_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT, created_output_buffers[i].exportable);
-        set_descriptor_buffer_binding("outputs", created_output_buffers[i].buffer, BufferType::Storage, i); 
+        created_output_buffers[i].buffer = device->create_buffer(entry_count * entry_size, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_SRC_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT, created_output_buffers[i].exportable);
     }
 
+    if (created_output_buffers.empty()) return;
+
+    // outputs are consecutive array elements, written in a single update
+    std::vector<VkDescriptorBufferInfo> buffer_infos(created_output_buffers.size());
+    for (int i = 0; i < created_output_buffers.size(); i++) {
+        buffer_infos[i].buffer = created_output_buffers[i].buffer.buffer_handle;
+        buffer_infos[i].offset = 0;
+        buffer_infos[i].range = VK_WHOLE_SIZE;
+    }
+
+    DescriptorSetBinding set_binding = get_descriptor_set_binding("outputs");
+
+    VkWriteDescriptorSet descriptor_write_outputs{};
+    descriptor_write_outputs.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+    descriptor_write_outputs.dstSet = builder->descriptor_sets[set_binding.set];
+    descriptor_write_outputs.dstBinding = set_binding.binding;
+    descriptor_write_outputs.dstArrayElement = 0;
+    descriptor_write_outputs.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+    descriptor_write_outputs.descriptorCount = buffer_infos.size();
+    descriptor_write_outputs.pBufferInfo = buffer_infos.data();
+
+    vkUpdateDescriptorSets(device->vulkan_device, 1, &descriptor_write_outputs, 0, nullptr);
 }
 
 OutputBuffer& RaytracingPipeline::get_output_buffer(std::string name) {
@@ -242,6 +320,34 @@ OutputBuffer& RaytracingPipeline::get_output_buffer(std::string name) {
     return created_output_buffers[index];
 }
 
+bool RaytracingPipelineSettings::operator==(const RaytracingPipelineSettings& other) const {
+    return max_depth == other.max_depth && frame_samples == other.frame_samples && light_count == other.light_count && lighting_flags == other.lighting_flags;
+}
+
+size_t RaytracingPipelineSettings::Hash::operator()(const RaytracingPipelineSettings& settings) const {
+    size_t hash = 0;
+    for (uint32_t value : {settings.max_depth, settings.frame_samples, settings.light_count, settings.lighting_flags}) {
+        hash ^= std::hash<uint32_t>()(value) + 0x9e3779b9 + (hash << 6) + (hash >> 2);
+    }
+    return hash;
+}
+
+RaytracingPipelineVariant& RaytracingPipeline::get_variant(const RaytracingPipelineSettings& settings) {
+    auto variant = variants.find(settings);
+    if (variant != variants.end()) return variant->second;
+
+    std::cout << "building pipeline variant (max depth " << settings.max_depth << ", frame samples " << settings.frame_samples << ", lights " << settings.light_count << ", lighting flags " << settings.lighting_flags << ")" << std::endl;
+    return variants[settings] = builder->build_variant(settings);
+}
+
+void RaytracingPipeline::free_variants() {
+    for (auto& variant : variants) {
+        variant.second.sbt.buffer.free();
+        vkDestroyPipeline(device->vulkan_device, variant.second.pipeline_handle, nullptr);
+    }
+    variants.clear();
+}
+
 void RaytracingPipeline::free() {
     // free sbt
     sbt.buffer.free();
@@ -251,20 +357,30 @@ void RaytracingPipeline::free() {
     }
     
     vkDestroyPipeline(device->vulkan_device, pipeline_handle, nullptr);
-    vkDestroyPipelineCache(device->vulkan_device, pipeline_cache_handle, nullptr);
+    free_variants();
 }
 
 RaytracingPipeline RaytracingPipelineBuilder::build() {
+    PROFILE_ZONE("RaytracingPipelineBuilder::build");
     RaytracingPipeline result;
     result.device = device;
     result.builder = this;
 
+    if (output_buffers.size() > 32) throw std::runtime_error("output buffer masks are limited to 32 outputs");
+
+    // required outputs are enabled even if no outputs were requested
+    for (int i = 0; i < output_buffers.size(); i++) {
+        if (output_buffers[i].required) enabled_output_mask |= 1u << i;
+    }
+
     for (int i = 0; i < output_buffers.size(); i++) {
         OutputBuffer buffer;
         buffer.name = output_buffers[i].name;
         buffer.hidden = output_buffers[i].hidden;
         buffer.exportable = output_buffers[i].exportable;
-        buffer.entry_size = output_buffers[i].entry_size;
+        buffer.format = output_buffers[i].format;
+        buffer.entry_size = get_output_format_size(output_buffers[i].format);
+        buffer.enabled = (enabled_output_mask & (1u << i)) != 0;
         result.created_output_buffers.push_back(buffer);
         named_output_buffer_indices[output_buffers[i].name] = i;
     }
@@ -292,7 +408,8 @@ RaytracingPipeline RaytracingPipelineBuilder::build() {
                     descriptor_binding.binding = descriptor.binding;
                     descriptor_binding.descriptorCount = descriptor.descriptor_count;
                     descriptor_binding.descriptorType = descriptor.descriptor_type;
-                    descriptor_binding.stageFlags = descriptor.stage_flags;
+                    // compute integrators share the layout
+                    descriptor_binding.stageFlags = descriptor.stage_flags | VK_SHADER_STAGE_COMPUTE_BIT;
                     descriptor_binding.pImmutableSamplers = nullptr;
 
                     if (bound_bindings.find(descriptor.binding) == bound_bindings.end()) {
@@ -358,7 +475,7 @@ RaytracingPipeline RaytracingPipelineBuilder::build() {
         VkPushConstantRange push_constant_range{};
         push_constant_range.offset = 0;
         push_constant_range.size = sizeof(Shaders::PushConstantsPacked);
-        push_constant_range.stageFlags = VK_SHADER_STAGE_RAYGEN_BIT_KHR | VK_SHADER_STAGE_CLOSEST_HIT_BIT_KHR | VK_SHADER_STAGE_MISS_BIT_KHR;
+        push_constant_range.stageFlags = RAYTRACING_PIPELINE_LAYOUT_STAGES;
 
         VkPipelineLayoutCreateInfo pipeline_layout_info{};
         pipeline_layout_info.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
@@ -375,16 +492,148 @@ RaytracingPipeline RaytracingPipelineBuilder::build() {
         }
     }
 
+    std::cout << "Building pipeline with " << shader_stages.size() << " stages" << std::endl;
+
+    // all stages are compiled in parallel up front
+    std::vector<std::string> shader_code_paths;
+    for (auto& stage : shader_stages) shader_code_paths.push_back(stage->get_shader_code_path());
+    compiled_stage_paths = compile_shaders(shader_code_paths);
+
+    // owned by the device and shared with all other pipelines
+    result.pipeline_cache_handle = device->pipeline_cache;
+
+    RaytracingPipelineVariant generic = create_variant(nullptr);
+    result.pipeline_handle = generic.pipeline_handle;
+    result.sbt = generic.sbt;
+    result.sbt_stride = generic.sbt.region_raygen.stride;
+
+    return result;
+}
+
+RaytracingPipelineVariant RaytracingPipelineBuilder::build_variant(const RaytracingPipelineSettings& settings) {
+    PROFILE_ZONE("RaytracingPipelineBuilder::build_variant");
+    return create_variant(&settings);
+}
+
+std::vector<size_t> RaytracingPipelineBuilder::get_stages_depending_on(const std::vector<std::filesystem::path>& files) {
+    std::vector<size_t> stages;
+    for (size_t i = 0; i < shader_stages.size(); i++) {
+        if (shader_depends_on(shader_stages[i]->get_shader_code_path(), files)) stages.push_back(i);
+    }
+    return stages;
+}
+
+void RaytracingPipelineBuilder::reload_stages(RaytracingPipeline& pipeline, std::vector<size_t> stages, std::vector<std::filesystem::path> compiled_paths) {
+    PROFILE_ZONE("RaytracingPipelineBuilder::reload_stages");
+    std::vector<std::filesystem::path> previous_stage_paths = compiled_stage_paths;
+    for (size_t i = 0; i < stages.size(); i++) compiled_stage_paths[stages[i]] = compiled_paths[i];
+
+    // the pipeline keeps its layout, descriptor sets and output buffers, only pipeline and sbt are replaced
+    RaytracingPipelineVariant reloaded;
+    try {
+        reloaded = create_variant(nullptr);
+    } catch (std::exception&) {
+        compiled_stage_paths = previous_stage_paths;
+        throw;
+    }
+
+    // the previous pipeline might still be executing
+    vkDeviceWaitIdle(device->vulkan_device);
+    pipeline.sbt.buffer.free();
+    vkDestroyPipeline(device->vulkan_device, pipeline.pipeline_handle, nullptr);
+    // specialized variants still use the previous stages and are recreated on demand
+    pipeline.free_variants();
+
+    pipeline.pipeline_handle = reloaded.pipeline_handle;
+    pipeline.sbt = reloaded.sbt;
+}
+
+// constant ids are consecutive, booleans are passed as 32 bit VkBool32
+static std::array<VkSpecializationMapEntry, 8> get_specialization_entries() {
+    std::array<VkSpecializationMapEntry, 8> specialization_entries;
+    for (uint32_t i = 0; i < specialization_entries.size(); i++) {
+        specialization_entries[i].constantID = SPECIALIZATION_CONSTANT_ENABLED_OUTPUTS + i;
+        specialization_entries[i].offset = sizeof(uint32_t) * i;
+        specialization_entries[i].size = sizeof(uint32_t);
+    }
+    return specialization_entries;
+}
+
+uint32_t RaytracingPipelineBuilder::get_specialization_data(const RaytracingPipelineSettings* settings, std::array<uint32_t, 8>& data) {
+    // output masks are specialized into all stages, writes to disabled outputs are compiled out
+    uint32_t half_output_mask = 0;
+    uint32_t unorm8_output_mask = 0;
+    for (int i = 0; i < output_buffers.size(); i++) {
+        if (output_buffers[i].format == OUTPUT_FORMAT_RGBA16F) half_output_mask |= 1u << i;
+        if (output_buffers[i].format == OUTPUT_FORMAT_RGBA8) unorm8_output_mask |= 1u << i;
+    }
+
+    data = {enabled_output_mask, half_output_mask, unorm8_output_mask, VK_FALSE, 0, 0, 0, 0};
+    if (settings != nullptr) {
+        data[SPECIALIZATION_CONSTANT_SETTINGS_SPECIALIZED] = VK_TRUE;
+        data[SPECIALIZATION_CONSTANT_MAX_DEPTH] = settings->max_depth;
+        data[SPECIALIZATION_CONSTANT_FRAME_SAMPLES] = settings->frame_samples;
+        data[SPECIALIZATION_CONSTANT_LIGHT_COUNT] = settings->light_count;
+        data[SPECIALIZATION_CONSTANT_LIGHTING_FLAGS] = settings->lighting_flags;
+    }
+    // the generic pipeline keeps the shader defaults of the render settings
+    return settings != nullptr ? SPECIALIZATION_CONSTANT_LIGHTING_FLAGS + 1 : SPECIALIZATION_CONSTANT_SETTINGS_SPECIALIZED + 1;
+}
+
+VkPipeline RaytracingPipelineBuilder::create_compute_pipeline(std::filesystem::path compiled_shader_path, const RaytracingPipelineSettings* settings) {
+    std::array<uint32_t, 8> specialization_data;
+    uint32_t specialization_count = get_specialization_data(settings, specialization_data);
+    std::array<VkSpecializationMapEntry, 8> specialization_entries = get_specialization_entries();
+
+    VkSpecializationInfo specialization_info{};
+    specialization_info.mapEntryCount = specialization_count;
+    specialization_info.pMapEntries = specialization_entries.data();
+    specialization_info.dataSize = sizeof(uint32_t) * specialization_count;
+    specialization_info.pData = specialization_data.data();
+
+    VkPipelineShaderStageCreateInfo stage_create_info{};
+    stage_create_info.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+    stage_create_info.stage = VK_SHADER_STAGE_COMPUTE_BIT;
+    stage_create_info.module = loaders::load_shader_module(device->vulkan_device, compiled_shader_path.string());
+    stage_create_info.pName = "main";
+    stage_create_info.pSpecializationInfo = &specialization_info;
+
+    VkComputePipelineCreateInfo pipeline_create_info{};
+    pipeline_create_info.sType = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO;
+    pipeline_create_info.layout = pipeline_layout;
+    pipeline_create_info.stage = stage_create_info;
+
+    VkPipeline result = VK_NULL_HANDLE;
+    VkResult err = vkCreateComputePipelines(device->vulkan_device, device->pipeline_cache, 1, &pipeline_create_info, nullptr, &result);
+
+    vkDestroyShaderModule(device->vulkan_device, stage_create_info.module, nullptr);
+
+    if (err != VK_SUCCESS) throw std::runtime_error("error creating compute pipeline for " + compiled_shader_path.string());
+    return result;
+}
+
+// creates pipeline and shader binding table from the compiled stages
+// without settings, render settings are read from push constants at runtime
+RaytracingPipelineVariant RaytracingPipelineBuilder::create_variant(const RaytracingPipelineSettings* settings) {
+    PROFILE_ZONE("create pipeline and sbt");
+    RaytracingPipelineVariant result;
+    std::array<uint32_t, 8> specialization_data;
+    uint32_t specialization_count = get_specialization_data(settings, specialization_data);
+    std::array<VkSpecializationMapEntry, 8> specialization_entries = get_specialization_entries();
+
+    VkSpecializationInfo specialization_info{};
+    specialization_info.mapEntryCount = specialization_count;
+    specialization_info.pMapEntries = specialization_entries.data();
+    specialization_info.dataSize = sizeof(uint32_t) * specialization_count;
+    specialization_info.pData = specialization_data.data();
+
     std::vector<VkShaderModule> generated_shader_modules;
     std::vector<VkPipelineShaderStageCreateInfo> stage_create_infos;
     std::vector<VkRayTracingShaderGroupCreateInfoKHR> group_create_infos;
 
-    std::cout << "Building pipeline with " << shader_stages.size() << " stages" << std::endl;
-
     for (auto stage = shader_stages.begin(); stage != shader_stages.end(); stage++)
     {
-        // compile shader
-        std::filesystem::path shader_out_path = compile_shader((*stage)->get_shader_code_path());
+        std::filesystem::path shader_out_path = compiled_stage_paths[stage - shader_stages.begin()];
 
         VkShaderModule module = loaders::load_shader_module(device->vulkan_device, shader_out_path.string());
         generated_shader_modules.push_back(module);
@@ -394,12 +643,13 @@ RaytracingPipeline RaytracingPipelineBuilder::build() {
         stage_create_info.stage = (*stage)->get_shader_stage();
         stage_create_info.module = module;
         stage_create_info.pName = (*stage)->get_entry_point();
-        stage_create_info.pSpecializationInfo = nullptr;
+        stage_create_info.pSpecializationInfo = &specialization_info;
         stage_create_info.flags = 0;
         stage_create_info.pNext = nullptr;
 
         uint32_t stage_index = (uint32_t)stage_create_infos.size();
-        std::cout << "Stage " << stage_index << ": " << (*stage)->get_shader_stage() << " with code at " << shader_out_path.string() << ". Entry point: " << (*stage)->get_entry_point() << std::endl;
+        // only the generic pipeline lists its stages, batch and benchmark runs build many specialized variants
+        if (settings == nullptr) std::cout << "Stage " << stage_index << ": " << (*stage)->get_shader_stage() << " with code at " << shader_out_path.string() << ". Entry point: " << (*stage)->get_entry_point() << std::endl;
         stage_create_infos.push_back(stage_create_info);
 
         VkRayTracingShaderGroupCreateInfoKHR group_create_info{};
@@ -439,17 +689,10 @@ RaytracingPipeline RaytracingPipelineBuilder::build() {
     pipeline_info.pStages = stage_create_infos.data();
     pipeline_info.groupCount = (uint32_t)group_create_infos.size();
     pipeline_info.pGroups = group_create_infos.data();
-    pipeline_info.maxPipelineRayRecursionDepth = device->ray_tracing_pipeline_properties.maxRayRecursionDepth;
+    // bounces are traced iteratively from the ray generation shader
+    pipeline_info.maxPipelineRayRecursionDepth = 1;
 
-    VkPipelineCacheCreateInfo cache_create_info{};
-    cache_create_info.sType = VK_STRUCTURE_TYPE_PIPELINE_CACHE_CREATE_INFO;
-
-    if (vkCreatePipelineCache(device->vulkan_device, &cache_create_info, nullptr, &result.pipeline_cache_handle) != VK_SUCCESS)
-    {
-        throw std::runtime_error("error creating pipeline cache");
-    }
-
-    auto err = device->vkCreateRayTracingPipelinesKHR(device->vulkan_device, VK_NULL_HANDLE, result.pipeline_cache_handle, 1, &pipeline_info, nullptr, &result.pipeline_handle);
+    auto err = device->vkCreateRayTracingPipelinesKHR(device->vulkan_device, VK_NULL_HANDLE, device->pipeline_cache, 1, &pipeline_info, nullptr, &result.pipeline_handle);
     if (err != VK_SUCCESS)
     {
         std::cout << "ERROR: " << err << std::endl;
@@ -473,7 +716,6 @@ RaytracingPipeline RaytracingPipelineBuilder::build() {
     size_t shader_binding_table_size = group_count * group_handle_size;
 
     VkDeviceSize entry_stride = memory::align_up(group_handle_size_aligned, base_alignment);
-    result.sbt_stride = entry_stride;
 
     result.sbt.region_raygen.stride = entry_stride;
     result.sbt.region_raygen.size = entry_stride;
@@ -520,11 +762,12 @@ RaytracingPipeline RaytracingPipelineBuilder::build() {
 #pragma endregion
 
     return result;
-    
 }
 
 RaytracingPipelineBuilder::RaytracingPipelineBuilder() {
     add_descriptor("lights", DESCRIPTOR_SET_FRAMEWORK, DESCRIPTOR_BINDING_LIGHTS, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_RAYGEN_BIT_KHR | VK_SHADER_STAGE_CLOSEST_HIT_BIT_KHR);
+    add_descriptor("light_tree", DESCRIPTOR_SET_FRAMEWORK, DESCRIPTOR_BINDING_LIGHT_TREE, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_RAYGEN_BIT_KHR | VK_SHADER_STAGE_CLOSEST_HIT_BIT_KHR);
+    add_descriptor("light_distributions", DESCRIPTOR_SET_FRAMEWORK, DESCRIPTOR_BINDING_LIGHT_DISTRIBUTIONS, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_RAYGEN_BIT_KHR | VK_SHADER_STAGE_CLOSEST_HIT_BIT_KHR | VK_SHADER_STAGE_MISS_BIT_KHR);
     add_descriptor("outputs", DESCRIPTOR_SET_FRAMEWORK, DESCRIPTOR_BINDING_OUTPUT_BUFFERS, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_RAYGEN_BIT_KHR | VK_SHADER_STAGE_CLOSEST_HIT_BIT_KHR | VK_SHADER_STAGE_MISS_BIT_KHR, 0);
 }
 
@@ -2,11 +2,14 @@
 
 #include "core/device.h"
 #include "loaders/image.h"
+#include "shader_interface.h"
 
 #include <vector>
 #include <string>
 #include <unordered_map>
 #include <memory>
+#include <filesystem>
+#include <array>
 
 #include "pipeline/raytracing/pipeline_stage.h"
 
@@ -21,6 +24,9 @@ enum class ImageType {
     Sampled = VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE
 };
 
+// stages sharing the pipeline layout, compute integrators bind the same descriptor sets and push constants as the raytracing stages
+const VkShaderStageFlags RAYTRACING_PIPELINE_LAYOUT_STAGES = VK_SHADER_STAGE_RAYGEN_BIT_KHR | VK_SHADER_STAGE_CLOSEST_HIT_BIT_KHR | VK_SHADER_STAGE_MISS_BIT_KHR | VK_SHADER_STAGE_COMPUTE_BIT;
+
 struct ShaderBindingTable
 {
     Buffer buffer;
@@ -37,9 +43,35 @@ struct OutputBuffer
     std::string name;
     bool hidden;
     bool exportable;
+    // OUTPUT_FORMAT_*
+    uint32_t format;
     size_t entry_size;
+    // disabled outputs are not written and only hold a placeholder allocation
+    bool enabled;
 
     vec3 get_color(uint32_t pixel_index);
+    // reads and unpacks the first pixel_count entries to full precision
+    std::vector<glm::vec4> get_colors(size_t pixel_count);
+};
+
+// render settings baked into a pipeline variant as specialization constants
+struct RaytracingPipelineSettings {
+    uint32_t max_depth;
+    uint32_t frame_samples;
+    uint32_t light_count;
+    // ENABLE_DIRECT_LIGHTING | ENABLE_INDIRECT_LIGHTING
+    uint32_t lighting_flags;
+
+    // variants are looked up by all fields, hash collisions fall back to the comparison
+    bool operator==(const RaytracingPipelineSettings& other) const;
+    struct Hash {
+        size_t operator()(const RaytracingPipelineSettings& settings) const;
+    };
+};
+
+struct RaytracingPipelineVariant {
+    VkPipeline pipeline_handle = VK_NULL_HANDLE;
+    ShaderBindingTable sbt;
 };
 
 struct DescriptorSetBinding {
@@ -59,6 +91,13 @@ struct RaytracingPipeline {
 
     std::vector <OutputBuffer> created_output_buffers;
 
+    // specialized variants sharing layout, descriptors and outputs with this pipeline, keyed by their settings
+    std::unordered_map<RaytracingPipelineSettings, RaytracingPipelineVariant, RaytracingPipelineSettings::Hash> variants;
+
+    // returns the variant for the settings, it is created on first use
+    RaytracingPipelineVariant& get_variant(const RaytracingPipelineSettings& settings);
+    void free_variants();
+
     DescriptorSetBinding get_descriptor_set_binding(std::string descriptor_name);
     void set_descriptor_acceleration_structure_binding(VkAccelerationStructureKHR acceleration_structure);
     void set_descriptor_image_binding(std::string name, Image image, ImageType image_type, uint32_t array_index = 0);
@@ -85,9 +124,11 @@ struct RaytracingPipelineBuilderDescriptor
 struct RaytracingPipelineBuilderOutputBuffer
 {
     std::string name;
-    size_t entry_size;
+    uint32_t format;
     bool hidden;
     bool exportable;
+    // always allocated, used by accumulation and adaptive sampling
+    bool required;
 };
 
 struct RaytracingPipelineBuilder
@@ -102,15 +143,23 @@ struct RaytracingPipelineBuilder
     uint32_t miss_stages = 0;
     uint32_t callable_stages = 0;
 
+    // compiled spir-v module of each stage, indexed like shader_stages
+    std::vector<std::filesystem::path> compiled_stage_paths;
+
     void add_descriptor(std::string name, uint32_t set, uint32_t binding, VkDescriptorType type, VkShaderStageFlags stage, size_t descriptor_count = 1);
-    void add_output_buffer(std::string name, size_t entry_size = sizeof(float) * 4, bool hidden = false, bool exportable = false);
+    void add_output_buffer(std::string name, uint32_t format = OUTPUT_FORMAT_RGBA32F, bool hidden = false, bool exportable = false, bool required = false);
     void add_stage(std::shared_ptr<RaytracingPipelineStage> stage);
+    RaytracingPipelineVariant create_variant(const RaytracingPipelineSettings* settings);
+    // specialization constants of all stages, returns the number of specialized constants
+    uint32_t get_specialization_data(const RaytracingPipelineSettings* settings, std::array<uint32_t, 8>& data);
 
 
     public:
     VkPipelineLayout pipeline_layout = VK_NULL_HANDLE;
     uint8_t max_set = 0;
     std::unordered_map<std::string, uint32_t> named_output_buffer_indices;
+    // bit mask of allocated and written output buffers
+    uint32_t enabled_output_mask = 0;
     std::unordered_map<std::string, DescriptorSetBinding> named_descriptors;
     std::vector<VkDescriptorSet> descriptor_sets;
     std::vector<VkDescriptorSetLayout> descriptor_set_layouts;
@@ -120,8 +169,22 @@ struct RaytracingPipelineBuilder
 
     RaytracingPipelineBuilder with_buffer_descriptor(std::string name, uint32_t binding, VkShaderStageFlags stage = VK_SHADER_STAGE_RAYGEN_BIT_KHR);
 
+    // enables the named outputs in addition to the required ones, returns true if the pipeline has to be rebuilt
+    bool set_requested_outputs(std::vector<std::string> names);
+
     RaytracingPipelineBuilder();
 
     RaytracingPipeline build();
+    // creates a pipeline specialized for fixed render settings from the stages of the last build
+    RaytracingPipelineVariant build_variant(const RaytracingPipelineSettings& settings);
+    // creates a compute pipeline with the layout and output specialization of the raytracing stages, call after build
+    // settings are baked in like in pipeline variants if given
+    VkPipeline create_compute_pipeline(std::filesystem::path compiled_shader_path, const RaytracingPipelineSettings* settings = nullptr);
+
+    // hot reload: indices of stages using any of the files
+    std::vector<size_t> get_stages_depending_on(const std::vector<std::filesystem::path>& files);
+    // swaps the compiled stages into a pipeline built by this builder, the pipeline is left unchanged if creation fails
+    void reload_stages(RaytracingPipeline& pipeline, std::vector<size_t> stages, std::vector<std::filesystem::path> compiled_paths);
+
     void free();
 };
\ No newline at end of file
@@ -0,0 +1,305 @@
+#include "wavefront_integrator.h"
+
+#include "core/device.h"
+#include "core/cpu_profiler.h"
+#include "shader_compiler.h"
+
+#include <cstddef>
+#include <cstring>
+
+// indexed by WavefrontIntegrator::Kernel
+static const std::array<std::string, 11> kernel_code_paths = {
+    "./shaders/raytracing/wavefront/generate.comp",
+    "./shaders/raytracing/wavefront/extend.comp",
+    "./shaders/raytracing/wavefront/sort_scan.comp",
+    "./shaders/raytracing/wavefront/sort_scatter.comp",
+    "./shaders/raytracing/wavefront/shade.comp",
+    "./shaders/raytracing/wavefront/shadow.comp",
+    "./shaders/raytracing/wavefront/resolve.comp",
+    "./shaders/raytracing/wavefront/ray_keys.comp",
+    "./shaders/raytracing/wavefront/radix_count.comp",
+    "./shaders/raytracing/wavefront/radix_scan.comp",
+    "./shaders/raytracing/wavefront/radix_scatter.comp",
+};
+
+static const Shaders::WavefrontQueue empty_queue = {0, 1, 1, 0};
+
+static void cmd_memory_barrier(VkCommandBuffer command_buffer, VkPipelineStageFlags src_stage, VkAccessFlags src_access, VkPipelineStageFlags dst_stage, VkAccessFlags dst_access) {
+    VkMemoryBarrier barrier {};
+    barrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+    barrier.srcAccessMask = src_access;
+    barrier.dstAccessMask = dst_access;
+    vkCmdPipelineBarrier(command_buffer, src_stage, dst_stage, 0, 1, &barrier, 0, nullptr, 0, nullptr);
+}
+
+// queues written by a kernel are read by the next kernel and its indirect dispatch
+static void cmd_kernel_barrier(VkCommandBuffer command_buffer) {
+    cmd_memory_barrier(command_buffer,
+        VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_ACCESS_SHADER_WRITE_BIT,
+        VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT | VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT, VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT | VK_ACCESS_INDIRECT_COMMAND_READ_BIT);
+}
+
+void WavefrontIntegrator::build(Device* device, RaytracingPipelineBuilder* builder) {
+    PROFILE_ZONE("build wavefront integrator");
+    this->device = device;
+    this->builder = builder;
+
+    free_pipelines();
+    std::vector<std::filesystem::path> compiled_paths = compile_shaders(std::vector<std::string>(kernel_code_paths.begin(), kernel_code_paths.end()));
+    for (size_t i = 0; i < KERNEL_COUNT; i++) {
+        pipelines[i] = builder->create_compute_pipeline(compiled_paths[i]);
+    }
+}
+
+void WavefrontIntegrator::resize(RaytracingPipeline& pipeline, VkExtent2D extent) {
+    uint32_t pixel_count = extent.width * extent.height;
+
+    uint32_t group_count = (pixel_count + WAVEFRONT_GROUP_SIZE - 1) / WAVEFRONT_GROUP_SIZE;
+
+    // ray statistics are copied out through the readback ring
+    state_buffer.free();
+    state_buffer = device->create_buffer(sizeof(Shaders::WavefrontState), VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_SRC_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT, false, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+    // queues never hold more than one ray per pixel
+    path_buffer.free();
+    path_buffer = device->create_buffer(sizeof(Shaders::WavefrontPath) * pixel_count, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, false, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+    for (Buffer& ray_buffer : ray_buffers) {
+        ray_buffer.free();
+        ray_buffer = device->create_buffer(sizeof(Shaders::WavefrontRay) * pixel_count, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, false, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+    }
+    hit_buffer.free();
+    hit_buffer = device->create_buffer(sizeof(Shaders::WavefrontHit) * pixel_count, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, false, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+    shadow_ray_buffer.free();
+    shadow_ray_buffer = device->create_buffer(sizeof(Shaders::WavefrontShadowRay) * pixel_count, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, false, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+    // bin counts and offsets followed by one ray index per pixel
+    sort_buffer.free();
+    sort_buffer = device->create_buffer(sizeof(uint32_t) * (2 * WAVEFRONT_SORT_BINS + pixel_count), VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT, false, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+    // key and ray index pairs, digit totals followed by the digit counts of every group
+    for (Buffer& ray_sort_buffer : ray_sort_buffers) {
+        ray_sort_buffer.free();
+        ray_sort_buffer = device->create_buffer(sizeof(uint32_t) * 2 * pixel_count, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, false, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+    }
+    ray_sort_histogram_buffer.free();
+    ray_sort_histogram_buffer = device->create_buffer(sizeof(uint32_t) * WAVEFRONT_RADIX_DIGITS * (1 + group_count), VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT, false, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+
+    pipeline.set_descriptor_buffer_binding("wavefront_state", state_buffer, BufferType::Storage);
+    pipeline.set_descriptor_buffer_binding("wavefront_paths", path_buffer, BufferType::Storage);
+    pipeline.set_descriptor_buffer_binding("wavefront_rays", ray_buffers[0], BufferType::Storage, 0);
+    pipeline.set_descriptor_buffer_binding("wavefront_rays", ray_buffers[1], BufferType::Storage, 1);
+    pipeline.set_descriptor_buffer_binding("wavefront_hits", hit_buffer, BufferType::Storage);
+    pipeline.set_descriptor_buffer_binding("wavefront_shadow_rays", shadow_ray_buffer, BufferType::Storage);
+    pipeline.set_descriptor_buffer_binding("wavefront_sort", sort_buffer, BufferType::Storage);
+    pipeline.set_descriptor_buffer_binding("wavefront_ray_sort", ray_sort_buffers[0], BufferType::Storage, 0);
+    pipeline.set_descriptor_buffer_binding("wavefront_ray_sort", ray_sort_buffers[1], BufferType::Storage, 1);
+    pipeline.set_descriptor_buffer_binding("wavefront_ray_sort_histograms", ray_sort_histogram_buffer, BufferType::Storage);
+}
+
+void WavefrontIntegrator::cmd_dispatch(VkCommandBuffer command_buffer, Kernel kernel, const char* zone_name, uint32_t groups) {
+    device->gpu_profiler.cmd_begin_zone(command_buffer, zone_name);
+    vkCmdBindPipeline(command_buffer, VK_PIPELINE_BIND_POINT_COMPUTE, pipelines[kernel]);
+    vkCmdDispatch(command_buffer, groups, 1, 1);
+    device->gpu_profiler.cmd_end_zone(command_buffer);
+    cmd_kernel_barrier(command_buffer);
+}
+
+void WavefrontIntegrator::cmd_dispatch_queue(VkCommandBuffer command_buffer, Kernel kernel, const char* zone_name, VkDeviceSize queue_offset) {
+    device->gpu_profiler.cmd_begin_zone(command_buffer, zone_name);
+    vkCmdBindPipeline(command_buffer, VK_PIPELINE_BIND_POINT_COMPUTE, pipelines[kernel]);
+    vkCmdDispatchIndirect(command_buffer, state_buffer.buffer_handle, queue_offset);
+    device->gpu_profiler.cmd_end_zone(command_buffer);
+    cmd_kernel_barrier(command_buffer);
+}
+
+void WavefrontIntegrator::cmd_update_state(VkCommandBuffer command_buffer, VkDeviceSize offset, VkDeviceSize size, const void* data) {
+    // earlier kernels and indirect dispatches still read the state
+    cmd_memory_barrier(command_buffer,
+        VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT | VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT, VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT | VK_ACCESS_INDIRECT_COMMAND_READ_BIT,
+        VK_PIPELINE_STAGE_TRANSFER_BIT, VK_ACCESS_TRANSFER_WRITE_BIT);
+    vkCmdUpdateBuffer(command_buffer, state_buffer.buffer_handle, offset, size, data);
+}
+
+Shaders::WavefrontState WavefrontIntegrator::get_state(uint32_t depth, uint32_t frame_sample) {
+    Shaders::WavefrontState state {};
+    state.depth = depth;
+    state.frame_sample = frame_sample;
+    state.sorted = sort_by_material ? 1 : 0;
+    // camera rays are coherent already
+    state.coherent = sort_by_coherence && depth > 1 ? 1 : 0;
+    state.radix_pass = 0;
+    // flat scenes must not divide by zero
+    glm::vec3 scene_bounds_size = glm::max(scene_bounds_max - scene_bounds_min, glm::vec3(1e-4f));
+    state.scene_bounds_min = glm::vec4(scene_bounds_min, 0.0f);
+    state.scene_bounds_size = glm::vec4(scene_bounds_size, 0.0f);
+    return state;
+}
+
+void WavefrontIntegrator::cmd_sort_rays(VkCommandBuffer command_buffer, VkDeviceSize ray_queue_offset) {
+    device->gpu_profiler.cmd_begin_zone(command_buffer, "Coherence Sort");
+    cmd_dispatch_queue(command_buffer, KERNEL_RAY_KEYS, "Ray Keys", ray_queue_offset);
+    for (uint32_t pass = 0; pass < WAVEFRONT_RADIX_PASSES; pass++) {
+        cmd_update_state(command_buffer, offsetof(Shaders::WavefrontState, radix_pass), sizeof(uint32_t), &pass);
+        vkCmdFillBuffer(command_buffer, ray_sort_histogram_buffer.buffer_handle, 0, sizeof(uint32_t) * WAVEFRONT_RADIX_DIGITS, 0);
+        cmd_memory_barrier(command_buffer,
+            VK_PIPELINE_STAGE_TRANSFER_BIT, VK_ACCESS_TRANSFER_WRITE_BIT,
+            VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT);
+
+        cmd_dispatch_queue(command_buffer, KERNEL_RADIX_COUNT, "Radix Count", ray_queue_offset);
+        // one group per digit
+        cmd_dispatch(command_buffer, KERNEL_RADIX_SCAN, "Radix Scan", WAVEFRONT_RADIX_DIGITS);
+        cmd_dispatch_queue(command_buffer, KERNEL_RADIX_SCATTER, "Radix Scatter", ray_queue_offset);
+    }
+    device->gpu_profiler.cmd_end_zone(command_buffer);
+}
+
+void WavefrontIntegrator::cmd_begin_bounce(VkCommandBuffer command_buffer, uint32_t depth, uint32_t frame_sample) {
+    uint32_t next_queue = (depth + 1) % 2;
+    cmd_update_state(command_buffer, next_queue * sizeof(Shaders::WavefrontQueue), sizeof(Shaders::WavefrontQueue), &empty_queue);
+
+    // shadow queue and bounce state are contiguous, the ray statistics following them cover the whole frame
+    Shaders::WavefrontState state = get_state(depth, frame_sample);
+    state.shadow_queue = empty_queue;
+    size_t shadow_queue_offset = offsetof(Shaders::WavefrontState, shadow_queue);
+    size_t statistics_offset = offsetof(Shaders::WavefrontState, extended_rays);
+    vkCmdUpdateBuffer(command_buffer, state_buffer.buffer_handle, shadow_queue_offset, statistics_offset - shadow_queue_offset, (uint8_t*)&state + shadow_queue_offset);
+
+    if (sort_by_material) vkCmdFillBuffer(command_buffer, sort_buffer.buffer_handle, 0, sizeof(uint32_t) * WAVEFRONT_SORT_BINS, 0);
+
+    cmd_memory_barrier(command_buffer,
+        VK_PIPELINE_STAGE_TRANSFER_BIT, VK_ACCESS_TRANSFER_WRITE_BIT,
+        VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT | VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT, VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT | VK_ACCESS_INDIRECT_COMMAND_READ_BIT);
+}
+
+void WavefrontIntegrator::cmd_render(VkCommandBuffer command_buffer, Shaders::PushConstantsPacked& push_constants_packed, VkExtent2D render_extent, uint32_t max_depth, uint32_t frame_samples) {
+    device->gpu_profiler.cmd_begin_zone(command_buffer, "Wavefront");
+
+    vkCmdPushConstants(command_buffer, builder->pipeline_layout, RAYTRACING_PIPELINE_LAYOUT_STAGES, 0, sizeof(Shaders::PushConstantsPacked), &push_constants_packed);
+    vkCmdBindDescriptorSets(command_buffer, VK_PIPELINE_BIND_POINT_COMPUTE, builder->pipeline_layout, 0, builder->max_set + 1, builder->descriptor_sets.data(), 0, nullptr);
+
+    // outputs of the previous frame are read and written by the resolve kernel
+    cmd_memory_barrier(command_buffer,
+        VK_PIPELINE_STAGE_TRANSFER_BIT | VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_ACCESS_TRANSFER_WRITE_BIT | VK_ACCESS_SHADER_WRITE_BIT,
+        VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT);
+
+    uint32_t pixel_count = render_extent.width * render_extent.height;
+    uint32_t pixel_groups = (pixel_count + WAVEFRONT_GROUP_SIZE - 1) / WAVEFRONT_GROUP_SIZE;
+    VkDeviceSize shadow_queue_offset = offsetof(Shaders::WavefrontState, shadow_queue);
+    VkDeviceSize statistics_offset = offsetof(Shaders::WavefrontState, extended_rays);
+
+    uint32_t extended_rays = 0;
+    cmd_update_state(command_buffer, statistics_offset, sizeof(uint32_t), &extended_rays);
+
+    for (uint32_t frame_sample = 0; frame_sample < frame_samples; frame_sample++) {
+        // camera rays of all pixels are the current rays of the first bounce, which reads queue depth % 2 = 1
+        Shaders::WavefrontState state = get_state(1, frame_sample);
+        state.ray_queues[1] = {pixel_groups, 1, 1, pixel_count};
+        state.ray_queues[0] = empty_queue;
+        state.shadow_queue = empty_queue;
+        cmd_update_state(command_buffer, 0, statistics_offset, &state);
+        cmd_memory_barrier(command_buffer,
+            VK_PIPELINE_STAGE_TRANSFER_BIT, VK_ACCESS_TRANSFER_WRITE_BIT,
+            VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_ACCESS_SHADER_READ_BIT);
+
+        cmd_dispatch(command_buffer, KERNEL_GENERATE, "Generate", pixel_groups);
+
+        for (uint32_t depth = 1; depth <= max_depth; depth++) {
+            cmd_begin_bounce(command_buffer, depth, frame_sample);
+
+            VkDeviceSize ray_queue_offset = (depth % 2) * sizeof(Shaders::WavefrontQueue);
+            if (sort_by_coherence && depth > 1) cmd_sort_rays(command_buffer, ray_queue_offset);
+            cmd_dispatch_queue(command_buffer, KERNEL_EXTEND, "Extend", ray_queue_offset);
+            if (sort_by_material) {
+                device->gpu_profiler.cmd_begin_zone(command_buffer, "Sort");
+                cmd_dispatch(command_buffer, KERNEL_SORT_SCAN, "Scan", 1);
+                cmd_dispatch_queue(command_buffer, KERNEL_SORT_SCATTER, "Scatter", ray_queue_offset);
+                device->gpu_profiler.cmd_end_zone(command_buffer);
+            }
+            cmd_dispatch_queue(command_buffer, KERNEL_SHADE, "Shade", ray_queue_offset);
+            cmd_dispatch_queue(command_buffer, KERNEL_SHADOW, "Shadow", shadow_queue_offset);
+        }
+    }
+
+    cmd_dispatch(command_buffer, KERNEL_RESOLVE, "Resolve", pixel_groups);
+
+    device->gpu_profiler.cmd_end_zone(command_buffer);
+}
+
+uint32_t WavefrontIntegrator::get_query_count(uint32_t max_depth, uint32_t frame_samples) {
+    // extend, shade and shadow, sort with scan and scatter
+    uint32_t bounce_zones = 3 + (sort_by_material ? 3 : 0);
+    // coherence sort with ray keys and count, scan and scatter per radix pass, from the second bounce on
+    uint32_t coherence_zones = sort_by_coherence && max_depth > 1 ? (max_depth - 1) * (2 + 3 * WAVEFRONT_RADIX_PASSES) : 0;
+    // wavefront and resolve, generate per frame sample
+    uint32_t zones = 2 + frame_samples * (1 + max_depth * bounce_zones + coherence_zones);
+    return 2 * zones;
+}
+
+void WavefrontIntegrator::cmd_copy_statistics(VkCommandBuffer command_buffer, ReadbackRing& readback, uint64_t frame) {
+    cmd_memory_barrier(command_buffer,
+        VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_ACCESS_SHADER_WRITE_BIT,
+        VK_PIPELINE_STAGE_TRANSFER_BIT, VK_ACCESS_TRANSFER_READ_BIT);
+    readback.cmd_copy_buffer(command_buffer, state_buffer, offsetof(Shaders::WavefrontState, extended_rays), sizeof(uint32_t), frame, [this](ReadbackResult& result) {
+        memcpy(&last_extended_rays, result.data.data(), sizeof(uint32_t));
+        extended_rays_delivered = true;
+    });
+}
+
+void WavefrontIntegrator::update_statistics() {
+    // traversal time is only known while the profiler measures the extend kernel
+    last_traversal_rays_per_second = 0.0;
+    if (!extended_rays_delivered) return;
+    extended_rays_delivered = false;
+    if (!device->gpu_profiler.enabled) return;
+
+    // rays of untimed bounces would be divided by the time of the timed ones only
+    if (device->gpu_profiler.last_dropped_zones > 0) {
+        incomplete_frames++;
+        return;
+    }
+
+    for (auto& zone : device->gpu_profiler.get_statistics()) {
+        if (zone.name != "Extend" || zone.last <= 0.0) continue;
+        last_traversal_rays_per_second = last_extended_rays / (zone.last * 1e-3);
+        total_extended_rays += last_extended_rays;
+        total_extend_time += zone.last * 1e-3;
+    }
+}
+
+void WavefrontIntegrator::reset_statistics() {
+    last_extended_rays = 0;
+    last_traversal_rays_per_second = 0.0;
+    total_extended_rays = 0;
+    total_extend_time = 0.0;
+    incomplete_frames = 0;
+    extended_rays_delivered = false;
+}
+
+double WavefrontIntegrator::get_traversal_rays_per_second() {
+    if (incomplete_frames > 0) return 0.0;
+    return total_extend_time > 0.0 ? total_extended_rays / total_extend_time : 0.0;
+}
+
+bool WavefrontIntegrator::depends_on(const std::vector<std::filesystem::path>& files) {
+    for (const std::string& code_path : kernel_code_paths) {
+        if (shader_depends_on(code_path, files)) return true;
+    }
+    return false;
+}
+
+void WavefrontIntegrator::free_pipelines() {
+    for (VkPipeline& pipeline : pipelines) {
+        if (pipeline != VK_NULL_HANDLE) vkDestroyPipeline(device->vulkan_device, pipeline, nullptr);
+        pipeline = VK_NULL_HANDLE;
+    }
+}
+
+void WavefrontIntegrator::free() {
+    if (device == nullptr) return;
+    free_pipelines();
+    state_buffer.free();
+    path_buffer.free();
+    for (Buffer& ray_buffer : ray_buffers) ray_buffer.free();
+    hit_buffer.free();
+    shadow_ray_buffer.free();
+    sort_buffer.free();
+    for (Buffer& ray_sort_buffer : ray_sort_buffers) ray_sort_buffer.free();
+    ray_sort_histogram_buffer.free();
+}
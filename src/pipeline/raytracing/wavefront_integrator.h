@@ -0,0 +1,98 @@
+#pragma once
+
+#include "core/vulkan.h"
+#include "core/buffer.h"
+#include "core/readback.h"
+#include "shader_interface.h"
+#include "pipeline/raytracing/pipeline_builder.h"
+
+#include <array>
+#include <vector>
+#include <string>
+#include <filesystem>
+
+struct Device;
+
+// path tracer in compute kernels that advances the paths of all pixels one bounce at a time
+// each bounce, extend finds the closest hits of the queued rays (optionally in coherence order), sort orders them by material,
+// shade evaluates them and queues light samples and continuation rays, and shadow tests all light samples at once
+// kernels bind the layout, descriptor sets and push constants of the raytracing pipeline
+struct WavefrontIntegrator {
+    Device* device = nullptr;
+    RaytracingPipelineBuilder* builder = nullptr;
+
+    // hits are shaded in material order, keeping threads of a subgroup on the same code path and textures
+    bool sort_by_material = true;
+    // secondary rays are traced ordered by origin cell and direction octant, trading a radix sort for coherent traversal
+    bool sort_by_coherence = false;
+    // origin cells of the coherence sort subdivide these bounds
+    glm::vec3 scene_bounds_min = glm::vec3(-1.0f);
+    glm::vec3 scene_bounds_max = glm::vec3(1.0f);
+
+    // traversal statistics of the extend kernel, rays per second use the gpu profiler timings
+    uint32_t last_extended_rays = 0;
+    double last_traversal_rays_per_second = 0.0;
+    uint64_t total_extended_rays = 0;
+    double total_extend_time = 0.0;
+    // frames since the last reset whose extend zones were not all timed, throughput is not reported for them
+    uint32_t incomplete_frames = 0;
+
+    // compiles the kernels, call after the raytracing pipeline was built
+    void build(Device* device, RaytracingPipelineBuilder* builder);
+    // allocates path state and queues for every pixel of the extent and binds them to the pipeline
+    void resize(RaytracingPipeline& pipeline, VkExtent2D extent);
+    // traces all samples of a frame and accumulates them into the outputs
+    void cmd_render(VkCommandBuffer command_buffer, Shaders::PushConstantsPacked& push_constants_packed, VkExtent2D render_extent, uint32_t max_depth, uint32_t frame_samples);
+    // timestamp queries of the profiler zones cmd_render records, every kernel of every bounce and frame sample has its own zone
+    uint32_t get_query_count(uint32_t max_depth, uint32_t frame_samples);
+
+    // copies the ray count of the frame into the readback ring, call after cmd_render
+    void cmd_copy_statistics(VkCommandBuffer command_buffer, ReadbackRing& readback, uint64_t frame);
+    // pairs the delivered ray count with the extend timings, call after the readback ring delivered and the gpu profiler completed the same frame
+    void update_statistics();
+    void reset_statistics();
+    // average over all frames since the last reset, 0 if any of them was incomplete
+    double get_traversal_rays_per_second();
+
+    // hot reload: true if any kernel uses one of the files
+    bool depends_on(const std::vector<std::filesystem::path>& files);
+
+    void free_pipelines();
+    void free();
+
+    private:
+    enum Kernel {
+        KERNEL_GENERATE,
+        KERNEL_EXTEND,
+        KERNEL_SORT_SCAN,
+        KERNEL_SORT_SCATTER,
+        KERNEL_SHADE,
+        KERNEL_SHADOW,
+        KERNEL_RESOLVE,
+        KERNEL_RAY_KEYS,
+        KERNEL_RADIX_COUNT,
+        KERNEL_RADIX_SCAN,
+        KERNEL_RADIX_SCATTER,
+        KERNEL_COUNT
+    };
+
+    std::array<VkPipeline, KERNEL_COUNT> pipelines{};
+
+    // set by the readback callback, consumed by update_statistics
+    bool extended_rays_delivered = false;
+
+    Buffer state_buffer{}, path_buffer{}, hit_buffer{}, shadow_ray_buffer{}, sort_buffer{};
+    std::array<Buffer, 2> ray_buffers{};
+    Buffer ray_sort_histogram_buffer{};
+    std::array<Buffer, 2> ray_sort_buffers{};
+
+    void cmd_dispatch(VkCommandBuffer command_buffer, Kernel kernel, const char* zone_name, uint32_t groups);
+    // group count is read from a queue header in the state buffer
+    void cmd_dispatch_queue(VkCommandBuffer command_buffer, Kernel kernel, const char* zone_name, VkDeviceSize queue_offset);
+    Shaders::WavefrontState get_state(uint32_t depth, uint32_t frame_sample);
+    void cmd_update_state(VkCommandBuffer command_buffer, VkDeviceSize offset, VkDeviceSize size, const void* data);
+    // empties the continuation and shadow queues, the queue of the current rays was filled by the previous bounce
+    void cmd_begin_bounce(VkCommandBuffer command_buffer, uint32_t depth, uint32_t frame_sample);
+    // orders the rays of the current queue by coherence key with an lsd radix sort
+    void cmd_sort_rays(VkCommandBuffer command_buffer, VkDeviceSize ray_queue_offset);
+};
@@ -1,18 +1,211 @@
 #include "shader_compiler.h"
 
+#include "core/cpu_profiler.h"
+
+#include "glslang/Public/ShaderLang.h"
+#include "glslang/Public/ResourceLimits.h"
+#include "glslang/SPIRV/GlslangToSpv.h"
+
 #include <filesystem>
 #include <iostream>
 #include <sstream>
+#include <fstream>
+#include <future>
+#include <mutex>
+#include <thread>
+#include <unordered_set>
+#include <stdexcept>
+
+// compiled modules are stored as <hash>.spv
+static const std::filesystem::path shader_cache_directory = "./shader_cache";
+// part of every hash, change when compiler settings change
+static const std::string shader_compiler_version = "glslang vulkan1.3 spv1.6 O";
+
+static std::string read_text_file(std::filesystem::path path) {
+    std::ifstream file(path, std::ios::binary);
+    if (!file.is_open()) throw std::runtime_error("unable to open shader source at " + path.string());
+    std::stringstream content;
+    content << file.rdbuf();
+    return content.str();
+}
+
+static std::filesystem::path resolve_include(std::filesystem::path includer_path, std::string include_name) {
+    return (includer_path.parent_path() / include_name).lexically_normal();
+}
+
+// appends the file and all files it includes (depth first, each file once)
+static void collect_shader_sources(std::filesystem::path path, std::vector<std::filesystem::path>& files, std::unordered_set<std::string>& visited) {
+    if (!visited.insert(path.string()).second) return;
+    if (!std::filesystem::exists(path)) return;
+    files.push_back(path);
+
+    std::istringstream source(read_text_file(path));
+    std::string line;
+    while (std::getline(source, line)) {
+        size_t directive = line.find_first_not_of(" \t");
+        if (directive == std::string::npos || line.compare(directive, 8, "#include") != 0) continue;
+        size_t name_begin = line.find('"', directive);
+        size_t name_end = line.find('"', name_begin + 1);
+        if (name_begin == std::string::npos || name_end == std::string::npos) continue;
+        collect_shader_sources(resolve_include(path, line.substr(name_begin + 1, name_end - name_begin - 1)), files, visited);
+    }
+}
+
+std::vector<std::filesystem::path> get_shader_sources(std::string path) {
+    std::vector<std::filesystem::path> sources;
+    std::unordered_set<std::string> visited;
+    collect_shader_sources(std::filesystem::path(path).lexically_normal(), sources, visited);
+    return sources;
+}
+
+bool shader_depends_on(std::string path, const std::vector<std::filesystem::path>& files) {
+    // compared as absolute paths, watched files and include paths may be relative to different directories
+    std::unordered_set<std::string> absolute_files;
+    for (auto& file : files) absolute_files.insert(std::filesystem::absolute(file).lexically_normal().string());
+
+    for (auto& source : get_shader_sources(path)) {
+        if (absolute_files.find(std::filesystem::absolute(source).lexically_normal().string()) != absolute_files.end()) return true;
+    }
+    return false;
+}
+
+// 64 bit FNV-1a
+static void hash_append(uint64_t& hash, const std::string& data) {
+    for (unsigned char c : data) {
+        hash ^= c;
+        hash *= 1099511628211ull;
+    }
+    // separator, so consecutive strings cannot alias
+    hash ^= 0xFF;
+    hash *= 1099511628211ull;
+}
+
+static EShLanguage get_shader_language(std::filesystem::path path) {
+    std::string extension = path.extension().string();
+    if (extension == ".rgen") return EShLangRayGen;
+    if (extension == ".rchit") return EShLangClosestHit;
+    if (extension == ".rahit") return EShLangAnyHit;
+    if (extension == ".rmiss") return EShLangMiss;
+    if (extension == ".rint") return EShLangIntersect;
+    if (extension == ".rcall") return EShLangCallable;
+    if (extension == ".comp") return EShLangCompute;
+    if (extension == ".vert") return EShLangVertex;
+    if (extension == ".frag") return EShLangFragment;
+    throw std::runtime_error("unknown shader stage for " + path.string());
+}
+
+// resolves #include "..." relative to the including file
+struct ShaderIncluder : glslang::TShader::Includer {
+    IncludeResult* includeLocal(const char* header_name, const char* includer_name, size_t inclusion_depth) override {
+        std::filesystem::path path = resolve_include(includer_name, header_name);
+        if (!std::filesystem::exists(path)) return nullptr;
+
+        std::string* content = new std::string(read_text_file(path));
+        return new IncludeResult(path.string(), content->c_str(), content->size(), content);
+    }
+
+    void releaseInclude(IncludeResult* result) override {
+        if (result == nullptr) return;
+        delete (std::string*)result->userData;
+        delete result;
+    }
+};
+
+static std::vector<uint32_t> compile_glsl(std::filesystem::path path, std::string& preamble) {
+    EShLanguage language = get_shader_language(path);
+    std::string source = read_text_file(path);
+    std::string name = path.string();
+    const char* source_data = source.c_str();
+    const char* name_data = name.c_str();
+
+    glslang::TShader shader(language);
+    shader.setStringsWithLengthsAndNames(&source_data, nullptr, &name_data, 1);
+    shader.setPreamble(preamble.c_str());
+    shader.setEnvInput(glslang::EShSourceGlsl, language, glslang::EShClientVulkan, 100);
+    shader.setEnvClient(glslang::EShClientVulkan, glslang::EShTargetVulkan_1_3);
+    shader.setEnvTarget(glslang::EShTargetSpv, glslang::EShTargetSpv_1_6);
+
+    EShMessages messages = (EShMessages)(EShMsgSpvRules | EShMsgVulkanRules);
+    ShaderIncluder includer;
+    if (!shader.parse(GetDefaultResources(), 460, false, messages, includer)) {
+        std::cerr << shader.getInfoLog() << shader.getInfoDebugLog() << std::endl;
+        throw std::runtime_error("error compiling shader " + name);
+    }
+
+    glslang::TProgram program;
+    program.addShader(&shader);
+    if (!program.link(messages)) {
+        std::cerr << program.getInfoLog() << program.getInfoDebugLog() << std::endl;
+        throw std::runtime_error("error linking shader " + name);
+    }
+
+    glslang::SpvOptions options;
+    options.disableOptimizer = false;
+    std::vector<uint32_t> spirv;
+    glslang::GlslangToSpv(*program.getIntermediate(language), spirv, &options);
+    return spirv;
+}
+
+std::filesystem::path compile_shader(std::string filepath, std::vector<std::string> defines) {
+    PROFILE_ZONE_DETAIL("compile_shader", filepath);
+    static std::once_flag glslang_initialized;
+    std::call_once(glslang_initialized, []() { glslang::InitializeProcess(); });
+
+    std::filesystem::path shader_path = std::filesystem::path(filepath).lexically_normal();
+
+    // includes are always enabled, defines are passed through the preamble
+    std::string preamble = "#extension GL_GOOGLE_include_directive : enable\n";
+    for (auto& define : defines) {
+        size_t separator = define.find('=');
+        if (separator == std::string::npos) preamble += "#define " + define + "\n";
+        else preamble += "#define " + define.substr(0, separator) + " " + define.substr(separator + 1) + "\n";
+    }
+
+    uint64_t hash = 14695981039346656037ull;
+    hash_append(hash, shader_compiler_version);
+    hash_append(hash, shader_path.extension().string());
+    hash_append(hash, preamble);
+    std::vector<std::filesystem::path> sources;
+    std::unordered_set<std::string> visited;
+    collect_shader_sources(shader_path, sources, visited);
+    for (auto& source : sources) {
+        hash_append(hash, source.generic_string());
+        hash_append(hash, read_text_file(source));
+    }
+
+    std::stringstream hash_name;
+    hash_name << std::hex << hash << ".spv";
+    std::filesystem::path shader_out_path = shader_cache_directory / hash_name.str();
+    if (std::filesystem::exists(shader_out_path)) return shader_out_path;
+
+    std::cout << "COMPILING SHADER: " << shader_path.string() << std::endl;
+    std::vector<uint32_t> spirv = compile_glsl(shader_path, preamble);
+
+    // written under a temporary name, parallel compilations of the same shader never see partial files
+    std::filesystem::create_directories(shader_cache_directory);
+    std::stringstream temporary_name;
+    temporary_name << hash_name.str() << "." << std::hash<std::thread::id>()(std::this_thread::get_id()) << ".tmp";
+    std::filesystem::path temporary_path = shader_cache_directory / temporary_name.str();
+    {
+        std::ofstream file(temporary_path, std::ios::binary);
+        if (!file.is_open()) throw std::runtime_error("unable to write compiled shader to " + temporary_path.string());
+        file.write((const char*)spirv.data(), spirv.size() * sizeof(uint32_t));
+    }
+    std::filesystem::rename(temporary_path, shader_out_path);
 
-std::filesystem::path compile_shader(std::string filepath) {
-    std::filesystem::path shader_path(filepath);
-    std::filesystem::path shader_out_path(filepath);
-    shader_path.make_preferred();
-    shader_out_path.concat(".spv");
-    shader_out_path.make_preferred();
-    std::stringstream compile_command;
-    compile_command << GLSLC_EXECUTABLE << " --target-env=vulkan1.3 -O -o " << std::filesystem::absolute(shader_out_path) << " " << std::filesystem::absolute(shader_path);
-    std::cout << "COMPILING SHADER: " << compile_command.str() << std::endl;
-    system(compile_command.str().c_str());
     return shader_out_path;
-}
\ No newline at end of file
+}
+
+std::vector<std::filesystem::path> compile_shaders(std::vector<std::string> paths, std::vector<std::string> defines) {
+    PROFILE_ZONE("compile_shaders");
+    std::vector<std::future<std::filesystem::path>> compilations;
+    for (auto& path : paths) {
+        compilations.push_back(std::async(std::launch::async, compile_shader, path, defines));
+    }
+
+    std::vector<std::filesystem::path> results;
+    for (auto& compilation : compilations) {
+        results.push_back(compilation.get());
+    }
+    return results;
+}
@@ -1,6 +1,18 @@
 #pragma once
 
 #include <string>
+#include <vector>
 #include <filesystem>
 
-std::filesystem::path compile_shader(std::string path);
\ No newline at end of file
+// compiles a glsl shader to spir-v and returns the path of the compiled module
+// modules are cached by a hash of the source, all included files and defines, unchanged shaders are not recompiled
+std::filesystem::path compile_shader(std::string path, std::vector<std::string> defines = {});
+
+// returns the shader and all files it includes
+std::vector<std::filesystem::path> get_shader_sources(std::string path);
+
+// true if the shader or any file it includes is one of the given files
+bool shader_depends_on(std::string path, const std::vector<std::filesystem::path>& files);
+
+// compiles multiple shaders in parallel, paths are returned in input order
+std::vector<std::filesystem::path> compile_shaders(std::vector<std::string> paths, std::vector<std::string> defines = {});
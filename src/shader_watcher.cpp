@@ -0,0 +1,128 @@
+#include "shader_watcher.h"
+
+#include <iostream>
+#include <unordered_set>
+
+#ifdef __linux__
+#include <sys/inotify.h>
+#include <unistd.h>
+#include <cerrno>
+#include <cstring>
+#endif
+
+#ifdef __linux__
+// editors either rewrite files in place or replace them by renaming a temporary file
+static const uint32_t watch_mask = IN_CLOSE_WRITE | IN_MOVED_TO | IN_CREATE | IN_DELETE_SELF;
+
+void ShaderWatcher::add_watch(std::filesystem::path path) {
+    int watch = inotify_add_watch(inotify_fd, path.string().c_str(), watch_mask);
+    if (watch < 0) {
+        std::cout << "could not watch " << path << ": " << std::strerror(errno) << std::endl;
+        return;
+    }
+    watched_directories[watch] = path;
+}
+
+void ShaderWatcher::init(std::string directory) {
+    this->directory = std::filesystem::path(directory).lexically_normal();
+
+    inotify_fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    if (inotify_fd < 0) {
+        std::cout << "inotify unavailable, shader hot reload disabled: " << std::strerror(errno) << std::endl;
+        return;
+    }
+
+    // inotify watches are not recursive, every subdirectory gets its own watch
+    add_watch(this->directory);
+    std::error_code error;
+    for (auto& entry : std::filesystem::recursive_directory_iterator(this->directory, error)) {
+        if (entry.is_directory()) add_watch(entry.path().lexically_normal());
+    }
+}
+
+std::vector<std::filesystem::path> ShaderWatcher::poll() {
+    std::vector<std::filesystem::path> modified_files;
+    if (inotify_fd < 0) return modified_files;
+
+    std::unordered_set<std::string> seen;
+    alignas(inotify_event) char events[4096];
+    while (true) {
+        ssize_t length = read(inotify_fd, events, sizeof(events));
+        if (length <= 0) break;
+
+        for (char* pointer = events; pointer < events + length;) {
+            inotify_event* event = (inotify_event*)pointer;
+            pointer += sizeof(inotify_event) + event->len;
+
+            auto watched_directory = watched_directories.find(event->wd);
+            if (watched_directory == watched_directories.end()) continue;
+            if (event->mask & (IN_DELETE_SELF | IN_IGNORED)) {
+                watched_directories.erase(watched_directory);
+                continue;
+            }
+            if (event->len == 0) continue;
+
+            std::filesystem::path path = watched_directory->second / event->name;
+            if (event->mask & IN_ISDIR) {
+                if (event->mask & (IN_CREATE | IN_MOVED_TO)) add_watch(path);
+                continue;
+            }
+            // newly created files are reported once their content is written
+            if (event->mask & IN_CREATE) continue;
+
+            if (seen.insert(path.string()).second) modified_files.push_back(path);
+        }
+    }
+
+    return modified_files;
+}
+
+void ShaderWatcher::free() {
+    if (inotify_fd >= 0) {
+        close(inotify_fd);
+        inotify_fd = -1;
+    }
+    watched_directories.clear();
+}
+#else
+void ShaderWatcher::scan(std::vector<std::filesystem::path>* modified_files) {
+    std::error_code error;
+    for (auto& entry : std::filesystem::recursive_directory_iterator(directory, error)) {
+        if (!entry.is_regular_file()) continue;
+
+        std::filesystem::path path = entry.path().lexically_normal();
+        std::filesystem::file_time_type modification_time = entry.last_write_time(error);
+        if (error) continue;
+
+        auto previous = modification_times.find(path.string());
+        if (previous == modification_times.end()) {
+            modification_times[path.string()] = modification_time;
+            if (modified_files != nullptr) modified_files->push_back(path);
+        } else if (previous->second != modification_time) {
+            previous->second = modification_time;
+            if (modified_files != nullptr) modified_files->push_back(path);
+        }
+    }
+}
+
+void ShaderWatcher::init(std::string directory) {
+    this->directory = std::filesystem::path(directory).lexically_normal();
+    last_scan = std::chrono::steady_clock::now();
+    scan(nullptr);
+}
+
+std::vector<std::filesystem::path> ShaderWatcher::poll() {
+    std::vector<std::filesystem::path> modified_files;
+
+    auto now = std::chrono::steady_clock::now();
+    if (now - last_scan < poll_interval) return modified_files;
+    last_scan = now;
+
+    scan(&modified_files);
+    return modified_files;
+}
+
+void ShaderWatcher::free() {
+    modification_times.clear();
+}
+#endif
@@ -0,0 +1,37 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <filesystem>
+#include <unordered_map>
+#include <chrono>
+
+// reports modified files below a shader directory without blocking
+// uses inotify on linux, other platforms fall back to comparing modification times
+struct ShaderWatcher {
+    // minimum time between modification time scans of the fallback
+    std::chrono::milliseconds poll_interval{250};
+
+    void init(std::string directory);
+
+    // returns files modified since the last call, each file at most once
+    std::vector<std::filesystem::path> poll();
+
+    void free();
+
+    private:
+    std::filesystem::path directory;
+
+#ifdef __linux__
+    int inotify_fd = -1;
+    // maps watch descriptor -> watched directory
+    std::unordered_map<int, std::filesystem::path> watched_directories;
+
+    void add_watch(std::filesystem::path path);
+#else
+    std::chrono::steady_clock::time_point last_scan;
+    std::unordered_map<std::string, std::filesystem::file_time_type> modification_times;
+
+    void scan(std::vector<std::filesystem::path>* modified_files);
+#endif
+};
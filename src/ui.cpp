@@ -15,6 +15,7 @@ void UI::draw() {
     changed = false;
     hovered = false;
     render_scale_changed = false;
+    lights_changed = false;
 
     ImGui::Begin("Scene Inspector");
     hovered |= ImGui::IsWindowHovered();
@@ -25,6 +26,7 @@ void UI::draw() {
     changed |= ImGui::SliderFloat("Camera FOV", &camera_fov, 1.0, 180.0);
     changed |= ImGui::DragInt("Max Depth", &max_ray_depth, 0.2f, 1, 16);
     changed |= ImGui::DragInt("Frame Samples", &frame_samples, 0.2f, 1, 64);
+    changed |= ImGui::DragInt("Russian Roulette Depth", &russian_roulette_depth, 0.2f, 0, 16);
     
     ImGui::SeparatorText("Display");
 
@@ -43,8 +45,41 @@ void UI::draw() {
 
     render_scale_changed |= ImGui::SliderFloat("Render Scale", &render_scale, 0.1, 1.0);
 
+    // overrides render scale and frame samples from measured frame times
+    QualityController& quality = application->get_quality_controller();
+    ImGui::Checkbox("Automatic Quality", &quality.enabled);
+    if (quality.enabled) {
+        ImGui::DragFloat("Target Frame Time (ms)", &quality.target_frame_time, 0.1f, 1.0f, 1000.0f);
+        ImGui::SliderFloat("Min Render Scale", &quality.min_render_scale, 0.1f, 1.0f);
+        ImGui::DragInt("Max Frame Samples", &quality.max_frame_samples, 0.2f, 1, 64);
+        ImGui::Text("%.2f ms measured", quality.filtered_frame_time);
+    }
+
     changed |= ImGui::Checkbox("Direct Lighting", &direct_lighting_enabled);
     changed |= ImGui::Checkbox("Indirect Lighting", &indirect_lighting_enabled);
+    ImGui::Checkbox("Specialize Pipeline", &specialize_pipeline);
+
+    ImGui::SeparatorText("Integrator");
+    if (ImGui::BeginCombo("Integrator", get_integrator_name(integrator))) {
+        for (Integrator option : INTEGRATORS) {
+            if (ImGui::Selectable(get_integrator_name(option), option == integrator)) integrator = option;
+        }
+        ImGui::EndCombo();
+    }
+    if (integrator == Integrator::Wavefront) {
+        ImGui::Checkbox("Material Sorting", &wavefront_material_sorting);
+        ImGui::Checkbox("Coherence Sorting", &wavefront_coherence_sorting);
+        ImGui::Text("%.1f M Rays/s Traversal", application->get_traversal_rays_per_second() * 1e-6);
+    }
+
+    ImGui::SeparatorText("Adaptive Sampling");
+    ImGui::Checkbox("Enable Adaptive Sampling", &adaptive_sampling_enabled);
+    ImGui::SliderFloat("Error Threshold", &adaptive_threshold, 0.001f, 0.2f, "%.3f", ImGuiSliderFlags_Logarithmic);
+    ImGui::DragInt("Min Samples", &adaptive_min_samples, 0.2f, 2, 256);
+    ImGui::DragInt("Update Interval", &adaptive_update_interval, 0.2f, 1, 64);
+    if (adaptive_sampling_enabled) {
+        ImGui::Text("%u Active Pixels | %.4f Mean Error", application->get_adaptive_active_pixels(), application->get_adaptive_mean_error());
+    }
 
     changed |= ImGui::Checkbox("Use Processing Pipeline", &use_processing_pipeline);
     
@@ -56,6 +91,8 @@ void UI::draw() {
         application->set_pipeline_dirty();
         changed = true;
     }
+    ImGui::SameLine();
+    ImGui::Checkbox("Shader Hot Reload", &shader_hot_reload);
 
     ImGui::SeparatorText("Application Information");
     ImGui::Text("%.2f FPS", application->get_fps());
@@ -63,6 +100,43 @@ void UI::draw() {
     ImGui::Text("Mouse Position: %.2f/%.2f", application->get_cursor_position().x, application->get_cursor_position().y);
     ImGui::Text("Color: %.2f/%.2f/%.2f", color_under_cursor.r, color_under_cursor.g, color_under_cursor.b);
 
+    // gpu pass timings
+    if (ImGui::CollapsingHeader("GPU Timings")) {
+        GPUProfiler& profiler = application->get_gpu_profiler();
+        ImGui::Checkbox("Enable Profiling", &profiler.enabled);
+        if (ImGui::BeginTable("##gpu_timings", 5, ImGuiTableFlags_RowBg | ImGuiTableFlags_SizingFixedFit)) {
+            ImGui::TableSetupColumn("Pass (ms)");
+            ImGui::TableSetupColumn("Avg");
+            ImGui::TableSetupColumn("P50");
+            ImGui::TableSetupColumn("P95");
+            ImGui::TableSetupColumn("P99");
+            ImGui::TableHeadersRow();
+            for (auto& zone : profiler.get_statistics()) {
+                ImGui::TableNextRow();
+                ImGui::TableNextColumn();
+                ImGui::Indent(zone.depth * 8.0f + 1.0f);
+                ImGui::TextUnformatted(zone.name.c_str());
+                ImGui::Unindent(zone.depth * 8.0f + 1.0f);
+                ImGui::TableNextColumn(); ImGui::Text("%.3f", zone.average);
+                ImGui::TableNextColumn(); ImGui::Text("%.3f", zone.percentile_50);
+                ImGui::TableNextColumn(); ImGui::Text("%.3f", zone.percentile_95);
+                ImGui::TableNextColumn(); ImGui::Text("%.3f", zone.percentile_99);
+            }
+            ImGui::EndTable();
+        }
+
+        ImGui::Checkbox("Record Timings", &profiler.recording);
+        ImGui::SameLine();
+        ImGui::Text("%zu Frames", profiler.get_recorded_frame_count());
+        if (ImGui::Button("Export Timings CSV")) {
+            profiler.save_csv("gpu_timings.csv");
+        }
+        ImGui::SameLine();
+        if (ImGui::Button("Clear Timings")) {
+            profiler.clear_recording();
+        }
+    }
+
     // realtime editing of light sources (point lights)
     ImGui::SeparatorText("Light Sources");
     auto scene_lights = application->get_scene_data().lights;
@@ -76,11 +150,11 @@ void UI::draw() {
         auto name_suffix = std::string("(").append(light_name).append(")");
         if (ImGui::CollapsingHeader(light_name.c_str())) {
             if (light.type == LightData::LightType::POINT) {
-                changed |= ImGui::DragFloat3(std::string("Position").append(name_suffix).c_str(), (float*)&data.float_data);
-                changed |= ImGui::DragFloat3(std::string("Intensity").append(name_suffix).c_str(), (float*)&data.float_data[3]);
+                lights_changed |= ImGui::DragFloat3(std::string("Position").append(name_suffix).c_str(), (float*)&data.float_data);
+                lights_changed |= ImGui::DragFloat3(std::string("Intensity").append(name_suffix).c_str(), (float*)&data.float_data[3]);
             } else if (light.type == LightData::LightType::DIRECTIONAL) {
-                changed |= ImGui::DragFloat3(std::string("Direction").append(name_suffix).c_str(), (float*)&data.float_data);
-                changed |= ImGui::DragFloat3(std::string("Intensity").append(name_suffix).c_str(), (float*)&data.float_data[3]);
+                lights_changed |= ImGui::DragFloat3(std::string("Direction").append(name_suffix).c_str(), (float*)&data.float_data);
+                lights_changed |= ImGui::DragFloat3(std::string("Intensity").append(name_suffix).c_str(), (float*)&data.float_data[3]);
             }
         }
     }
@@ -102,9 +176,9 @@ void UI::draw() {
             ImGui::Text("Metallic");
             changed |= ImGui::SliderFloat("##metallic_factor_slider", (float*)&selected_instance_parameters->roughness_metallic_transmissive_ior.y, 0.0, 1.0);
             ImGui::Text("Emission Color");
-            changed |= ImGui::ColorPicker3("##emissive_color_picker", (float*)&selected_instance_parameters->emissive_factor);
+            lights_changed |= ImGui::ColorPicker3("##emissive_color_picker", (float*)&selected_instance_parameters->emissive_factor);
             ImGui::Text("Emission Strength");
-            changed |= ImGui::DragFloat("##emissive_factor_slider", (float*)&selected_instance_parameters->emissive_factor.a, 1.0, 0.0, FLT_MAX);
+            lights_changed |= ImGui::DragFloat("##emissive_factor_slider", (float*)&selected_instance_parameters->emissive_factor.a, 1.0, 0.0, FLT_MAX);
             ImGui::Text("Transmission");
             changed |= ImGui::SliderFloat("##transmissive_factor_slider", (float*)&selected_instance_parameters->roughness_metallic_transmissive_ior.z, 0.0, 1.0);
             ImGui::Text("IOR");
@@ -113,6 +187,9 @@ void UI::draw() {
         }
     }
 
+    // light edits also restart accumulation
+    changed |= lights_changed;
+
     ImGui::End();
     hovered |= ImGui::IsAnyItemHovered() | ImGui::IsAnyItemFocused() | ImGui::IsAnyItemActive();
 }
@@ -125,6 +202,10 @@ bool UI::has_render_scale_changed() {
     return render_scale_changed;
 }
 
+bool UI::has_lights_changed() {
+    return lights_changed;
+}
+
 bool UI::is_hovered() {
     return hovered;
 }
\ No newline at end of file
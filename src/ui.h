@@ -7,12 +7,15 @@ using ivec3 = glm::ivec3;
 struct VulkanApplication;
 
 #include "loaders/scene.h"
+#include "pipeline/raytracing/integrator.h"
 
 struct UI {
 private:
     bool changed = false;
     bool hovered = false;
     bool render_scale_changed = false;
+    // light parameters or emission, the light tree has to be rebuilt
+    bool lights_changed = false;
     VulkanApplication* application;
 
     std::vector<std::string> output_image_names;
@@ -27,10 +30,29 @@ public:
     vec3 color_under_cursor = vec3(0);
     int max_ray_depth = 5;
     int frame_samples = 1;
-    bool direct_lighting_enabled;
-    bool indirect_lighting_enabled;
+    // bounces before paths are terminated by russian roulette, 0 disables it
+    int russian_roulette_depth = 3;
+    bool direct_lighting_enabled = true;
+    bool indirect_lighting_enabled = true;
+
+    // adaptive sampling only traces pixels whose relative error is above the threshold
+    bool adaptive_sampling_enabled = false;
+    float adaptive_threshold = 0.02f;
+    int adaptive_min_samples = 16;
+    // frames between compactions of the unconverged pixel list
+    int adaptive_update_interval = 8;
+
+    Integrator integrator = Integrator::RaytracingPipeline;
+    // wavefront integrator: shade hits ordered by material
+    bool wavefront_material_sorting = true;
+    // wavefront integrator: trace secondary rays ordered by origin cell and direction octant
+    bool wavefront_coherence_sorting = false;
 
     bool use_processing_pipeline = false;
+    // trace with a pipeline variant specialized for the current render settings, each new combination builds a pipeline
+    bool specialize_pipeline = false;
+    // recompile shaders when files in the shader directory change
+    bool shader_hot_reload = true;
 
     float exposure = 0.0f;
     float camera_speed = 1.0f;
@@ -40,5 +62,6 @@ public:
     void draw();
     bool has_changed();
     bool has_render_scale_changed();
+    bool has_lights_changed();
     bool is_hovered();
 };
\ No newline at end of file
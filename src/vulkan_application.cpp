@@ -1,13 +1,20 @@
 #include "vulkan_application.h"
 
 #include <set>
+#include <map>
 #include <iostream>
+#include <iomanip>
 #include <stdexcept>
 #include <filesystem>
+#include <algorithm>
 
 #include "exr_export.h"
+#include "core/cpu_profiler.h"
+#include "core/color.h"
+#include "core/alias_table.h"
 
 #include "loaders/shader_spirv.h"
+#include "shader_compiler.h"
 #include "loaders/geometry_gltf.h"
 
 #include "glm/gtc/matrix_transform.hpp"
@@ -121,6 +128,7 @@ MeshData VulkanApplication::create_mesh_data(std::vector<uint32_t> &indices, std
 }
 
 AccelerationStructure VulkanApplication::build_blas(std::vector<uint32_t> &indices, std::vector<vec3> &vertices, uint32_t max_vertex) {
+    PROFILE_ZONE("build_blas");
     std::cout << "building BLAS with " << vertices.size() << " vertices and " << indices.size() << " indices" << std::endl;
 
     VkAccelerationStructureGeometryKHR geometry{};
@@ -206,6 +214,7 @@ AccelerationStructure VulkanApplication::build_blas(std::vector<uint32_t> &indic
 }
 
 AccelerationStructure VulkanApplication::build_tlas() {
+    PROFILE_ZONE("build_tlas");
     std::vector<VkAccelerationStructureInstanceKHR> instances;
 
     std::cout << "Building TLAS for " << loaded_scene_data.instances.size() << " instances" << std::endl;
@@ -341,7 +350,205 @@ AccelerationStructure VulkanApplication::build_tlas() {
     return result;
 }
 
+void VulkanApplication::load_scene() {
+    PROFILE_ZONE_DETAIL("load_scene", scene_path.string());
+    loaded_scene_data = loaders::load_scene_description(scene_path.string());
+
+    // load environment map, kept resident if it did not change
+    std::string environment_key;
+    std::string environment_path;
+    if (loaded_scene_data.environment_path.empty()) {
+        vec3 color = loaded_scene_data.environment_color;
+        environment_key = "color:" + std::to_string(color.r) + "," + std::to_string(color.g) + "," + std::to_string(color.b);
+    } else {
+        environment_path = std::filesystem::absolute(scene_path.parent_path() / std::filesystem::path(loaded_scene_data.environment_path)).lexically_normal().string();
+        // maps with a different sampling resolution are reloaded
+        environment_key = environment_path + "@" + std::to_string(loaded_scene_data.environment_sampling_width);
+    }
+
+    if (environment_key != loaded_environment_key) {
+        if (!loaded_environment_key.empty()) {
+            loaded_environment.image.free();
+            loaded_environment.conditional_distribution.free();
+            loaded_environment.marginal_distribution.free();
+        }
+        if (loaded_scene_data.environment_path.empty()) {
+            loaded_environment = loaders::load_default_environment_map(&device, loaded_scene_data.environment_color);
+        } else {
+            loaded_environment = loaders::load_environment_map(&device, environment_path, loaded_scene_data.environment_sampling_width);
+        }
+        loaded_environment_key = environment_key;
+    } else {
+        std::cout << "reusing environment map " << environment_key << std::endl;
+    }
+
+    loaded_textures.clear();
+    loaded_textures.push_back(loaded_environment.image);
+    loaded_textures.push_back(loaded_environment.conditional_distribution);
+    loaded_textures.push_back(loaded_environment.marginal_distribution);
+
+    // build blas of loaded meshes
+    // objects are cached by path, objects shared with the previously loaded scene are not reloaded
+    std::unordered_map<std::string, LoadedObject> previous_objects = std::move(object_cache);
+    object_cache.clear();
+    loaded_objects.clear();
+    loaded_mesh_index.clear();
+    loaded_texture_index.clear();
+    created_meshes.clear();
+    created_blas.clear();
+
+    for (auto object_path : loaded_scene_data.object_paths) {
+        auto full_object_path = std::filesystem::absolute(scene_path.parent_path() / std::filesystem::path(std::get<1>(object_path))).lexically_normal();
+        auto object_name = std::get<0>(object_path);
+        auto object_key = full_object_path.string();
+
+        auto previous_object = previous_objects.find(object_key);
+        if (previous_object != previous_objects.end()) {
+            std::cout << "Reusing scene object " << object_name << std::endl;
+            object_cache[object_key] = previous_object->second;
+            previous_objects.erase(previous_object);
+        } else if (object_cache.find(object_key) == object_cache.end()) {
+            std::cout << "Loading scene object " << object_name << std::endl;
+            PROFILE_ZONE_DETAIL("load scene object", object_name);
+            LoadedObject object;
+            object.gltf = loaders::load_gltf(full_object_path.string());
+            // if (gltf_processor) {
+            //     gltf_processor->set_data(&gltf);
+            //     gltf_processor->process();
+            // }
+            for (auto &mesh : object.gltf.meshes) {
+                for (auto &primitive : mesh.primitives) {
+                    object.meshes.push_back(create_mesh_data(primitive.indices, primitive.vertices, primitive.normals, primitive.uvs, primitive.tangents));
+                    object.blas.push_back(build_blas(primitive.indices, primitive.vertices, primitive.max_vertex));
+                }
+            }
+
+            auto texture_directory = full_object_path;
+            texture_directory.remove_filename();
+            std::cout << "loading " << object.gltf.textures.size() << " textures" << std::endl;
+            for (const auto &texture : object.gltf.textures) {
+                auto full_path = texture_directory / texture.path;
+                object.textures.push_back(loaders::load_image(&device, full_path.string(), 0, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, VK_ACCESS_SHADER_READ_BIT));
+            }
+            object_cache[object_key] = object;
+        }
+
+        const LoadedObject& object = object_cache[object_key];
+        loaded_objects[object_name] = object.gltf;
+        loaded_mesh_index[object_name] = created_meshes.size();
+        created_meshes.insert(created_meshes.end(), object.meshes.begin(), object.meshes.end());
+        created_blas.insert(created_blas.end(), object.blas.begin(), object.blas.end());
+        loaded_texture_index[object_name] = loaded_textures.size();
+        loaded_textures.insert(loaded_textures.end(), object.textures.begin(), object.textures.end());
+
+        std::cout << "meshes after " << object_name << ": " << created_meshes.size() << "|" << created_blas.size() << " | textures starting at index " << loaded_texture_index[object_name] << std::endl;
+    }
+
+    // objects no longer referenced by the scene
+    for (auto& object : previous_objects) {
+        free_loaded_object(object.second);
+    }
+
+    std::cout << "Loaded " << loaded_objects.size() << " scene objects:" << std::endl;
+    for (auto key = loaded_objects.begin(); key != loaded_objects.end(); key++) {
+        std::cout << key->first.c_str() << ": " << loaded_mesh_index[key->first] << std::endl;
+    }
+
+    std::cout << "Created " << created_blas.size() << " Mesh BLASes" << std::endl;
+
+    lights.clear();
+    light_bounds.clear();
+    material_parameters.clear();
+    for (auto light_data : loaded_scene_data.lights) {
+        Shaders::Light light;
+        light.uint_data[0] = light_data.type;
+        switch (light_data.type) {
+            case LightData::LightType::POINT:
+                light.float_data[0] = light_data.position.x;
+                light.float_data[1] = light_data.position.y;
+                light.float_data[2] = light_data.position.z;
+                
+                light.float_data[3] = light_data.intensity.x;
+                light.float_data[4] = light_data.intensity.y;
+                light.float_data[5] = light_data.intensity.z;
+                break;
+            case LightData::LightType::DIRECTIONAL:
+                light.float_data[0] = light_data.direction.x;
+                light.float_data[1] = light_data.direction.y;
+                light.float_data[2] = light_data.direction.z;
+                
+                light.float_data[3] = light_data.intensity.x;
+                light.float_data[4] = light_data.intensity.y;
+                light.float_data[5] = light_data.intensity.z;
+                break;
+        }
+        lights.push_back(light);
+        light_bounds.push_back(LightBounds());
+    }
+    std::cout << "Loaded " << lights.size() << " lights" << std::endl;
+
+    scene_tlas = build_tlas();
+
+    std::cout << "Scene TLAS constructed" << std::endl;
+}
+
+void VulkanApplication::free_loaded_object(LoadedObject& object) {
+    for (auto& mesh : object.meshes) {
+        mesh.free();
+    }
+    for (auto& blas : object.blas) {
+        device.vkDestroyAccelerationStructureKHR(logical_device, blas.acceleration_structure, nullptr);
+        blas.buffer.free();
+    }
+    for (auto& texture : object.textures) {
+        texture.free();
+    }
+}
+
+void VulkanApplication::free_scene_resources() {
+    // handles are reset so a failed scene load does not free them again
+    if (scene_tlas.acceleration_structure != VK_NULL_HANDLE) device.vkDestroyAccelerationStructureKHR(logical_device, scene_tlas.acceleration_structure, nullptr);
+    scene_tlas.acceleration_structure = VK_NULL_HANDLE;
+    scene_tlas.buffer.free();
+
+    index_buffer.free();
+    vertex_buffer.free();
+    normal_buffer.free();
+    texcoord_buffer.free();
+    tangent_buffer.free();
+    mesh_data_offset_buffer.free();
+    mesh_offset_index_buffer.free();
+    texture_index_buffer.free();
+    material_parameter_buffer.free();
+    lights_buffer.free();
+    light_tree_buffer.free();
+    light_distribution_buffer.free();
+    restir_reservoir_buffer_0.free();
+    restir_reservoir_buffer_1.free();
+    prev_camera_matrix_buffer.free();
+}
+
+void VulkanApplication::change_scene(std::filesystem::path path) {
+    PROFILE_ZONE("change_scene");
+    vkDeviceWaitIdle(logical_device);
+
+    // device, pipelines and cached objects stay resident, only per-scene data is rebuilt
+    free_scene_resources();
+    scene_path = path;
+    try {
+        load_scene();
+    } catch (const std::runtime_error&) {
+        // the next job has to load the scene again, even if it uses the same path
+        scene_path.clear();
+        throw;
+    }
+    create_default_descriptor_writes();
+    p_pipeline_builder.on_scene_changed();
+    render_images_dirty = true;
+}
+
 void VulkanApplication::create_default_descriptor_writes() {
+    PROFILE_ZONE("create_default_descriptor_writes");
     rt_pipeline.set_descriptor_acceleration_structure_binding(scene_tlas.acceleration_structure);
 
     // prepare mesh data for buffers
@@ -383,6 +590,9 @@ void VulkanApplication::create_default_descriptor_writes() {
 
     std::cout << "INSTANCE DATA" << std::endl;
 
+    // materials of different objects are numbered consecutively, primitives without a material share the default one
+    std::map<std::pair<std::string, int>, uint32_t> material_indices;
+
     // index of mesh and texture used by instance
     for (auto instance : loaded_scene_data.instances) {
 
@@ -408,8 +618,14 @@ void VulkanApplication::create_default_descriptor_writes() {
                 instance.texture_indices.transmissive = material.transmission_texture == -1 ? NULL_TEXTURE_INDEX : material.transmission_texture + texture_index_offset;
 
                 instance.material_parameters.diffuse_opacity = material.diffuse_factor;
-                instance.material_parameters.emissive_factor = material.emission_texture == -1 ? vec4(1,1,1,0) : vec4(material.emissive_factor.r, material.emissive_factor.g, material.emissive_factor.b, 1.0);
+                // materials without emission keep a white color at zero strength for editing
+                bool emissive = material.emission_texture != -1 || material.emissive_factor != vec3(0.0f);
+                instance.material_parameters.emissive_factor = emissive ? vec4(material.emissive_factor, 1.0) : vec4(1,1,1,0);
                 instance.material_parameters.roughness_metallic_transmissive_ior = vec4(material.roughness_factor, material.metallic_factor, material.transmission_factor, material.ior);
+                instance.material_parameters.flags = material.double_sided ? MATERIAL_FLAG_DOUBLE_SIDED : 0;
+                auto material_key = std::make_pair(material_index == -1 ? std::string() : instance.object_name, material_index);
+                auto material_entry = material_indices.emplace(material_key, (uint32_t)material_indices.size()).first;
+                instance.material_parameters.material_index = material_entry->second;
 
                 // pairs of 5 textures: diffuse, normal, roughness, emissive, transmissive
                 texture_indices.push_back(instance.texture_indices.diffuse);
@@ -455,48 +671,106 @@ void VulkanApplication::create_default_descriptor_writes() {
     rt_pipeline.set_descriptor_buffer_binding("texture_indices", texture_index_buffer, BufferType::Storage);
     rt_pipeline.set_descriptor_buffer_binding("material_parameters", material_parameter_buffer, BufferType::Storage);
 
+    // every primitive with an emissive material becomes an area light
+    // instances are counted like the material parameters, one per primitive of each node
     int created_area_lights = 0;
-    for (int instance_index = 0; instance_index < loaded_scene_data.instances.size(); instance_index++) {
-        auto instance = loaded_scene_data.instances[instance_index];
-        auto object = loaded_objects[instance.object_name];
-        for (auto node : object.nodes) {
-            auto mesh = object.meshes[node.mesh_index];
-            uint32_t primitive_index = 0;
-            for (auto primitive : mesh.primitives) {
-                uint32_t material_index = primitive.material_index;
-                if (material_index != -1 && object.materials[primitive.material_index].emission_texture > -1) {
-                    Shaders::Light light;
-                    light.uint_data[0] = LightData::LightType::AREA;
-                    light.uint_data[1] = instance_index + primitive_index;
-                    light.uint_data[2] = primitive.vertices.size();
-
-                    mat4 transform = instance.transformation * node.matrix;
-
-                    light.float_data[0] = transform[0][0];
-                    light.float_data[1] = transform[1][0];
-                    light.float_data[2] = transform[2][0];
-                    light.float_data[3] = transform[3][0];
-                    light.float_data[4] = transform[0][1];
-                    light.float_data[5] = transform[1][1];
-                    light.float_data[6] = transform[2][1];
-                    light.float_data[7] = transform[3][1];
-                    light.float_data[8] = transform[0][2];
-                    light.float_data[9] = transform[1][2];
-                    light.float_data[10] = transform[2][2];
-                    light.float_data[11] = transform[3][2];
-                    light.float_data[12] = transform[0][3];
-                    light.float_data[13] = transform[1][3];
-                    light.float_data[14] = transform[2][3];
-                    light.float_data[15] = transform[3][3];
-
-                    lights.push_back(light);
-                    created_area_lights++;
+    uint32_t primitive_instance_index = 0;
+    vec3 scene_min(FLT_MAX), scene_max(-FLT_MAX);
+    std::vector<Shaders::AliasTableEntry> triangle_distributions;
+    for (const auto& instance : loaded_scene_data.instances) {
+        const auto& object = loaded_objects[instance.object_name];
+        for (const auto& node : object.nodes) {
+            const auto& mesh = object.meshes[node.mesh_index];
+            mat4 transform = instance.transformation * node.matrix;
+            for (const auto& primitive : mesh.primitives) {
+                uint32_t instance_index = primitive_instance_index++;
+                for (auto& vertex : primitive.vertices) {
+                    vec3 position = transform * vec4(vertex, 1.0);
+                    scene_min = glm::min(scene_min, position);
+                    scene_max = glm::max(scene_max, position);
+                }
+
+                vec4 emission = material_parameters[instance_index].emissive_factor;
+                if (emission.a <= 0.0f || vec3(emission) == vec3(0.0f) || primitive.indices.size() < 3) continue;
+
+                Shaders::Light light;
+                light.uint_data[0] = LightData::LightType::AREA;
+                light.uint_data[1] = instance_index;
+                light.uint_data[2] = primitive.indices.size() / 3;
+                // offset into the light distribution buffer, the top level distribution is added once all lights are known
+                light.uint_data[3] = triangle_distributions.size();
+
+                light.float_data[0] = transform[0][0];
+                light.float_data[1] = transform[1][0];
+                light.float_data[2] = transform[2][0];
+                light.float_data[3] = transform[3][0];
+                light.float_data[4] = transform[0][1];
+                light.float_data[5] = transform[1][1];
+                light.float_data[6] = transform[2][1];
+                light.float_data[7] = transform[3][1];
+                light.float_data[8] = transform[0][2];
+                light.float_data[9] = transform[1][2];
+                light.float_data[10] = transform[2][2];
+                light.float_data[11] = transform[3][2];
+                light.float_data[12] = transform[0][3];
+                light.float_data[13] = transform[1][3];
+                light.float_data[14] = transform[2][3];
+                light.float_data[15] = transform[3][3];
+
+                // world space bounds, surface area and cone of front face normals of the emitting triangles
+                LightBounds bounds = LightBounds::point(transform * vec4(primitive.vertices[0], 1.0), 0.0f);
+                bool double_sided = (material_parameters[instance_index].flags & MATERIAL_FLAG_DOUBLE_SIDED) != 0;
+                // mirroring transforms flip the winding of front faces
+                float winding = glm::determinant(glm::mat3(transform)) < 0.0f ? -1.0f : 1.0f;
+                bool has_normal = false;
+                for (auto& vertex : primitive.vertices) {
+                    vec3 position = transform * vec4(vertex, 1.0);
+                    bounds.bounds_min = glm::min(bounds.bounds_min, position);
+                    bounds.bounds_max = glm::max(bounds.bounds_max, position);
+                }
+
+                // the emission factor is shared by all triangles, so their power follows their area
+                std::vector<float> triangle_areas;
+                for (size_t index = 0; index + 2 < primitive.indices.size(); index += 3) {
+                    vec3 v0 = transform * vec4(primitive.vertices[primitive.indices[index]], 1.0);
+                    vec3 v1 = transform * vec4(primitive.vertices[primitive.indices[index + 1]], 1.0);
+                    vec3 v2 = transform * vec4(primitive.vertices[primitive.indices[index + 2]], 1.0);
+                    vec3 normal = winding * glm::cross(v1 - v0, v2 - v0);
+                    float area = 0.5f * glm::length(normal);
+                    triangle_areas.push_back(area);
+                    bounds.area += area;
+
+                    if (area <= 0.0f) continue;
+                    if (has_normal) {
+                        bounds.merge_cone(glm::normalize(normal), 0.0f);
+                    } else {
+                        bounds.axis = glm::normalize(normal);
+                        bounds.theta_o = 0.0f;
+                        has_normal = true;
+                    }
                 }
-                primitive_index++;
+                // one sided emitters light the hemisphere around each normal, double sided ones all directions
+                if (double_sided || !has_normal) bounds.theta_o = glm::pi<float>();
+                bounds.theta_e = glm::half_pi<float>();
+                auto distribution = build_alias_table(triangle_areas);
+                triangle_distributions.insert(triangle_distributions.end(), distribution.begin(), distribution.end());
+
+                lights.push_back(light);
+                light_bounds.push_back(bounds);
+                created_area_lights++;
             }
         }
     }
-    std::cout << "Created " << created_area_lights << " area lights from scene geometry with emissive maps" << std::endl;
+    std::cout << "Created " << created_area_lights << " area lights from emissive scene geometry" << std::endl;
+
+    scene_radius = scene_min.x <= scene_max.x ? 0.5f * glm::length(scene_max - scene_min) : 1.0f;
+    scene_bounds_min = scene_min.x <= scene_max.x ? scene_min : vec3(-1.0f);
+    scene_bounds_max = scene_min.x <= scene_max.x ? scene_max : vec3(1.0f);
+
+    size_t top_level_distribution_size = LightTree::get_top_level_distribution_size(light_bounds);
+    for (auto& light : lights) {
+        if (light.uint_data[0] == LightData::LightType::AREA) light.uint_data[3] += top_level_distribution_size;
+    }
 
     int light_buffer_size = lights.size();
     if (light_buffer_size < 1) light_buffer_size = 1;
@@ -505,6 +779,13 @@ void VulkanApplication::create_default_descriptor_writes() {
 
     rt_pipeline.set_descriptor_buffer_binding("lights", lights_buffer, BufferType::Storage);
 
+    light_tree_buffer = device.create_buffer(LightTree::get_buffer_size(lights.size()));
+    light_distribution_buffer = device.create_buffer(sizeof(Shaders::AliasTableEntry) * (top_level_distribution_size + triangle_distributions.size()));
+    if (!triangle_distributions.empty()) light_distribution_buffer.set_data(triangle_distributions.data(), sizeof(Shaders::AliasTableEntry) * top_level_distribution_size, sizeof(Shaders::AliasTableEntry) * triangle_distributions.size());
+    update_light_tree();
+    rt_pipeline.set_descriptor_buffer_binding("light_tree", light_tree_buffer, BufferType::Storage);
+    rt_pipeline.set_descriptor_buffer_binding("light_distributions", light_distribution_buffer, BufferType::Storage);
+
     // ReSTIR
     restir_reservoir_buffer_0 = device.create_buffer(sizeof(Shaders::Reservoir) * swap_chain_extent.width * swap_chain_extent.height, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT);
     restir_reservoir_buffer_1 = device.create_buffer(sizeof(Shaders::Reservoir) * swap_chain_extent.width * swap_chain_extent.height, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT);
@@ -522,6 +803,38 @@ void VulkanApplication::create_default_descriptor_writes() {
     rt_pipeline.set_descriptor_buffer_binding("previous_camera_matrix", prev_camera_matrix_buffer, BufferType::Uniform);
 }
 
+// importance estimates follow the current light parameters and emission strengths
+void VulkanApplication::update_light_tree() {
+    for (size_t i = 0; i < lights.size(); i++) {
+        auto& light = lights[i];
+        switch (light.uint_data[0]) {
+            case LightData::LightType::POINT:
+                light_bounds[i] = LightBounds::point(vec3(light.float_data[0], light.float_data[1], light.float_data[2]), color::luminance(vec3(light.float_data[3], light.float_data[4], light.float_data[5])));
+                break;
+            case LightData::LightType::DIRECTIONAL:
+                light_bounds[i] = LightBounds::directional(color::luminance(vec3(light.float_data[3], light.float_data[4], light.float_data[5])));
+                break;
+            case LightData::LightType::AREA: {
+                uint32_t material_index = light.uint_data[1];
+                vec4 emission = material_index < material_parameters.size() ? material_parameters[material_index].emissive_factor : vec4(0.0);
+                light_bounds[i].power = color::luminance(vec3(emission) * emission.a) * light_bounds[i].area;
+                break;
+            }
+        }
+    }
+
+    PROFILE_ZONE("build light tree");
+    light_tree.build(light_bounds, glm::pi<float>() * loaded_environment.average_luminance, scene_radius);
+    light_tree.upload(light_tree_buffer, light_distribution_buffer);
+
+    // hits on emissive instances find the leaf of their light to weight the emission against next event estimation
+    for (auto& parameters : material_parameters) parameters.light_node = NULL_LIGHT_NODE;
+    for (size_t i = 0; i < lights.size(); i++) {
+        uint32_t material_index = lights[i].uint_data[1];
+        if (lights[i].uint_data[0] == LightData::LightType::AREA && material_index < material_parameters.size()) material_parameters[material_index].light_node = light_tree.leaf_nodes[i];
+    }
+}
+
 void VulkanApplication::create_synchronization() {
     VkSemaphoreCreateInfo semaphore_info{};
     semaphore_info.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
@@ -704,6 +1017,50 @@ void VulkanApplication::create_framebuffers() {
     }
 }
 
+void VulkanApplication::create_render_pass() {
+    VkAttachmentDescription color_attachment{};
+    color_attachment.format = device.surface_format.format;
+    color_attachment.samples = VK_SAMPLE_COUNT_1_BIT;
+    color_attachment.loadOp = VK_ATTACHMENT_LOAD_OP_LOAD;
+    color_attachment.storeOp = VK_ATTACHMENT_STORE_OP_STORE;
+    color_attachment.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
+    color_attachment.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+    color_attachment.initialLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+    color_attachment.finalLayout = VK_IMAGE_LAYOUT_PRESENT_SRC_KHR;
+
+    VkAttachmentReference color_attachment_ref{};
+    color_attachment_ref.attachment = 0;
+    color_attachment_ref.layout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
+
+    VkSubpassDescription subpass{};
+    subpass.pipelineBindPoint = VK_PIPELINE_BIND_POINT_GRAPHICS;
+    subpass.colorAttachmentCount = 1;
+    subpass.pColorAttachments = &color_attachment_ref;
+    subpass.inputAttachmentCount = 0;
+
+    VkSubpassDependency dependency{};
+    dependency.srcSubpass = VK_SUBPASS_EXTERNAL;
+    dependency.dstSubpass = 0;
+    dependency.srcStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
+    dependency.srcAccessMask = 0;
+    dependency.dstStageMask = VK_PIPELINE_STAGE_ALL_GRAPHICS_BIT;
+    dependency.dstAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
+
+    VkRenderPassCreateInfo render_pass_info{};
+    render_pass_info.sType = VK_STRUCTURE_TYPE_RENDER_PASS_CREATE_INFO;
+    render_pass_info.attachmentCount = 1;
+    render_pass_info.pAttachments = &color_attachment;
+    render_pass_info.subpassCount = 1;
+    render_pass_info.pSubpasses = &subpass;
+    render_pass_info.dependencyCount = 1;
+    render_pass_info.pDependencies = &dependency;
+
+    if (vkCreateRenderPass(logical_device, &render_pass_info, nullptr, &render_pass) != VK_SUCCESS)
+    {
+        throw std::runtime_error("failure to create render pass");
+    }
+}
+
 void VulkanApplication::recreate_swapchain() {
     vkDeviceWaitIdle(device.vulkan_device);
 
@@ -746,24 +1103,63 @@ void VulkanApplication::recreate_swapchain() {
 }
 
 void VulkanApplication::recreate_render_images() {
-    render_scale  = ui.render_scale;
-    render_image_extent = {(uint32_t)(swap_chain_extent.width * render_scale), (uint32_t)(swap_chain_extent.height * render_scale)};
-    
+    PROFILE_ZONE("recreate_render_images");
+    // buffers are allocated for the largest render scale, scaling only changes the rendered sub-extent
+    render_buffer_extent = swap_chain_extent;
+    resize_render_buffers();
+
+    apply_render_scale();
+}
+
+void VulkanApplication::apply_render_scale() {
+    render_scale = std::clamp(ui.render_scale, 0.01f, 1.0f);
+    render_image_extent = {std::max(1u, (uint32_t)(render_buffer_extent.width * render_scale)), std::max(1u, (uint32_t)(render_buffer_extent.height * render_scale))};
+    render_full_extent = render_image_extent;
+    render_tile_offset = {0, 0};
+
+    clear_accumulated_frames();
+}
+
+void VulkanApplication::resize_render_buffers() {
     VkCommandBuffer cmdbuf = device.begin_single_use_command_buffer();
-    rt_pipeline.cmd_on_resize(cmdbuf, render_image_extent);
+    rt_pipeline.cmd_on_resize(cmdbuf, render_buffer_extent);
     p_pipeline_builder.rt_pipeline = &rt_pipeline;
-    p_pipeline_builder.cmd_on_resize(cmdbuf, swap_chain_extent, render_image_extent);
+    p_pipeline_builder.cmd_on_resize(cmdbuf, swap_chain_extent, render_buffer_extent);
     device.end_single_use_command_buffer(cmdbuf);
 
     restir_reservoir_buffer_0.free();
-    restir_reservoir_buffer_0 = device.create_buffer(sizeof(Shaders::Reservoir) * render_image_extent.width * render_image_extent.height, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT);
+    restir_reservoir_buffer_0 = device.create_buffer(sizeof(Shaders::Reservoir) * render_buffer_extent.width * render_buffer_extent.height, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT);
     rt_pipeline.set_descriptor_buffer_binding("restir_reservoirs", restir_reservoir_buffer_0, BufferType::Storage, 0);
     restir_reservoir_buffer_1.free();
-    restir_reservoir_buffer_1 = device.create_buffer(sizeof(Shaders::Reservoir) * render_image_extent.width * render_image_extent.height, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT);
+    restir_reservoir_buffer_1 = device.create_buffer(sizeof(Shaders::Reservoir) * render_buffer_extent.width * render_buffer_extent.height, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT);
     rt_pipeline.set_descriptor_buffer_binding("restir_reservoirs", restir_reservoir_buffer_1, BufferType::Storage, 1);
 
+    // indirect trace command header followed by one index per pixel, one error sum per compaction workgroup
+    uint32_t pixel_count = render_buffer_extent.width * render_buffer_extent.height;
+    uint32_t compaction_group_count = ((render_buffer_extent.width + 7) / 8) * ((render_buffer_extent.height + 7) / 8);
+    adaptive_sampling_buffer.free();
+    adaptive_sampling_buffer = device.create_buffer(sizeof(uint32_t) * (4 + pixel_count), VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT);
+    rt_pipeline.set_descriptor_buffer_binding("adaptive_sampling", adaptive_sampling_buffer, BufferType::Storage);
+    adaptive_error_buffer.free();
+    adaptive_error_buffer = device.create_buffer(sizeof(float) * compaction_group_count, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT);
+    // recreated buffers can reuse previous handles
+    adaptive_compact_shader->invalidate_descriptors();
+    output_decode_shader->invalidate_descriptors();
+    adaptive_compact_shader->set_buffer(0, &rt_pipeline.get_output_buffer("Variance").buffer);
+    adaptive_compact_shader->set_buffer(1, &adaptive_sampling_buffer);
+    adaptive_compact_shader->set_buffer(2, &adaptive_error_buffer);
+
+    if (active_integrator == Integrator::Wavefront) wavefront_integrator.resize(rt_pipeline, render_buffer_extent);
+
+    if (!headless) {
+        output_display_buffer.free();
+        output_display_buffer = device.create_buffer(sizeof(vec4) * pixel_count, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_SRC_BIT);
+        output_decode_shader->set_buffer(1, &output_display_buffer);
+    }
+
     if (render_transfer_image.width > 0) render_transfer_image.free();
-    render_transfer_image = device.create_image(swap_chain_extent.width, swap_chain_extent.height, VK_IMAGE_USAGE_STORAGE_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT, 1, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT, VK_FORMAT_R32G32B32A32_SFLOAT, VK_FILTER_LINEAR, VK_SAMPLER_ADDRESS_MODE_REPEAT);
+    // headless rendering reads output buffers directly
+    if (!headless) render_transfer_image = device.create_image(swap_chain_extent.width, swap_chain_extent.height, VK_IMAGE_USAGE_STORAGE_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT, 1, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, VK_FORMAT_R32G32B32A32_SFLOAT, VK_FILTER_LINEAR, VK_SAMPLER_ADDRESS_MODE_REPEAT);
 
     render_images_dirty = false;
     vkDeviceWaitIdle(device.vulkan_device);
@@ -771,17 +1167,186 @@ void VulkanApplication::recreate_render_images() {
     clear_accumulated_frames();
 }
 
+Shaders::PushConstantsPacked VulkanApplication::get_push_constants() {
+    Shaders::PushConstantsPacked push_constants_packed;
+    push_constants_packed.stride_rr_fsample_depth = (uint8_t)ui.max_ray_depth | ((uint8_t)ui.frame_samples << 8) | ((uint8_t)ui.russian_roulette_depth << 16) | ((uint8_t)rt_pipeline.sbt_stride << 24);
+    push_constants_packed.sample_count = accumulated_frames;
+    push_constants_packed.frame = application_frames;
+    // push_constants.sbt_stride = rt_pipeline.sbt_stride;
+    // push_constants.frame = application_frames;
+    // push_constants.sample_count = accumulated_frames;
+    // push_constants.light_count = lights.size();
+    // push_constants.max_depth = ui.max_ray_depth;
+    // push_constants.frame_samples = ui.frame_samples;
+    // push_constants.exposure = ui.exposure;
+    push_constants_packed.exposure = ui.exposure;
+    push_constants_packed.env_dim_xy = ((uint16_t)loaded_environment.conditional_distribution.width << 16) | ((uint16_t)loaded_environment.conditional_distribution.height);
+    // push_constants.swapchain_extent = Shaders::uvec2(swap_chain_extent.width, swap_chain_extent.height);
+    push_constants_packed.sc_ext_xy = ((uint16_t)swap_chain_extent.width << 16) | ((uint16_t)swap_chain_extent.height);
+    // push_constants.render_extent = Shaders::uvec2(render_image_extent.width, render_image_extent.height);
+    push_constants_packed.r_ext_xy = ((uint16_t)render_image_extent.width << 16) | ((uint16_t)render_image_extent.height);
+    push_constants_packed.tile_offset_xy = ((uint16_t)render_tile_offset.x << 16) | ((uint16_t)render_tile_offset.y);
+    push_constants_packed.img_ext_xy = ((uint16_t)render_full_extent.width << 16) | ((uint16_t)render_full_extent.height);
+    push_constants_packed.adaptive_threshold = ui.adaptive_threshold;
+    push_constants_packed.adaptive_min_frames = get_adaptive_min_frames();
+    // push_constants.inv_camera_matrix = glm::inverse(camera_matrix);
+    push_constants_packed.inv_camera_matrix = glm::inverse(camera_matrix);
+    // push_constants.camera_position = Shaders::vec4(camera_position, 1.0);
+    push_constants_packed.camera_position = Shaders::vec4(camera_position, 1.0);        
+    uint32_t flags = 0;
+    if (ui.direct_lighting_enabled) flags |= ENABLE_DIRECT_LIGHTING;
+    if (ui.indirect_lighting_enabled) flags |= ENABLE_INDIRECT_LIGHTING;
+    if (adaptive_sampling_active) flags |= ADAPTIVE_SAMPLING;
+    // push_constants.flags = flags;
+    push_constants_packed.flags = flags;
+    return push_constants_packed;
+}
+
+RaytracingPipelineSettings VulkanApplication::get_pipeline_settings() {
+    RaytracingPipelineSettings settings;
+    settings.max_depth = (uint32_t)ui.max_ray_depth;
+    settings.frame_samples = (uint32_t)ui.frame_samples;
+    settings.light_count = (uint32_t)lights.size();
+    settings.lighting_flags = 0;
+    if (ui.direct_lighting_enabled) settings.lighting_flags |= ENABLE_DIRECT_LIGHTING;
+    if (ui.indirect_lighting_enabled) settings.lighting_flags |= ENABLE_INDIRECT_LIGHTING;
+    return settings;
+}
+
+uint32_t VulkanApplication::get_adaptive_min_frames() {
+    // variance estimates need at least two accumulated frames per pixel
+    uint32_t frame_samples = std::max(ui.frame_samples, 1);
+    return std::max(2u, ((uint32_t)ui.adaptive_min_samples + frame_samples - 1) / frame_samples);
+}
+
+void VulkanApplication::cmd_compact_adaptive_pixels(VkCommandBuffer command_buffer, Shaders::PushConstantsPacked& push_constants_packed) {
+    device.gpu_profiler.cmd_begin_zone(command_buffer, "Adaptive Compaction");
+
+    // variance of previous frames is read, the previous indirect command is overwritten
+    VkMemoryBarrier barrier {};
+    barrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+    barrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+    barrier.dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT | VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT;
+    vkCmdPipelineBarrier(command_buffer, VK_PIPELINE_STAGE_RAY_TRACING_SHADER_BIT_KHR | VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT | VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, 0, 1, &barrier, 0, nullptr, 0, nullptr);
+
+    // reset the indirect command to a one-dimensional launch over zero pixels
+    uint32_t header[4] = {0, 1, 1, 0};
+    vkCmdUpdateBuffer(command_buffer, adaptive_sampling_buffer.buffer_handle, 0, sizeof(header), header);
+
+    barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+    barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT;
+    vkCmdPipelineBarrier(command_buffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, 0, 1, &barrier, 0, nullptr, 0, nullptr);
+
+    uint32_t groups_x = (render_image_extent.width + adaptive_compact_shader->local_dispatch_size_x - 1) / adaptive_compact_shader->local_dispatch_size_x;
+    uint32_t groups_y = (render_image_extent.height + adaptive_compact_shader->local_dispatch_size_y - 1) / adaptive_compact_shader->local_dispatch_size_y;
+    adaptive_compact_shader->dispatch(command_buffer, groups_x, groups_y, 1, push_constants_packed);
+
+    // pixel list is read by the trace, the command by the indirect launch and error sums by the host
+    barrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+    barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_INDIRECT_COMMAND_READ_BIT | VK_ACCESS_HOST_READ_BIT;
+    vkCmdPipelineBarrier(command_buffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_RAY_TRACING_SHADER_BIT_KHR | VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT | VK_PIPELINE_STAGE_HOST_BIT, 0, 1, &barrier, 0, nullptr, 0, nullptr);
+
+    device.gpu_profiler.cmd_end_zone(command_buffer);
+
+    adaptive_statistics_pending = true;
+}
+
+Shaders::PushConstantsPacked VulkanApplication::cmd_trace_rays(VkCommandBuffer command_buffer) {
+    // once every pixel has the minimum frame count, only pixels of the compacted list are traced
+    uint32_t min_frames = get_adaptive_min_frames();
+    // compute integrators trace every pixel
+    adaptive_sampling_active = active_integrator == Integrator::RaytracingPipeline && ui.adaptive_sampling_enabled && device.trace_rays_indirect_supported && accumulated_frames > min_frames;
+    bool compact_pixels = adaptive_sampling_active && (accumulated_frames - min_frames - 1) % std::max(ui.adaptive_update_interval, 1) == 0;
+
+    Shaders::PushConstantsPacked push_constants_packed = get_push_constants();
+
+    if (compact_pixels) cmd_compact_adaptive_pixels(command_buffer, push_constants_packed);
+
+    // fixed settings (headless and batch rendering, or when requested) run a variant with the settings baked in
+    bool specialized = headless || ui.specialize_pipeline;
+    RaytracingPipelineSettings settings = get_pipeline_settings();
+
+    if (active_integrator != Integrator::RaytracingPipeline) {
+        if (active_integrator == Integrator::Wavefront) {
+            wavefront_integrator.cmd_render(command_buffer, push_constants_packed, render_image_extent, (uint32_t)ui.max_ray_depth, (uint32_t)ui.frame_samples);
+            wavefront_integrator.cmd_copy_statistics(command_buffer, readback, application_frames);
+        } else {
+            megakernel_integrator.cmd_render(command_buffer, push_constants_packed, render_image_extent, specialized ? &settings : nullptr);
+        }
+
+        // outputs are decoded, processed and read back after the trace
+        VkMemoryBarrier barrier {};
+        barrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+        barrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+        barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_TRANSFER_READ_BIT | VK_ACCESS_HOST_READ_BIT;
+        vkCmdPipelineBarrier(command_buffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT | VK_PIPELINE_STAGE_RAY_TRACING_SHADER_BIT_KHR | VK_PIPELINE_STAGE_TRANSFER_BIT | VK_PIPELINE_STAGE_HOST_BIT, 0, 1, &barrier, 0, nullptr, 0, nullptr);
+        return push_constants_packed;
+    }
+
+    vkCmdPushConstants(command_buffer, rt_pipeline.builder->pipeline_layout, RAYTRACING_PIPELINE_LAYOUT_STAGES, 0, sizeof(Shaders::PushConstantsPacked), &push_constants_packed);
+
+    vkCmdBindDescriptorSets(command_buffer, VK_PIPELINE_BIND_POINT_RAY_TRACING_KHR, rt_pipeline.builder->pipeline_layout, 0, rt_pipeline.builder->max_set + 1, rt_pipeline.builder->descriptor_sets.data(), 0, nullptr);
+
+    VkPipeline pipeline_handle = rt_pipeline.pipeline_handle;
+    ShaderBindingTable* sbt = &rt_pipeline.sbt;
+    if (specialized) {
+        RaytracingPipelineVariant& variant = rt_pipeline.get_variant(settings);
+        pipeline_handle = variant.pipeline_handle;
+        sbt = &variant.sbt;
+    }
+
+    vkCmdBindPipeline(command_buffer, VK_PIPELINE_BIND_POINT_RAY_TRACING_KHR, pipeline_handle);
+    device.gpu_profiler.cmd_begin_zone(command_buffer, "Trace Rays");
+    if (adaptive_sampling_active) {
+        device.vkCmdTraceRaysIndirectKHR(command_buffer, &sbt->region_raygen, &sbt->region_miss, &sbt->region_hit, &sbt->region_callable, adaptive_sampling_buffer.get_device_address());
+    } else {
+        device.vkCmdTraceRaysKHR(command_buffer, &sbt->region_raygen, &sbt->region_miss, &sbt->region_hit, &sbt->region_callable, render_image_extent.width, render_image_extent.height, 1);
+    }
+    device.gpu_profiler.cmd_end_zone(command_buffer);
+
+    return push_constants_packed;
+}
+
+// reads back the result of the last compaction, call after its command buffer has completed
+void VulkanApplication::update_adaptive_statistics() {
+    if (!adaptive_statistics_pending) return;
+    adaptive_statistics_pending = false;
+
+    uint32_t group_count = ((render_image_extent.width + 7) / 8) * ((render_image_extent.height + 7) / 8);
+    std::vector<float> group_errors(group_count);
+    adaptive_error_buffer.get_data(group_errors.data(), 0, sizeof(float) * group_count);
+
+    double error_sum = 0.0;
+    for (float error : group_errors) error_sum += error;
+    adaptive_mean_error = error_sum / (render_image_extent.width * render_image_extent.height);
+
+    adaptive_sampling_buffer.get_data(&adaptive_active_pixels, 0, sizeof(uint32_t));
+}
+
 void VulkanApplication::draw_frame() {
+    PROFILE_ZONE("draw_frame");
     uint32_t image_index;
-    vkAcquireNextImageKHR(logical_device, swap_chain, UINT64_MAX, image_available_semaphore, VK_NULL_HANDLE, &image_index);
+    {
+        PROFILE_ZONE("acquire image");
+        vkAcquireNextImageKHR(logical_device, swap_chain, UINT64_MAX, image_available_semaphore, VK_NULL_HANDLE, &image_index);
+    }
 
     vkResetCommandPool(logical_device, command_pool, 0);
 
+    // results of earlier frames' readbacks
+    readback.deliver();
+
+    update_requested_outputs();
+
     if (pipeline_dirty) {
         rebuild_pipeline();
     }
 
-    if (render_images_dirty | ui.has_render_scale_changed()) {recreate_render_images();}
+    update_integrator();
+    update_shader_reload();
+
+    if (render_images_dirty) {recreate_render_images();}
+    else if (ui.has_render_scale_changed()) {apply_render_scale();}
 
     // command buffer begin
     VkCommandBufferBeginInfo begin_info{};
@@ -795,6 +1360,12 @@ void VulkanApplication::draw_frame() {
             throw std::runtime_error("error beginning command buffer");
         }
 
+        // the wavefront integrator records zones per kernel, bounce and frame sample
+        if (active_integrator == Integrator::Wavefront) device.gpu_profiler.reserve_queries(wavefront_integrator.get_query_count((uint32_t)ui.max_ray_depth, (uint32_t)ui.frame_samples));
+        device.gpu_profiler.cmd_begin_frame(command_buffer);
+
+        // light and emission edits change the importance estimates and the light tree leaves of emissive instances
+        if (ui.has_lights_changed()) update_light_tree();
         material_parameter_buffer.set_data(material_parameters.data(), 0, sizeof(InstanceData::MaterialParameters) * material_parameters.size());
         if (lights.size() > 0) lights_buffer.set_data(lights.data(), 0, sizeof(Shaders::Light) * lights.size());
 
@@ -803,39 +1374,8 @@ void VulkanApplication::draw_frame() {
 
         if (accumulated_frames < std::numeric_limits<uint32_t>::max()) accumulated_frames += 1;
 
-        Shaders::PushConstantsPacked push_constants_packed;
-        push_constants_packed.stride_lcount_fsample_depth = (uint8_t)ui.max_ray_depth | ((uint8_t)ui.frame_samples << 8) | ((uint8_t)lights.size() << 16) | ((uint8_t)rt_pipeline.sbt_stride << 24);
-        push_constants_packed.sample_count = accumulated_frames;
-        push_constants_packed.frame = application_frames;
-        // push_constants.sbt_stride = rt_pipeline.sbt_stride;
-        // push_constants.frame = application_frames;
-        // push_constants.sample_count = accumulated_frames;
-        // push_constants.light_count = lights.size();
-        // push_constants.max_depth = ui.max_ray_depth;
-        // push_constants.frame_samples = ui.frame_samples;
-        // push_constants.exposure = ui.exposure;
-        push_constants_packed.exposure = ui.exposure;
-        // push_constants.environment_cdf_dimensions = Shaders::uvec2(loaded_environment.conditional_cdf_map.width, loaded_environment.conditional_cdf_map.height);
-        push_constants_packed.env_dim_xy = ((uint16_t)loaded_environment.conditional_cdf_map.width << 16) | ((uint16_t)loaded_environment.conditional_cdf_map.height);
-        // push_constants.swapchain_extent = Shaders::uvec2(swap_chain_extent.width, swap_chain_extent.height);
-        push_constants_packed.sc_ext_xy = ((uint16_t)swap_chain_extent.width << 16) | ((uint16_t)swap_chain_extent.height);
-        // push_constants.render_extent = Shaders::uvec2(render_image_extent.width, render_image_extent.height);
-        push_constants_packed.r_ext_xy = ((uint16_t)render_image_extent.width << 16) | ((uint16_t)render_image_extent.height);
-        // push_constants.inv_camera_matrix = glm::inverse(camera_matrix);
-        push_constants_packed.inv_camera_matrix = glm::inverse(camera_matrix);
-        // push_constants.camera_position = Shaders::vec4(camera_position, 1.0);
-        push_constants_packed.camera_position = Shaders::vec4(camera_position, 1.0);        
-        uint32_t flags = 0;
-        if (ui.direct_lighting_enabled) flags |= ENABLE_DIRECT_LIGHTING;
-        if (ui.indirect_lighting_enabled) flags |= ENABLE_INDIRECT_LIGHTING;
-        // push_constants.flags = flags;
-        push_constants_packed.flags = flags;
-        vkCmdPushConstants(command_buffer, rt_pipeline.builder->pipeline_layout, VK_SHADER_STAGE_RAYGEN_BIT_KHR | VK_SHADER_STAGE_CLOSEST_HIT_BIT_KHR | VK_SHADER_STAGE_MISS_BIT_KHR, 0, sizeof(Shaders::PushConstantsPacked), &push_constants_packed);
-
         // raytracer draw
-        vkCmdBindDescriptorSets(command_buffer, VK_PIPELINE_BIND_POINT_RAY_TRACING_KHR, rt_pipeline.builder->pipeline_layout, 0, rt_pipeline.builder->max_set + 1, rt_pipeline.builder->descriptor_sets.data(), 0, nullptr);
-        vkCmdBindPipeline(command_buffer, VK_PIPELINE_BIND_POINT_RAY_TRACING_KHR, rt_pipeline.pipeline_handle);
-        device.vkCmdTraceRaysKHR(command_buffer, &rt_pipeline.sbt.region_raygen, &rt_pipeline.sbt.region_miss, &rt_pipeline.sbt.region_hit, &rt_pipeline.sbt.region_callable, render_image_extent.width, render_image_extent.height, 1);
+        Shaders::PushConstantsPacked push_constants_packed = cmd_trace_rays(command_buffer);
 
         OutputBuffer selected_output = rt_pipeline.get_output_buffer(ui.selected_output_image);
 
@@ -884,14 +1424,19 @@ void VulkanApplication::draw_frame() {
             throw std::runtime_error("error submitting draw command buffer");
         }
 
-        vkWaitForFences(logical_device, 1, &in_flight_fence, VK_TRUE, UINT64_MAX);
+        {
+            PROFILE_ZONE("wait for trace rays");
+            vkWaitForFences(logical_device, 1, &in_flight_fence, VK_TRUE, UINT64_MAX);
+        }
         vkResetFences(logical_device, 1, &in_flight_fence);
 
+        update_adaptive_statistics();
+
         if (vkBeginCommandBuffer(command_buffer, &begin_info) != VK_SUCCESS)    {
             throw std::runtime_error("error beginning command buffer");
         }
 
-        Buffer* output_image_buffer = &selected_output.buffer;
+        Buffer* output_image_buffer = cmd_decode_output(command_buffer, selected_output);
         VkExtent2D output_image_extent = render_image_extent;
 
         if (ui.use_processing_pipeline) {
@@ -909,21 +1454,30 @@ void VulkanApplication::draw_frame() {
         output_buffer_copy.imageSubresource.layerCount = 1;
         output_buffer_copy.imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
 
+        device.gpu_profiler.cmd_begin_zone(command_buffer, "Buffer To Image Copy");
         render_transfer_image.transition_layout(command_buffer, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 0);
 
         vkCmdCopyBufferToImage(command_buffer, output_image_buffer->buffer_handle, render_transfer_image.image_handle, render_transfer_image.layout, 1, &output_buffer_copy);
         render_transfer_image.transition_layout(command_buffer, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, 0);
-        
+        device.gpu_profiler.cmd_end_zone(command_buffer);
+        display_extent = output_image_extent;
+
         vec2 cursor_pos = get_cursor_position();
         if (cursor_pos.x >= 0 && cursor_pos.x < swap_chain_extent.width && cursor_pos.y >= 0 && cursor_pos.y < swap_chain_extent.height) {
-            uint32_t cursor_pixel_offset = (uint32_t)(cursor_pos.x * render_scale) + (uint32_t)(cursor_pos.y * render_scale) * render_image_extent.width;
-            vec4* data;
-            vkMapMemory(render_transfer_image.device->vulkan_device, render_transfer_image.texture_memory, render_transfer_image.texture_memory_offset, VK_WHOLE_SIZE, 0, (void**)&data);
-            vec4 color = data[cursor_pixel_offset];
-            ui.color_under_cursor = vec3(color.r, color.g, color.b);
-            vkUnmapMemory(render_transfer_image.device->vulkan_device, render_transfer_image.texture_memory);
+            ReadbackRegion cursor_region;
+            cursor_region.x = (uint32_t)(cursor_pos.x * output_image_extent.width / swap_chain_extent.width);
+            cursor_region.y = (uint32_t)(cursor_pos.y * output_image_extent.height / swap_chain_extent.height);
+            readback.request(cursor_region, [this](ReadbackResult& result) {
+                vec4 color;
+                memcpy(&color, result.data.data(), sizeof(vec4));
+                ui.color_under_cursor = vec3(color.r, color.g, color.b);
+            });
         }
 
+        device.gpu_profiler.cmd_begin_zone(command_buffer, "Readback");
+        readback.cmd_copy(command_buffer, render_transfer_image, application_frames);
+        device.gpu_profiler.cmd_end_zone(command_buffer);
+
         VkImageBlit transfer_blit {};
         transfer_blit.srcSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
         transfer_blit.srcSubresource.layerCount = 1;
@@ -934,7 +1488,9 @@ void VulkanApplication::draw_frame() {
         transfer_blit.dstOffsets[0] = {0,0,0};
         transfer_blit.dstOffsets[1] = {(int)swap_chain_extent.width, (int)swap_chain_extent.height, 1};
 
+        device.gpu_profiler.cmd_begin_zone(command_buffer, "Blit");
         vkCmdBlitImage(command_buffer, render_transfer_image.image_handle, render_transfer_image.layout, swap_chain_images[image_index], VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &transfer_blit, VK_FILTER_NEAREST);
+        device.gpu_profiler.cmd_end_zone(command_buffer);
     }
 
 
@@ -963,13 +1519,18 @@ void VulkanApplication::draw_frame() {
     ImGui_ImplVulkan_NewFrame();
     ImGui::NewFrame();
 
-    ui.draw();
+    {
+        PROFILE_ZONE("ui");
+        ui.draw();
+    }
 
     ImGui::Render();
+    device.gpu_profiler.cmd_begin_zone(command_buffer, "ImGui");
     vkCmdBeginRenderPass(command_buffer, &render_pass_info, VK_SUBPASS_CONTENTS_INLINE);
     ImDrawData* draw_data = ImGui::GetDrawData();
     ImGui_ImplVulkan_RenderDrawData(draw_data, command_buffer);
     vkCmdEndRenderPass(command_buffer);
+    device.gpu_profiler.cmd_end_zone(command_buffer);
 
     if (vkEndCommandBuffer(command_buffer) != VK_SUCCESS) {
         throw std::runtime_error("encountered an error when ending command buffer");
@@ -1014,9 +1575,27 @@ void VulkanApplication::draw_frame() {
 
     glfwSetWindowTitle(window, ("Vulkan Renderer | FPS: " + std::to_string(1.0 / frame_delta.count())).c_str());
 
-    vkWaitForFences(logical_device, 1, &in_flight_fence, VK_TRUE, UINT64_MAX);
+    {
+        PROFILE_ZONE("wait for frame");
+        vkWaitForFences(logical_device, 1, &in_flight_fence, VK_TRUE, UINT64_MAX);
+    }
     vkResetFences(logical_device, 1, &in_flight_fence);
 
+    device.gpu_profiler.end_frame();
+    readback.complete_frame(application_frames);
+    if (active_integrator == Integrator::Wavefront) {
+        // the ray count is delivered now so it pairs with the profiler timings of the same frame
+        readback.deliver();
+        wavefront_integrator.update_statistics();
+    }
+
+    // prefer gpu timings, the cpu frame time also contains vsync and ui
+    double measured_frame_time = device.gpu_profiler.enabled ? device.gpu_profiler.last_frame_time : frame_delta.count() * 1000.0;
+    int previous_frame_samples = ui.frame_samples;
+    if (quality_controller.update(measured_frame_time, ui.render_scale, ui.frame_samples)) apply_render_scale();
+    // sample indices of the pixel sequences depend on the samples per frame
+    else if (ui.frame_samples != previous_frame_samples) clear_accumulated_frames();
+
     application_frames++;
 }
 
@@ -1030,15 +1609,16 @@ void VulkanApplication::setup_device() {
     device.graphics_queue_family_index = queue_family_indices.graphics_compute.value();
 
     // load function pointers
-    device.vkGetAccelerationStructureBuildSizesKHR = (PFN_vkGetAccelerationStructureBuildSizesKHR)glfwGetInstanceProcAddress(vulkan_instance, "vkGetAccelerationStructureBuildSizesKHR");
-    device.vkCreateAccelerationStructureKHR = (PFN_vkCreateAccelerationStructureKHR)glfwGetInstanceProcAddress(vulkan_instance, "vkCreateAccelerationStructureKHR");
-    device.vkCmdBuildAccelerationStructuresKHR = (PFN_vkCmdBuildAccelerationStructuresKHR)glfwGetInstanceProcAddress(vulkan_instance, "vkCmdBuildAccelerationStructuresKHR");
-    device.vkDestroyAccelerationStructureKHR = (PFN_vkDestroyAccelerationStructureKHR)glfwGetInstanceProcAddress(vulkan_instance, "vkDestroyAccelerationStructureKHR");
-    device.vkGetAccelerationStructureDeviceAddressKHR = (PFN_vkGetAccelerationStructureDeviceAddressKHR)glfwGetInstanceProcAddress(vulkan_instance, "vkGetAccelerationStructureDeviceAddressKHR");
-    device.vkCreateRayTracingPipelinesKHR = (PFN_vkCreateRayTracingPipelinesKHR)glfwGetInstanceProcAddress(vulkan_instance, "vkCreateRayTracingPipelinesKHR");
-    device.vkGetRayTracingShaderGroupHandlesKHR = (PFN_vkGetRayTracingShaderGroupHandlesKHR)glfwGetInstanceProcAddress(vulkan_instance, "vkGetRayTracingShaderGroupHandlesKHR");
-    device.vkCmdTraceRaysKHR = (PFN_vkCmdTraceRaysKHR)glfwGetInstanceProcAddress(vulkan_instance, "vkCmdTraceRaysKHR");
-    device.vkGetMemoryWin32HandleKHR = (PFN_vkGetMemoryWin32HandleKHR)glfwGetInstanceProcAddress(vulkan_instance, "vkGetMemoryWin32HandleKHR");
+    device.vkGetAccelerationStructureBuildSizesKHR = (PFN_vkGetAccelerationStructureBuildSizesKHR)vkGetDeviceProcAddr(logical_device, "vkGetAccelerationStructureBuildSizesKHR");
+    device.vkCreateAccelerationStructureKHR = (PFN_vkCreateAccelerationStructureKHR)vkGetDeviceProcAddr(logical_device, "vkCreateAccelerationStructureKHR");
+    device.vkCmdBuildAccelerationStructuresKHR = (PFN_vkCmdBuildAccelerationStructuresKHR)vkGetDeviceProcAddr(logical_device, "vkCmdBuildAccelerationStructuresKHR");
+    device.vkDestroyAccelerationStructureKHR = (PFN_vkDestroyAccelerationStructureKHR)vkGetDeviceProcAddr(logical_device, "vkDestroyAccelerationStructureKHR");
+    device.vkGetAccelerationStructureDeviceAddressKHR = (PFN_vkGetAccelerationStructureDeviceAddressKHR)vkGetDeviceProcAddr(logical_device, "vkGetAccelerationStructureDeviceAddressKHR");
+    device.vkCreateRayTracingPipelinesKHR = (PFN_vkCreateRayTracingPipelinesKHR)vkGetDeviceProcAddr(logical_device, "vkCreateRayTracingPipelinesKHR");
+    device.vkGetRayTracingShaderGroupHandlesKHR = (PFN_vkGetRayTracingShaderGroupHandlesKHR)vkGetDeviceProcAddr(logical_device, "vkGetRayTracingShaderGroupHandlesKHR");
+    device.vkCmdTraceRaysKHR = (PFN_vkCmdTraceRaysKHR)vkGetDeviceProcAddr(logical_device, "vkCmdTraceRaysKHR");
+    device.vkCmdTraceRaysIndirectKHR = (PFN_vkCmdTraceRaysIndirectKHR)vkGetDeviceProcAddr(logical_device, "vkCmdTraceRaysIndirectKHR");
+    device.vkGetMemoryWin32HandleKHR = (PFN_vkGetMemoryWin32HandleKHR)vkGetDeviceProcAddr(logical_device, "vkGetMemoryWin32HandleKHR");
 }
 
 void VulkanApplication::submit_immediate(std::function<void()> lambda) {
@@ -1086,6 +1666,7 @@ void check_vk_result(VkResult r) {
 }
 
 void VulkanApplication::init_imgui() {
+    PROFILE_ZONE("init_imgui");
     // 1: create descriptor pool for IMGUI
     // the size of the pool is very oversize, but it's copied from imgui demo itself.
     VkDescriptorPoolSize pool_sizes[] =
@@ -1130,7 +1711,7 @@ void VulkanApplication::init_imgui() {
     init_info.ImageCount = device.image_count;
     init_info.MSAASamples = VK_SAMPLE_COUNT_1_BIT;
     init_info.ColorAttachmentFormat = device.surface_format.format;
-    init_info.PipelineCache = rt_pipeline.pipeline_cache_handle;
+    init_info.PipelineCache = device.pipeline_cache;
     init_info.QueueFamily = queue_family_indices.graphics_compute.value();
     init_info.Subpass = 0;
     init_info.CheckVkResultFn = check_vk_result;
@@ -1146,10 +1727,13 @@ void VulkanApplication::init_imgui() {
 }
 
 void VulkanApplication::setup() {
-    glfwWindowHint(GLFW_CLIENT_API, GLFW_NO_API);
-    window = glfwCreateWindow(1280, 720, "Vulkan window", nullptr, nullptr);
-    glfwSetWindowUserPointer(window, this);
-    glfwSetWindowSizeLimits(window, 100, 100, GLFW_DONT_CARE, GLFW_DONT_CARE);
+    PROFILE_ZONE("setup");
+    if (!headless) {
+        glfwWindowHint(GLFW_CLIENT_API, GLFW_NO_API);
+        window = glfwCreateWindow(1280, 720, "Vulkan window", nullptr, nullptr);
+        glfwSetWindowUserPointer(window, this);
+        glfwSetWindowSizeLimits(window, 100, 100, GLFW_DONT_CARE, GLFW_DONT_CARE);
+    }
 
     startup_time = std::chrono::high_resolution_clock::now();
 
@@ -1167,9 +1751,10 @@ void VulkanApplication::setup() {
     create_info.sType = VK_STRUCTURE_TYPE_INSTANCE_CREATE_INFO;
     create_info.pApplicationInfo = &app_info;
 
+    // no surface extensions are needed when rendering headless
     uint32_t glfw_extension_count = 0;
-    const char **glfw_extensions;
-    glfw_extensions = glfwGetRequiredInstanceExtensions(&glfw_extension_count);
+    const char **glfw_extensions = nullptr;
+    if (!headless) glfw_extensions = glfwGetRequiredInstanceExtensions(&glfw_extension_count);
 
     std::vector<const char*> required_extensions(glfw_extensions, glfw_extensions + glfw_extension_count);
     // extension needed for vulkan debugging
@@ -1226,11 +1811,13 @@ void VulkanApplication::setup() {
     
 
     // create window surface
-    if (glfwCreateWindowSurface(vulkan_instance, window, nullptr, &surface) != VK_SUCCESS)
-    {
-        throw std::runtime_error("failed to create window surface");
+    if (!headless) {
+        if (glfwCreateWindowSurface(vulkan_instance, window, nullptr, &surface) != VK_SUCCESS)
+        {
+            throw std::runtime_error("failed to create window surface");
+        }
+        std::cout << "window surface created" << std::endl;
     }
-    std::cout << "window surface created" << std::endl;
 
     // physical device
     uint32_t physical_device_count = 0;
@@ -1243,32 +1830,39 @@ void VulkanApplication::setup() {
     vkEnumeratePhysicalDevices(vulkan_instance, &physical_device_count, physical_devices.data());
 
     // pick suitable physical device
+    // discrete gpus are preferred, otherwise the first device is used (e.g. integrated or software implementations)
     for (const auto &dev : physical_devices)
     {
-        // check device suitability
-        VkPhysicalDeviceProperties2 dev_properties{ VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PROPERTIES_2 };
-        
-        device.ray_tracing_pipeline_properties = VkPhysicalDeviceRayTracingPipelinePropertiesKHR{};
-        device.ray_tracing_pipeline_properties.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_RAY_TRACING_PIPELINE_PROPERTIES_KHR;
+        VkPhysicalDeviceProperties dev_properties;
+        vkGetPhysicalDeviceProperties(dev, &dev_properties);
 
-        device.acceleration_structure_properties = VkPhysicalDeviceAccelerationStructurePropertiesKHR{};
-        device.acceleration_structure_properties.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_ACCELERATION_STRUCTURE_PROPERTIES_KHR;
-        device.ray_tracing_pipeline_properties.pNext = &device.acceleration_structure_properties;
+        if (dev_properties.deviceType == VK_PHYSICAL_DEVICE_TYPE_DISCRETE_GPU)
+        {
+            physical_device = dev;
+            break;
+        }
+    }
+    if (physical_device == VK_NULL_HANDLE) physical_device = physical_devices[0];
+
+    {
+        VkPhysicalDeviceProperties2 dev_properties{ VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PROPERTIES_2 };
+        
+        device.ray_tracing_pipeline_properties = VkPhysicalDeviceRayTracingPipelinePropertiesKHR{};
+        device.ray_tracing_pipeline_properties.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_RAY_TRACING_PIPELINE_PROPERTIES_KHR;
+
+        device.acceleration_structure_properties = VkPhysicalDeviceAccelerationStructurePropertiesKHR{};
+        device.acceleration_structure_properties.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_ACCELERATION_STRUCTURE_PROPERTIES_KHR;
+        device.ray_tracing_pipeline_properties.pNext = &device.acceleration_structure_properties;
 
         dev_properties.pNext = &device.ray_tracing_pipeline_properties;
 
-        vkGetPhysicalDeviceProperties2(dev, &dev_properties);
+        vkGetPhysicalDeviceProperties2(physical_device, &dev_properties);
 
+        std::cout << "DEVICE " << dev_properties.properties.deviceName << std::endl;
         std::cout << "MAX INSTANCES " << device.acceleration_structure_properties.maxInstanceCount << " | MAX PRIMITIVES " << device.acceleration_structure_properties.maxPrimitiveCount << " | MAX ALLOCATIONS " << dev_properties.properties.limits.maxMemoryAllocationCount << std::endl;
 
-        VkPhysicalDeviceFeatures dev_features;
-        vkGetPhysicalDeviceFeatures(dev, &dev_features);
-
-        if (dev_properties.properties.deviceType == VK_PHYSICAL_DEVICE_TYPE_DISCRETE_GPU)
-        {
-            physical_device = dev;
-            break;
-        }
+        device.timestamp_period = dev_properties.properties.limits.timestampPeriod;
+        device.physical_device_properties = dev_properties.properties;
     }
 
     std::cout << "SBT STRIDE: " << device.ray_tracing_pipeline_properties.shaderGroupHandleSize << std::endl;
@@ -1289,7 +1883,15 @@ void VulkanApplication::setup() {
         if ((queue_family.queueFlags & VK_QUEUE_GRAPHICS_BIT) && (queue_family.queueFlags & VK_QUEUE_COMPUTE_BIT))
         {
             queue_family_indices.graphics_compute = std::make_optional(family_index);
+            device.timestamp_valid_bits = queue_family.timestampValidBits;
         }
+
+        if (headless) {
+            if (queue_family_indices.graphics_compute) break;
+            family_index++;
+            continue;
+        }
+
         VkBool32 present_support = false;
         vkGetPhysicalDeviceSurfaceSupportKHR(physical_device, family_index, surface, &present_support);
         if (present_support)
@@ -1303,13 +1905,28 @@ void VulkanApplication::setup() {
 
         family_index++;
     }
+
+    // compute-only devices are sufficient when rendering headless
+    if (headless && !queue_family_indices.graphics_compute) {
+        for (uint32_t i = 0; i < queue_families.size(); i++) {
+            if (queue_families[i].queueFlags & VK_QUEUE_COMPUTE_BIT) {
+                queue_family_indices.graphics_compute = std::make_optional(i);
+                device.timestamp_valid_bits = queue_families[i].timestampValidBits;
+                break;
+            }
+        }
+    }
+
+    if (!queue_family_indices.graphics_compute || (!headless && !queue_family_indices.present))
+        throw std::runtime_error("found no suitable queue families");
     
     std::cout << "valid physical device found" << std::endl;
 
     // create logical device
     {
         std::vector<VkDeviceQueueCreateInfo> queue_create_infos;
-        std::set<uint32_t> unique_queue_families = {queue_family_indices.graphics_compute.value(), queue_family_indices.present.value()};
+        std::set<uint32_t> unique_queue_families = {queue_family_indices.graphics_compute.value()};
+        if (queue_family_indices.present) unique_queue_families.insert(queue_family_indices.present.value());
         float queue_priority = 1.0f;
 
         for (uint32_t unique_family : unique_queue_families)
@@ -1326,9 +1943,7 @@ void VulkanApplication::setup() {
         VkPhysicalDeviceFeatures device_features{};
 
         // check for device extension support
-        const std::vector<const char *> device_extensions = {
-            // needed for window display
-            VK_KHR_SWAPCHAIN_EXTENSION_NAME,
+        std::vector<const char *> device_extensions = {
             // needed for vulkan raytracing functionality
             VK_KHR_ACCELERATION_STRUCTURE_EXTENSION_NAME,
             VK_KHR_RAY_TRACING_PIPELINE_EXTENSION_NAME,
@@ -1337,10 +1952,15 @@ void VulkanApplication::setup() {
             VK_KHR_DEFERRED_HOST_OPERATIONS_EXTENSION_NAME,
             // dependencies for compute shader functionality
             VK_KHR_MAINTENANCE_4_EXTENSION_NAME,
-            // dependencies for external memory handles
-            VK_KHR_EXTERNAL_MEMORY_WIN32_EXTENSION_NAME
         };
 
+        // needed for window display
+        if (!headless) device_extensions.push_back(VK_KHR_SWAPCHAIN_EXTENSION_NAME);
+#ifdef _WIN32
+        // dependencies for external memory handles
+        device_extensions.push_back(VK_KHR_EXTERNAL_MEMORY_WIN32_EXTENSION_NAME);
+#endif
+
         uint32_t extension_count = 0;
         vkEnumerateDeviceExtensionProperties(physical_device, nullptr, &extension_count, nullptr);
 
@@ -1384,9 +2004,19 @@ void VulkanApplication::setup() {
         physical_features2.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2;
         vkGetPhysicalDeviceFeatures2(physical_device, &physical_features2);
 
+        // indirect ray tracing is optional, adaptive sampling falls back to full frame launches without it
+        VkPhysicalDeviceRayTracingPipelineFeaturesKHR supported_rt_pipeline_features = {};
+        supported_rt_pipeline_features.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_RAY_TRACING_PIPELINE_FEATURES_KHR;
+        VkPhysicalDeviceFeatures2 supported_features2 = {};
+        supported_features2.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2;
+        supported_features2.pNext = &supported_rt_pipeline_features;
+        vkGetPhysicalDeviceFeatures2(physical_device, &supported_features2);
+        device.trace_rays_indirect_supported = supported_rt_pipeline_features.rayTracingPipelineTraceRaysIndirect == VK_TRUE;
+
         VkPhysicalDeviceRayTracingPipelineFeaturesKHR rt_pipeline_features = {};
         rt_pipeline_features.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_RAY_TRACING_PIPELINE_FEATURES_KHR;
         rt_pipeline_features.rayTracingPipeline = VK_TRUE;
+        rt_pipeline_features.rayTracingPipelineTraceRaysIndirect = supported_rt_pipeline_features.rayTracingPipelineTraceRaysIndirect;
         physical_features2.pNext = &rt_pipeline_features;
 
         VkPhysicalDeviceBufferDeviceAddressFeatures buffer_device_address_features = {};
@@ -1423,12 +2053,12 @@ void VulkanApplication::setup() {
         }
     }
 
-    std::cout << "QUEUE FAMILY INDICES | GRAPHICS: " << queue_family_indices.graphics_compute.value() << " | PRESENT: " << queue_family_indices.present.value() << std::endl;
+    std::cout << "QUEUE FAMILY INDICES | GRAPHICS: " << queue_family_indices.graphics_compute.value() << " | PRESENT: " << queue_family_indices.present.value_or(-1) << std::endl;
 
     // retrieve queue handles
     vkGetDeviceQueue(logical_device, queue_family_indices.graphics_compute.value(), 0, &graphics_queue);
 
-    vkGetDeviceQueue(logical_device, queue_family_indices.present.value(), 0, &present_queue);
+    if (!headless) vkGetDeviceQueue(logical_device, queue_family_indices.present.value(), 0, &present_queue);
 
 
     // create command pool
@@ -1442,6 +2072,9 @@ void VulkanApplication::setup() {
         throw std::runtime_error("error creating command pool");
     }
     setup_device();
+    device.create_pipeline_cache();
+    device.gpu_profiler.init(&device);
+    readback.init(&device);
 
     // create command buffers
     VkCommandBufferAllocateInfo alloc_info{};
@@ -1459,57 +2092,17 @@ void VulkanApplication::setup() {
     vkResetFences(logical_device, 1, &immediate_fence);
     vkResetFences(logical_device, 1, &in_flight_fence);
 
-    create_swapchain();
-    create_swapchain_image_views();
-
-    // create render pass
-    VkAttachmentDescription color_attachment{};
-    color_attachment.format = device.surface_format.format;
-    color_attachment.samples = VK_SAMPLE_COUNT_1_BIT;
-    color_attachment.loadOp = VK_ATTACHMENT_LOAD_OP_LOAD;
-    color_attachment.storeOp = VK_ATTACHMENT_STORE_OP_STORE;
-    color_attachment.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
-    color_attachment.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
-    color_attachment.initialLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
-    color_attachment.finalLayout = VK_IMAGE_LAYOUT_PRESENT_SRC_KHR;
-
-    VkAttachmentReference color_attachment_ref{};
-    color_attachment_ref.attachment = 0;
-    color_attachment_ref.layout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
-
-    VkSubpassDescription subpass{};
-    subpass.pipelineBindPoint = VK_PIPELINE_BIND_POINT_GRAPHICS;
-    subpass.colorAttachmentCount = 1;
-    subpass.pColorAttachments = &color_attachment_ref;
-    subpass.inputAttachmentCount = 0;
-
-    VkSubpassDependency dependency{};
-    dependency.srcSubpass = VK_SUBPASS_EXTERNAL;
-    dependency.dstSubpass = 0;
-    dependency.srcStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
-    dependency.srcAccessMask = 0;
-    dependency.dstStageMask = VK_PIPELINE_STAGE_ALL_GRAPHICS_BIT;
-    dependency.dstAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
-
-    VkRenderPassCreateInfo render_pass_info{};
-    render_pass_info.sType = VK_STRUCTURE_TYPE_RENDER_PASS_CREATE_INFO;
-    render_pass_info.attachmentCount = 1;
-    render_pass_info.pAttachments = &color_attachment;
-    render_pass_info.subpassCount = 1;
-    render_pass_info.pSubpasses = &subpass;
-    render_pass_info.dependencyCount = 1;
-    render_pass_info.pDependencies = &dependency;
-
-    if (vkCreateRenderPass(logical_device, &render_pass_info, nullptr, &render_pass) != VK_SUCCESS)
-    {
-        throw std::runtime_error("failure to create render pass");
+    if (!headless) {
+        create_swapchain();
+        create_swapchain_image_views();
+        create_render_pass();
+        create_framebuffers();
+    } else {
+        // headless rendering uses the requested extent in place of a swapchain
+        swap_chain_extent = headless_settings.extent;
+        device.surface_format = VkSurfaceFormatKHR{VK_FORMAT_R8G8B8A8_UNORM, VK_COLOR_SPACE_SRGB_NONLINEAR_KHR};
     }
 
-    // create framebuffers after render pass
-    create_framebuffers();
-
-    loaded_scene_data = loaders::load_scene_description(scene_path.string());
-
     // BUILD BLAS
     vkResetCommandPool(logical_device, command_pool, 0);
     vkResetFences(logical_device, 1, &tlas_fence);
@@ -1524,89 +2117,8 @@ void VulkanApplication::setup() {
         throw std::runtime_error("error beginning command buffer");
     }
 
-    // load environment map
-    std::cout << "TEST BEFORE" << std::endl;
-    if (loaded_scene_data.environment_path.empty()) {
-        loaded_environment = loaders::load_default_environment_map(&device, loaded_scene_data.environment_color);
-    } else {
-        loaded_environment = loaders::load_environment_map(&device, (scene_path.parent_path() / std::filesystem::path(loaded_scene_data.environment_path)).string());
-    }
-
-    loaded_textures.push_back(loaded_environment.image);
-    loaded_textures.push_back(loaded_environment.conditional_cdf_map);
-    loaded_textures.push_back(loaded_environment.marginal_cdf_map);
-
-    std::cout << "TEST AFTER" << std::endl;
-
-    // build blas of loaded meshes
-    loaded_objects.clear();
-    loaded_mesh_index.clear();
-    created_meshes.clear();
-
-    for (auto object_path : loaded_scene_data.object_paths) {
-        auto full_object_path = std::filesystem::absolute(scene_path.parent_path() / std::filesystem::path(std::get<1>(object_path)));
-        auto object_name = std::get<0>(object_path);
-        std::cout << "Loading scene object " << object_name << std::endl;
-        GLTFData gltf = loaders::load_gltf(full_object_path.string());
-        // if (gltf_processor) {
-        //     gltf_processor->set_data(&gltf);
-        //     gltf_processor->process();
-        // }
-        loaded_objects[object_name] = gltf;
-        loaded_mesh_index[object_name] = created_meshes.size();
-        for (auto &mesh : gltf.meshes) {
-            for (auto &primitive : mesh.primitives) {
-                created_meshes.push_back(create_mesh_data(primitive.indices, primitive.vertices, primitive.normals, primitive.uvs, primitive.tangents));
-                created_blas.push_back(build_blas(primitive.indices, primitive.vertices, primitive.max_vertex));
-            }
-        }
-        
-        full_object_path.remove_filename();
-        loaded_texture_index[object_name] = loaded_textures.size();
-        std::cout << "loading " << gltf.textures.size() << " textures starting at index " << loaded_texture_index[object_name] << std::endl;
-        for (const auto &texture : gltf.textures) {
-            auto full_path = full_object_path / texture.path;
-            loaded_textures.push_back(loaders::load_image(&device, full_path.string(), 0, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, VK_ACCESS_SHADER_READ_BIT));
-        }
-
-        std::cout << "meshes after " << object_name << ": " << created_meshes.size() << "|" << created_blas.size() << std::endl;
-    }
-
-    std::cout << "Loaded " << loaded_objects.size() << " scene objects:" << std::endl;
-    for (auto key = loaded_objects.begin(); key != loaded_objects.end(); key++) {
-        std::cout << key->first.c_str() << ": " << loaded_mesh_index[key->first] << std::endl;
-    }
-
-    std::cout << "Created " << created_blas.size() << " Mesh BLASes" << std::endl;
+    load_scene();
 
-
-    for (auto light_data : loaded_scene_data.lights) {
-        Shaders::Light light;
-        light.uint_data[0] = light_data.type;
-        switch (light_data.type) {
-            case LightData::LightType::POINT:
-                light.float_data[0] = light_data.position.x;
-                light.float_data[1] = light_data.position.y;
-                light.float_data[2] = light_data.position.z;
-                
-                light.float_data[3] = light_data.intensity.x;
-                light.float_data[4] = light_data.intensity.y;
-                light.float_data[5] = light_data.intensity.z;
-                break;
-            case LightData::LightType::DIRECTIONAL:
-                light.float_data[0] = light_data.direction.x;
-                light.float_data[1] = light_data.direction.y;
-                light.float_data[2] = light_data.direction.z;
-                
-                light.float_data[3] = light_data.intensity.x;
-                light.float_data[4] = light_data.intensity.y;
-                light.float_data[5] = light_data.intensity.z;
-                break;
-        }
-        lights.push_back(light);
-    }
-    std::cout << "Loaded " << lights.size() << " lights" << std::endl;
-    
     VkSubmitInfo submit_info{};
     submit_info.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
     submit_info.waitSemaphoreCount = 0;
@@ -1614,9 +2126,6 @@ void VulkanApplication::setup() {
     submit_info.commandBufferCount = 1;
     submit_info.pCommandBuffers = &command_buffer;
 
-    scene_tlas = build_tlas();
-
-    std::cout << "Scene TLAS constructed" << std::endl;
 
     // transfer framebuffer images to correct format
     for (int i = 0; i < swap_chain_images.size(); i++) {
@@ -1644,29 +2153,37 @@ void VulkanApplication::setup() {
                    .with_default_pipeline()
                     ;
 
+    // instance picking reads instance indices, other outputs are requested by the display selection
+    if (!headless) rt_pipeline_builder.set_requested_outputs({"Result Image", "Instance Indices"});
     rt_pipeline = rt_pipeline_builder.build();
 
     
 
 
-    init_imgui();
-    std::cout << "IMGUI INITIALIZED" << std::endl;
+    if (!headless) {
+        init_imgui();
+        std::cout << "IMGUI INITIALIZED" << std::endl;
+    }
 
     vkEndCommandBuffer(command_buffer);
 
     std::cout << "SUBMIT" << vkQueueSubmit(graphics_queue, 1, &submit_info, tlas_fence) << std::endl;
 
-    while(vkWaitForFences(logical_device, 1, &tlas_fence, VK_FALSE, UINT64_MAX) != VK_SUCCESS);
+    {
+        PROFILE_ZONE("wait for acceleration structure builds");
+        while(vkWaitForFences(logical_device, 1, &tlas_fence, VK_FALSE, UINT64_MAX) != VK_SUCCESS);
+    }
     create_default_descriptor_writes();
 
     std::cout << "raytracing pipeline created" << std::endl;
 
     // create process pipeline
+    PROFILE_ZONE("create processing pipeline");
     p_pipeline_builder = device.create_processing_pipeline_builder()
                     // .with_stage(std::make_shared<ProcessingPipelineStageOIDN>(ProcessingPipelineStageOIDN()))
                     // .with_stage(std::make_shared<ProcessingPipelineStageUpscale>(ProcessingPipelineStageUpscale()));
                     .with_stage(std::make_shared<ProcessingPipelineStageRestir>(ProcessingPipelineStageRestir(
-                        scene_tlas.acceleration_structure, &index_buffer, &vertex_buffer, &normal_buffer, &texcoord_buffer, &tangent_buffer, &mesh_data_offset_buffer, &mesh_offset_index_buffer, &loaded_textures, &texture_index_buffer, &material_parameter_buffer, &lights_buffer, &prev_camera_matrix_buffer
+                        &scene_tlas.acceleration_structure, &index_buffer, &vertex_buffer, &normal_buffer, &texcoord_buffer, &tangent_buffer, &mesh_data_offset_buffer, &mesh_offset_index_buffer, &loaded_textures, &texture_index_buffer, &material_parameter_buffer, &lights_buffer, &light_tree_buffer, &light_distribution_buffer, &prev_camera_matrix_buffer
                     )));
                     ;
 
@@ -1674,6 +2191,18 @@ void VulkanApplication::setup() {
 
     std::cout << "processing pipeline created" << std::endl;
 
+    adaptive_compact_shader = new ComputeShader(&device, "./shaders/processing/adaptive_compact.comp");
+    adaptive_compact_shader->build();
+    output_decode_shader = new ComputeShader(&device, "./shaders/processing/decode_output.comp");
+    output_decode_shader->build();
+    if (!headless) shader_watcher.init("./shaders");
+    if (!device.trace_rays_indirect_supported) std::cout << "indirect ray tracing not supported, adaptive sampling disabled" << std::endl;
+
+    if (headless) {
+        std::cout << "Setup completed" << std::endl;
+        return;
+    }
+
     // set glfw callbacks
     glfwSetFramebufferSizeCallback(window, [](GLFWwindow* window, int width, int height) {
         std::cout << "resized to " << width << "x" << height << std::endl;
@@ -1770,26 +2299,26 @@ void VulkanApplication::run() {
     camera_look_x = 0;
     camera_look_y = 0;
 
+    if (headless) {
+        if (!batch_jobs.empty()) run_batch();
+        else run_headless();
+        return;
+    }
+
     // main event loop
     while (!glfwWindowShouldClose(window))
     {
+        PROFILE_ZONE("frame");
         glfwPollEvents();
         if (minimized) continue;
 
         prev_camera_matrix = camera_matrix;
         prev_camera_matrix_buffer.set_data(&prev_camera_matrix, 0, sizeof(mat4));
         prev_camera_matrix_buffer.set_data(&camera_position, sizeof(mat4), sizeof(vec4));
-        // camera matrix
-        // perspective projection
-        float aspect = (float)swap_chain_extent.width / swap_chain_extent.height;
-        camera_matrix = glm::infinitePerspective(glm::radians(ui.camera_fov), aspect, 0.1f);
 
         camera_pitch += camera_look_y;
-        camera_pitch = std::clamp(camera_pitch, -glm::pi<float>() / 2.0f, glm::pi<float>() / 2.0f);
-        camera_matrix = glm::rotate(camera_matrix, camera_pitch, vec3(1.0f, 0.0f, 0.0f));
-
         camera_yaw += camera_look_x;
-        camera_matrix = glm::rotate(camera_matrix, camera_yaw, vec3(0.0f, 1.0f, 0.0f));
+        update_camera_matrix();
 
         vec3 cam_fwd = vec3(glm::sin(camera_yaw), 0.0, -glm::cos(camera_yaw));
         vec3 cam_right = glm::normalize(glm::cross(cam_fwd, vec3(0.0f, 1.0f, 0.0f)));
@@ -1827,64 +2356,408 @@ void VulkanApplication::run() {
     vkDeviceWaitIdle(logical_device);
 }
 
+void VulkanApplication::update_camera_matrix() {
+    // camera matrix
+    // perspective projection
+    float aspect = (float)swap_chain_extent.width / swap_chain_extent.height;
+    camera_matrix = glm::infinitePerspective(glm::radians(ui.camera_fov), aspect, 0.1f);
+
+    camera_pitch = std::clamp(camera_pitch, -glm::pi<float>() / 2.0f, glm::pi<float>() / 2.0f);
+    camera_matrix = glm::rotate(camera_matrix, camera_pitch, vec3(1.0f, 0.0f, 0.0f));
+    camera_matrix = glm::rotate(camera_matrix, camera_yaw, vec3(0.0f, 1.0f, 0.0f));
+}
+
+double VulkanApplication::accumulate_headless_samples(uint32_t target_samples, double time_budget) {
+    VkCommandBufferBeginInfo begin_info{};
+    begin_info.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+    begin_info.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+
+    // variants are created on first use, build them before the timer starts so paths/s exclude pipeline compilation
+    RaytracingPipelineSettings settings = get_pipeline_settings();
+    if (active_integrator == Integrator::RaytracingPipeline) rt_pipeline.get_variant(settings);
+    else if (active_integrator == Integrator::Megakernel) megakernel_integrator.get_pipeline(&settings);
+
+    auto render_start_time = std::chrono::high_resolution_clock::now();
+    last_frame_time = render_start_time;
+    accumulated_frames = 0;
+    clear_frames = false;
+    adaptive_statistics_pending = false;
+    wavefront_integrator.reset_statistics();
+
+    while (true) {
+        PROFILE_ZONE("headless frame");
+        uint32_t rendered_samples = accumulated_frames * ui.frame_samples;
+        if (target_samples > 0 && rendered_samples >= target_samples) break;
+        std::chrono::duration<double> elapsed = std::chrono::high_resolution_clock::now() - render_start_time;
+        if (time_budget > 0.0 && elapsed.count() >= time_budget) break;
+
+        vkResetCommandPool(logical_device, command_pool, 0);
+        if (vkBeginCommandBuffer(command_buffer, &begin_info) != VK_SUCCESS) {
+            throw std::runtime_error("error beginning command buffer");
+        }
+
+        // the wavefront integrator records zones per kernel, bounce and frame sample
+        if (active_integrator == Integrator::Wavefront) device.gpu_profiler.reserve_queries(wavefront_integrator.get_query_count((uint32_t)ui.max_ray_depth, (uint32_t)ui.frame_samples));
+        device.gpu_profiler.cmd_begin_frame(command_buffer);
+
+        material_parameter_buffer.set_data(material_parameters.data(), 0, sizeof(InstanceData::MaterialParameters) * material_parameters.size());
+        if (lights.size() > 0) lights_buffer.set_data(lights.data(), 0, sizeof(Shaders::Light) * lights.size());
+
+        accumulated_frames += 1;
+
+        cmd_trace_rays(command_buffer);
+
+        if (vkEndCommandBuffer(command_buffer) != VK_SUCCESS) {
+            throw std::runtime_error("encountered an error when ending command buffer");
+        }
+
+        VkSubmitInfo submit_info{};
+        submit_info.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+        submit_info.commandBufferCount = 1;
+        submit_info.pCommandBuffers = &command_buffer;
+
+        if (vkQueueSubmit(graphics_queue, 1, &submit_info, in_flight_fence) != VK_SUCCESS) {
+            throw std::runtime_error("error submitting draw command buffer");
+        }
+
+        {
+            PROFILE_ZONE("wait for trace rays");
+            vkWaitForFences(logical_device, 1, &in_flight_fence, VK_TRUE, UINT64_MAX);
+        }
+        vkResetFences(logical_device, 1, &in_flight_fence);
+
+        device.gpu_profiler.end_frame();
+        readback.complete_frame(application_frames);
+        readback.deliver();
+        if (active_integrator == Integrator::Wavefront) wavefront_integrator.update_statistics();
+
+        auto time = std::chrono::high_resolution_clock::now();
+        frame_delta = time - last_frame_time;
+        last_frame_time = time;
+
+        application_frames++;
+
+        // adaptive sampling stops once the mean relative error reaches the threshold
+        if (adaptive_statistics_pending) {
+            update_adaptive_statistics();
+            std::cout << "adaptive sampling: " << adaptive_active_pixels << " active pixels | mean error " << adaptive_mean_error << std::endl;
+            if (adaptive_mean_error <= ui.adaptive_threshold || adaptive_active_pixels == 0) break;
+        }
+    }
+
+    // camera paths started per second, compares integrators when rendering the same job
+    std::chrono::duration<double> render_time = std::chrono::high_resolution_clock::now() - render_start_time;
+    double path_count = (double)accumulated_frames * ui.frame_samples * render_image_extent.width * render_image_extent.height;
+    double paths_per_second = render_time.count() > 0.0 ? path_count / render_time.count() : 0.0;
+    if (paths_per_second > 0.0) std::cout << paths_per_second * 1e-6 << " M paths/s (" << get_integrator_name(active_integrator) << " integrator)" << std::endl;
+    // closest hit rays traced per second of the extend kernel, compares coherence sorting on and off
+    double traversal_rays_per_second = wavefront_integrator.get_traversal_rays_per_second();
+    if (active_integrator == Integrator::Wavefront && wavefront_integrator.incomplete_frames > 0) {
+        std::cout << "traversal rays/s not reported, gpu profiler zones were dropped in " << wavefront_integrator.incomplete_frames << " frames" << std::endl;
+    } else if (active_integrator == Integrator::Wavefront && traversal_rays_per_second > 0.0) {
+        std::cout << traversal_rays_per_second * 1e-6 << " M rays/s traversal (coherence sorting " << (wavefront_integrator.sort_by_coherence ? "on" : "off") << ")" << std::endl;
+    }
+    return paths_per_second;
+}
+
+std::filesystem::path VulkanApplication::get_headless_output_path(std::string output) {
+    std::string file_name = output;
+    std::replace(file_name.begin(), file_name.end(), ' ', '_');
+    return headless_settings.output_directory / (file_name + ".exr");
+}
+
+void VulkanApplication::run_headless() {
+    PROFILE_ZONE("run_headless");
+
+    // validate requested outputs before spending time on rendering
+    std::vector<std::string> outputs = headless_settings.outputs;
+    if (outputs.empty()) outputs.push_back("Result Image");
+    for (auto& output : outputs) {
+        if (rt_pipeline.builder->named_output_buffer_indices.find(output) == rt_pipeline.builder->named_output_buffer_indices.end()) {
+            throw std::runtime_error("unknown output buffer '" + output + "'");
+        }
+    }
+
+    // only exported outputs are allocated and written
+    if (rt_pipeline_builder.set_requested_outputs(outputs)) rebuild_pipeline();
+
+    ui.integrator = headless_settings.integrator;
+    ui.wavefront_material_sorting = headless_settings.material_sorting;
+    ui.wavefront_coherence_sorting = headless_settings.coherence_sorting;
+    update_integrator();
+
+    ui.adaptive_sampling_enabled = headless_settings.adaptive_threshold > 0.0f;
+    if (ui.adaptive_sampling_enabled) ui.adaptive_threshold = headless_settings.adaptive_threshold;
+
+    // every integrator of a benchmark renders the same full frame workload
+    if (headless_settings.benchmark && headless_settings.tile_size > 0) throw std::runtime_error("benchmarks render the full frame, tiles are not supported");
+    if (headless_settings.benchmark && ui.adaptive_sampling_enabled) throw std::runtime_error("benchmarks need a sample count or time budget, adaptive sampling is not supported");
+
+    // render a default sample count if no stopping criterion is given
+    uint32_t target_samples = headless_settings.sample_count;
+    if (target_samples == 0 && headless_settings.time_budget <= 0.0 && !ui.adaptive_sampling_enabled) target_samples = 64;
+
+    std::cout << "rendering headless at " << swap_chain_extent.width << "x" << swap_chain_extent.height << " | ";
+    if (headless_settings.benchmark) std::cout << "benchmark of all integrators";
+    else std::cout << get_integrator_name(active_integrator) << " integrator";
+    if (active_integrator == Integrator::Wavefront && !ui.wavefront_material_sorting) std::cout << " without material sorting";
+    if (active_integrator == Integrator::Wavefront && ui.wavefront_coherence_sorting) std::cout << " with coherence sorting";
+    if (target_samples > 0) std::cout << " | " << target_samples << " samples";
+    if (headless_settings.time_budget > 0.0) std::cout << " | " << headless_settings.time_budget << "s budget";
+    if (headless_settings.tile_size > 0) std::cout << " | " << headless_settings.tile_size << "px tiles";
+    if (ui.adaptive_sampling_enabled) std::cout << " | adaptive error threshold " << ui.adaptive_threshold;
+    std::cout << std::endl;
+
+    std::filesystem::create_directories(headless_settings.output_directory);
+
+    auto render_start_time = std::chrono::high_resolution_clock::now();
+
+    if (headless_settings.tile_size > 0) {
+        run_headless_tiled(outputs, target_samples);
+    } else {
+        recreate_render_images();
+
+        update_camera_matrix();
+        prev_camera_matrix = camera_matrix;
+        prev_camera_matrix_buffer.set_data(&prev_camera_matrix, 0, sizeof(mat4));
+        prev_camera_matrix_buffer.set_data(&camera_position, sizeof(mat4), sizeof(vec4));
+
+        if (headless_settings.benchmark) {
+            // benchmarks only measure, nothing is exported
+            run_headless_benchmark(target_samples);
+            outputs.clear();
+        } else {
+            accumulate_headless_samples(target_samples, headless_settings.time_budget);
+        }
+        vkDeviceWaitIdle(logical_device);
+
+        // write requested outputs
+        for (auto& output : outputs) {
+            PROFILE_ZONE_DETAIL("export output", output);
+            OutputBuffer& output_buffer = rt_pipeline.get_output_buffer(output);
+            std::vector<vec4> data = output_buffer.get_colors(render_image_extent.width * render_image_extent.height);
+
+            std::filesystem::path path = get_headless_output_path(output);
+            save_exr_image(path.string().c_str(), data.data(), render_image_extent.width, render_image_extent.height, sizeof(vec4));
+            std::cout << "saved " << output << " to " << path << std::endl;
+        }
+    }
+
+    std::chrono::duration<double> render_time = std::chrono::high_resolution_clock::now() - render_start_time;
+    std::cout << "rendered " << swap_chain_extent.width << "x" << swap_chain_extent.height << " in " << render_time.count() << "s" << std::endl;
+}
+
+void VulkanApplication::run_headless_tiled(std::vector<std::string> outputs, uint32_t target_samples) {
+    PROFILE_ZONE("run_headless_tiled");
+    uint32_t tile_size = headless_settings.tile_size;
+    VkExtent2D image_extent = swap_chain_extent;
+    uint32_t tiles_x = (image_extent.width + tile_size - 1) / tile_size;
+    uint32_t tiles_y = (image_extent.height + tile_size - 1) / tile_size;
+
+    // output buffers are only allocated at tile size
+    render_buffer_extent = {std::min(tile_size, image_extent.width), std::min(tile_size, image_extent.height)};
+    resize_render_buffers();
+    render_full_extent = image_extent;
+
+    update_camera_matrix();
+    prev_camera_matrix = camera_matrix;
+    prev_camera_matrix_buffer.set_data(&prev_camera_matrix, 0, sizeof(mat4));
+    prev_camera_matrix_buffer.set_data(&camera_position, sizeof(mat4), sizeof(vec4));
+
+    // finished tiles are streamed to disk
+    std::vector<ExrTileWriter> writers(outputs.size());
+    for (size_t i = 0; i < outputs.size(); i++) {
+        std::filesystem::path path = get_headless_output_path(outputs[i]);
+        if (!writers[i].open(path.string().c_str(), image_extent.width, image_extent.height, tile_size)) {
+            throw std::runtime_error("could not open " + path.string() + " for writing");
+        }
+    }
+
+    // time budget is split evenly between tiles
+    double tile_time_budget = headless_settings.time_budget / (tiles_x * tiles_y);
+
+    for (uint32_t tile_y = 0; tile_y < tiles_y; tile_y++) {
+        for (uint32_t tile_x = 0; tile_x < tiles_x; tile_x++) {
+            PROFILE_ZONE("tile");
+            render_tile_offset = {(int32_t)(tile_x * tile_size), (int32_t)(tile_y * tile_size)};
+            render_image_extent = {std::min(tile_size, image_extent.width - tile_x * tile_size), std::min(tile_size, image_extent.height - tile_y * tile_size)};
+
+            accumulate_headless_samples(target_samples, tile_time_budget);
+
+            for (size_t i = 0; i < outputs.size(); i++) {
+                OutputBuffer& output_buffer = rt_pipeline.get_output_buffer(outputs[i]);
+                std::vector<vec4> tile_data = output_buffer.get_colors(render_image_extent.width * render_image_extent.height);
+                writers[i].write_tile(tile_x, tile_y, tile_data.data(), sizeof(vec4));
+            }
+        }
+        std::cout << "finished tile row " << tile_y + 1 << "/" << tiles_y << std::endl;
+    }
+
+    for (size_t i = 0; i < outputs.size(); i++) {
+        writers[i].close();
+        std::cout << "saved " << outputs[i] << " to " << get_headless_output_path(outputs[i]) << std::endl;
+    }
+
+    // render_image_extent is still the last tile, the full image is the extent all tiles were placed in
+    render_tile_offset = {0, 0};
+    render_full_extent = image_extent;
+}
+
+void VulkanApplication::run_headless_benchmark(uint32_t target_samples) {
+    PROFILE_ZONE("run_headless_benchmark");
+
+    std::vector<double> paths_per_second;
+    for (Integrator integrator : INTEGRATORS) {
+        PROFILE_ZONE_DETAIL("benchmark integrator", get_integrator_name(integrator));
+        ui.integrator = integrator;
+        update_integrator();
+        paths_per_second.push_back(accumulate_headless_samples(target_samples, headless_settings.time_budget));
+    }
+
+    std::cout << "benchmark at " << render_image_extent.width << "x" << render_image_extent.height << " | max depth " << ui.max_ray_depth << " | " << ui.frame_samples << " samples per frame" << std::endl;
+    for (size_t i = 0; i < paths_per_second.size(); i++) {
+        Integrator integrator = INTEGRATORS[i];
+        std::cout << "  " << std::left << std::setw(12) << get_integrator_name(integrator) << std::right << std::setw(10) << std::fixed << std::setprecision(2) << paths_per_second[i] * 1e-6 << std::defaultfloat << " M paths/s";
+        // the pipeline and megakernel are built with the settings as specialization constants, the wavefront kernels read them from push constants
+        if (integrator == Integrator::Wavefront) {
+            std::cout << " (generic kernels, material sorting " << (ui.wavefront_material_sorting ? "on" : "off") << ", coherence sorting " << (ui.wavefront_coherence_sorting ? "on" : "off") << ")";
+        } else {
+            std::cout << " (specialized)";
+        }
+        std::cout << std::endl;
+    }
+}
+
+void VulkanApplication::run_batch() {
+    PROFILE_ZONE("run_batch");
+
+    // settings not given by a job fall back to the persisted camera and ui defaults
+    vec3 default_camera_position = camera_position;
+    float default_camera_pitch = camera_pitch;
+    float default_camera_yaw = camera_yaw;
+    float default_camera_fov = ui.camera_fov;
+    int default_max_depth = ui.max_ray_depth;
+    int default_frame_samples = ui.frame_samples;
+    int default_russian_roulette_depth = ui.russian_roulette_depth;
+    Integrator default_integrator = headless_settings.integrator;
+    bool default_material_sorting = headless_settings.material_sorting;
+    bool default_coherence_sorting = headless_settings.coherence_sorting;
+
+    auto batch_start_time = std::chrono::high_resolution_clock::now();
+    uint32_t failed_jobs = 0;
+    for (size_t i = 0; i < batch_jobs.size(); i++) {
+        const BatchJob& job = batch_jobs[i];
+        PROFILE_ZONE_DETAIL("batch job", job.name);
+        std::cout << "batch job " << i + 1 << "/" << batch_jobs.size() << ": " << job.name << " (" << job.scene_path << ")" << std::endl;
+
+        try {
+            HeadlessSettings settings;
+            settings.extent = {job.width, job.height};
+            settings.sample_count = job.sample_count;
+            settings.time_budget = job.time_budget;
+            settings.outputs = job.outputs;
+            settings.output_directory = job.output_directory;
+            settings.tile_size = job.tile_size;
+            settings.adaptive_threshold = job.adaptive_threshold;
+            settings.benchmark = job.benchmark;
+            settings.integrator = job.integrator.value_or(default_integrator);
+            settings.material_sorting = job.material_sorting.value_or(default_material_sorting);
+            settings.coherence_sorting = job.coherence_sorting.value_or(default_coherence_sorting);
+            set_headless(settings);
+
+            if (std::filesystem::path(job.scene_path) != scene_path) change_scene(job.scene_path);
+            swap_chain_extent = headless_settings.extent;
+
+            camera_position = job.camera_position.value_or(default_camera_position);
+            camera_pitch = job.camera_pitch.value_or(default_camera_pitch);
+            camera_yaw = job.camera_yaw.value_or(default_camera_yaw);
+            ui.camera_fov = job.camera_fov.value_or(default_camera_fov);
+            ui.max_ray_depth = job.max_depth.value_or(default_max_depth);
+            ui.frame_samples = job.frame_samples.value_or(default_frame_samples);
+            ui.russian_roulette_depth = job.russian_roulette_depth.value_or(default_russian_roulette_depth);
+
+            run_headless();
+        } catch (const std::runtime_error& err) {
+            std::cerr << "batch job " << job.name << " failed: " << "\033[31m" << err.what() << "\033[m" << std::endl;
+            failed_jobs++;
+        }
+    }
+
+    std::chrono::duration<double> batch_time = std::chrono::high_resolution_clock::now() - batch_start_time;
+    std::cout << "batch finished in " << batch_time.count() << "s: " << batch_jobs.size() - failed_jobs << "/" << batch_jobs.size() << " jobs succeeded" << std::endl;
+}
+
+void VulkanApplication::set_batch_jobs(std::vector<BatchJob> jobs) {
+    batch_jobs = jobs;
+}
+
+void VulkanApplication::set_headless(HeadlessSettings settings) {
+    if (settings.extent.width == 0 || settings.extent.height == 0 || settings.extent.width > 0xFFFF || settings.extent.height > 0xFFFF) {
+        throw std::runtime_error("headless extent has to be between 1 and 65535 pixels per dimension");
+    }
+    headless = true;
+    headless_settings = settings;
+}
+
 void VulkanApplication::cleanup() {
     // imgui cleanup
-    vkDestroyDescriptorPool(device.vulkan_device, imgui_descriptor_pool, nullptr);
-    ImGui_ImplVulkan_Shutdown();
-    ImGui_ImplGlfw_Shutdown();
-    ImGui::DestroyContext();
-    // deinitialization
-    lights_buffer.free();
-    restir_reservoir_buffer_0.free();
-    restir_reservoir_buffer_1.free();
-    prev_camera_matrix_buffer.free();
-    for (Image i : loaded_textures) {
-        i.free();
+    if (!headless) {
+        vkDestroyDescriptorPool(device.vulkan_device, imgui_descriptor_pool, nullptr);
+        ImGui_ImplVulkan_Shutdown();
+        ImGui_ImplGlfw_Shutdown();
+        ImGui::DestroyContext();
     }
-    // destroy TLAS
-    device.vkDestroyAccelerationStructureKHR(logical_device, scene_tlas.acceleration_structure, nullptr);
-    scene_tlas.buffer.free();
+    // deinitialization
+    free_scene_resources();
 
-    // destroy BLAS
-    for (auto blas : created_blas) {
-        device.vkDestroyAccelerationStructureKHR(logical_device, blas.acceleration_structure, nullptr);
-        blas.buffer.free();
+    // free meshes, BLAS and textures of loaded objects
+    for (auto& object : object_cache) {
+        free_loaded_object(object.second);
     }
+    loaded_environment.image.free();
+    loaded_environment.conditional_distribution.free();
+    loaded_environment.marginal_distribution.free();
 
-    // free mesh data
-    for (auto mesh = created_meshes.begin(); mesh != created_meshes.end(); mesh++) {
-        mesh->free();
-    }
-    index_buffer.free();
-    vertex_buffer.free();
-    normal_buffer.free();
-    texcoord_buffer.free();
-    tangent_buffer.free();
-    mesh_data_offset_buffer.free();
-    mesh_offset_index_buffer.free();
-    texture_index_buffer.free();
-    material_parameter_buffer.free();
+    if (render_transfer_image.width > 0) render_transfer_image.free();
+    readback.free();
+
+    adaptive_sampling_buffer.free();
+    adaptive_error_buffer.free();
+    adaptive_compact_shader->free();
+    delete adaptive_compact_shader;
+    output_display_buffer.free();
+    output_decode_shader->free();
+    delete output_decode_shader;
 
-    render_transfer_image.free();
+    if (shader_reload.compilation.valid()) shader_reload.compilation.wait();
+    shader_watcher.free();
 
+    wavefront_integrator.free();
+    megakernel_integrator.free();
     rt_pipeline.free();
     rt_pipeline_builder.free();
     p_pipeline.free();
     p_pipeline_builder.free();
+    device.gpu_profiler.free();
+    device.save_pipeline_cache();
+    device.free_pipeline_cache();
+    device.free_descriptor_set_layouts();
     vkDestroySemaphore(logical_device, image_available_semaphore, nullptr);
     vkDestroySemaphore(logical_device, render_finished_semaphore, nullptr);
     vkDestroyFence(logical_device, in_flight_fence, nullptr);
     vkDestroyFence(logical_device, immediate_fence, nullptr);
     vkDestroyFence(logical_device, tlas_fence, nullptr);
     vkDestroyCommandPool(logical_device, command_pool, nullptr);
-    for (auto framebuffer : framebuffers)
-        vkDestroyFramebuffer(logical_device, framebuffer, nullptr);
-    // vkDestroyPipelineLayout(logical_device, pipeline_layout, nullptr);
-    vkDestroyRenderPass(logical_device, render_pass, nullptr);
-    for (auto image_view : swap_chain_image_views)
-        vkDestroyImageView(logical_device, image_view, nullptr);
-    vkDestroySwapchainKHR(logical_device, swap_chain, nullptr);
-    vkDestroySurfaceKHR(vulkan_instance, surface, nullptr);
+    if (!headless) {
+        for (auto framebuffer : framebuffers)
+            vkDestroyFramebuffer(logical_device, framebuffer, nullptr);
+        // vkDestroyPipelineLayout(logical_device, pipeline_layout, nullptr);
+        vkDestroyRenderPass(logical_device, render_pass, nullptr);
+        for (auto image_view : swap_chain_image_views)
+            vkDestroyImageView(logical_device, image_view, nullptr);
+        vkDestroySwapchainKHR(logical_device, swap_chain, nullptr);
+        vkDestroySurfaceKHR(vulkan_instance, surface, nullptr);
+    }
     for (auto shared_allocations = device.shared_allocations.begin(); shared_allocations != device.shared_allocations.end(); shared_allocations++) {
         for (auto allocation : (*shared_allocations).second) {
             vkFreeMemory(logical_device, allocation.memory, nullptr);
@@ -1894,12 +2767,19 @@ void VulkanApplication::cleanup() {
     DestroyDebugUtilsMessengerEXT(vulkan_instance, debug_messenger, nullptr);
     vkDestroyInstance(vulkan_instance, nullptr);
 
-    glfwDestroyWindow(window);
+    if (!headless) {
+        glfwDestroyWindow(window);
 
-    glfwTerminate();
+        glfwTerminate();
+    }
 }
 
 void VulkanApplication::rebuild_pipeline() {
+    PROFILE_ZONE("rebuild_pipeline");
+    // a full rebuild compiles current sources anyway, and pending reloads could refer to freed compute shaders
+    if (shader_reload.compilation.valid()) shader_reload.compilation.wait();
+    shader_reload = ShaderReload{};
+
     RaytracingPipeline new_rt_pipeline = rt_pipeline_builder.build();
     RaytracingPipeline old_rt_pipeline = rt_pipeline;
     rt_pipeline = new_rt_pipeline;
@@ -1915,6 +2795,11 @@ void VulkanApplication::rebuild_pipeline() {
     rt_pipeline.set_descriptor_buffer_binding("texture_indices", texture_index_buffer, BufferType::Storage);
     rt_pipeline.set_descriptor_buffer_binding("material_parameters", material_parameter_buffer, BufferType::Storage);
     rt_pipeline.set_descriptor_buffer_binding("lights", lights_buffer, BufferType::Storage);
+    rt_pipeline.set_descriptor_buffer_binding("light_tree", light_tree_buffer, BufferType::Storage);
+    rt_pipeline.set_descriptor_buffer_binding("light_distributions", light_distribution_buffer, BufferType::Storage);
+    // kernels are specialized for the enabled outputs like the raytracing stages
+    if (active_integrator == Integrator::Wavefront) wavefront_integrator.build(&device, &rt_pipeline_builder);
+    if (active_integrator == Integrator::Megakernel) megakernel_integrator.build(&device, &rt_pipeline_builder);
     recreate_render_images();
     vkDeviceWaitIdle(device.vulkan_device);
     old_rt_pipeline.free();
@@ -1924,12 +2809,125 @@ void VulkanApplication::rebuild_pipeline() {
     p_pipeline = p_pipeline_builder.build();
 
     VkCommandBuffer cmdbuf = device.begin_single_use_command_buffer();
-    p_pipeline_builder.cmd_on_resize(cmdbuf, swap_chain_extent, render_image_extent);
+    p_pipeline_builder.cmd_on_resize(cmdbuf, swap_chain_extent, render_buffer_extent);
     device.end_single_use_command_buffer(cmdbuf);
 
     pipeline_dirty = false;
 }
 
+// all compute shaders that can be hot reloaded
+std::vector<ComputeShader*> VulkanApplication::get_compute_shaders() {
+    std::vector<ComputeShader*> shaders = p_pipeline_builder.created_compute_shaders;
+    shaders.push_back(adaptive_compact_shader);
+    shaders.push_back(output_decode_shader);
+    return shaders;
+}
+
+// applies finished background compilations and starts compiling shaders affected by modified files
+// only stages and compute shaders depending on a modified file are recompiled and swapped
+void VulkanApplication::update_shader_reload() {
+    PROFILE_ZONE("update_shader_reload");
+    std::vector<std::filesystem::path> modified_files = shader_watcher.poll();
+    if (ui.shader_hot_reload) modified_shader_files.insert(modified_shader_files.end(), modified_files.begin(), modified_files.end());
+
+    if (shader_reload.compilation.valid()) {
+        if (shader_reload.compilation.wait_for(std::chrono::seconds(0)) != std::future_status::ready) return;
+
+        try {
+            std::vector<std::filesystem::path> compiled_paths = shader_reload.compilation.get();
+            size_t rt_stage_count = shader_reload.rt_stages.size();
+            if (rt_stage_count > 0) {
+                std::vector<std::filesystem::path> rt_stage_paths(compiled_paths.begin(), compiled_paths.begin() + rt_stage_count);
+                rt_pipeline_builder.reload_stages(rt_pipeline, shader_reload.rt_stages, rt_stage_paths);
+            }
+            for (size_t i = 0; i < shader_reload.compute_shaders.size(); i++) {
+                shader_reload.compute_shaders[i]->reload(compiled_paths[rt_stage_count + i]);
+            }
+            std::cout << "reloaded " << rt_stage_count << " raytracing stages and " << shader_reload.compute_shaders.size() << " compute shaders" << std::endl;
+            clear_accumulated_frames();
+        } catch (std::exception& e) {
+            // the previous pipelines stay in use until the error is fixed
+            std::cout << "shader reload failed: " << e.what() << std::endl;
+        }
+        shader_reload = ShaderReload{};
+    }
+
+    if (modified_shader_files.empty()) return;
+
+    // kernels of compute integrators are recompiled by a full rebuild
+    if (active_integrator == Integrator::Wavefront && wavefront_integrator.depends_on(modified_shader_files)) pipeline_dirty = true;
+    if (active_integrator == Integrator::Megakernel && megakernel_integrator.depends_on(modified_shader_files)) pipeline_dirty = true;
+
+    shader_reload.rt_stages = rt_pipeline_builder.get_stages_depending_on(modified_shader_files);
+    std::vector<std::string> shader_paths;
+    for (size_t stage : shader_reload.rt_stages) shader_paths.push_back(rt_pipeline_builder.shader_stages[stage]->get_shader_code_path());
+    for (ComputeShader* shader : get_compute_shaders()) {
+        if (shader_depends_on(shader->code_path, modified_shader_files)) {
+            shader_reload.compute_shaders.push_back(shader);
+            shader_paths.push_back(shader->code_path);
+        }
+    }
+    modified_shader_files.clear();
+
+    if (shader_paths.empty()) return;
+    shader_reload.compilation = std::async(std::launch::async, compile_shaders, shader_paths, std::vector<std::string>());
+}
+
+// outputs are only allocated and written while the display, processing stages or instance picking read them
+void VulkanApplication::update_requested_outputs() {
+    std::vector<std::string> outputs = {ui.selected_output_image, "Instance Indices"};
+    if (ui.use_processing_pipeline) {
+        for (auto& output : p_pipeline_builder.get_required_outputs()) outputs.push_back(output);
+    }
+
+    if (rt_pipeline_builder.set_requested_outputs(outputs)) pipeline_dirty = true;
+}
+
+// builds the kernels and buffers of a compute integrator when it is selected and frees them when it is deselected
+void VulkanApplication::update_integrator() {
+    wavefront_integrator.sort_by_material = ui.wavefront_material_sorting;
+    wavefront_integrator.sort_by_coherence = ui.wavefront_coherence_sorting;
+    wavefront_integrator.scene_bounds_min = scene_bounds_min;
+    wavefront_integrator.scene_bounds_max = scene_bounds_max;
+    if (ui.integrator == active_integrator) return;
+
+    vkDeviceWaitIdle(device.vulkan_device);
+    wavefront_integrator.free();
+    megakernel_integrator.free();
+    active_integrator = ui.integrator;
+    if (active_integrator == Integrator::Wavefront) {
+        wavefront_integrator.build(&device, &rt_pipeline_builder);
+        wavefront_integrator.resize(rt_pipeline, render_buffer_extent);
+    } else if (active_integrator == Integrator::Megakernel) {
+        megakernel_integrator.build(&device, &rt_pipeline_builder);
+    }
+    std::cout << "using " << get_integrator_name(active_integrator) << " integrator" << std::endl;
+    clear_accumulated_frames();
+}
+
+// returns a full precision buffer of the output, packed formats are unpacked into the display buffer
+Buffer* VulkanApplication::cmd_decode_output(VkCommandBuffer command_buffer, OutputBuffer& output) {
+    if (output.format == OUTPUT_FORMAT_RGBA32F) return &output.buffer;
+
+    device.gpu_profiler.cmd_begin_zone(command_buffer, "Decode Output");
+    output_decode_shader->set_buffer(0, &output.buffer);
+
+    Shaders::PushConstantsPacked push_constants_packed = get_push_constants();
+    push_constants_packed.flags = output.format;
+    uint32_t groups_x = (render_image_extent.width + output_decode_shader->local_dispatch_size_x - 1) / output_decode_shader->local_dispatch_size_x;
+    uint32_t groups_y = (render_image_extent.height + output_decode_shader->local_dispatch_size_y - 1) / output_decode_shader->local_dispatch_size_y;
+    output_decode_shader->dispatch(command_buffer, groups_x, groups_y, 1, push_constants_packed);
+
+    VkMemoryBarrier barrier {};
+    barrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+    barrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+    barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_TRANSFER_READ_BIT;
+    vkCmdPipelineBarrier(command_buffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT | VK_PIPELINE_STAGE_TRANSFER_BIT, 0, 1, &barrier, 0, nullptr, 0, nullptr);
+    device.gpu_profiler.cmd_end_zone(command_buffer);
+
+    return &output_display_buffer;
+}
+
 void VulkanApplication::set_scene_path(std::string path) {
     scene_path = std::filesystem::path(path);
 }
@@ -1942,11 +2940,15 @@ void VulkanApplication::set_pipeline_dirty() {
     pipeline_dirty = true;
 }
 
+// the displayed image is written once its readback has completed
 void VulkanApplication::save_screenshot(std::string path) {
-    void* image_data;
-    vkMapMemory(render_transfer_image.device->vulkan_device, render_transfer_image.texture_memory, render_transfer_image.texture_memory_offset, render_transfer_image.memory_requirements.size, 0, &image_data);
-    save_exr_image(path.c_str(), image_data, swap_chain_extent.width, swap_chain_extent.height, sizeof(float) * 4);
-    vkUnmapMemory(render_transfer_image.device->vulkan_device, render_transfer_image.texture_memory);
+    ReadbackRegion region;
+    region.width = display_extent.width;
+    region.height = display_extent.height;
+    readback.request(region, [path](ReadbackResult& result) {
+        save_exr_image(path.c_str(), result.data.data(), result.region.width, result.region.height, result.pixel_size);
+        std::cout << "saved screenshot to " << path << std::endl;
+    });
 }
 
 double VulkanApplication::get_fps() {
@@ -1957,6 +2959,18 @@ uint32_t VulkanApplication::get_accumulated_frames() {
     return accumulated_frames;
 }
 
+uint32_t VulkanApplication::get_adaptive_active_pixels() {
+    return adaptive_active_pixels;
+}
+
+float VulkanApplication::get_adaptive_mean_error() {
+    return adaptive_mean_error;
+}
+
+double VulkanApplication::get_traversal_rays_per_second() {
+    return wavefront_integrator.last_traversal_rays_per_second;
+}
+
 void VulkanApplication::clear_accumulated_frames() {
     clear_frames = true;
 }
@@ -1975,6 +2989,14 @@ SceneData& VulkanApplication::get_scene_data() {
     return loaded_scene_data;
 }
 
+GPUProfiler& VulkanApplication::get_gpu_profiler() {
+    return device.gpu_profiler;
+}
+
+QualityController& VulkanApplication::get_quality_controller() {
+    return quality_controller;
+}
+
 std::vector<Shaders::Light>& VulkanApplication::get_lights() {
     return lights;
 }
\ No newline at end of file
@@ -1,17 +1,25 @@
 #include "core/vulkan.h"
 #include "core/device.h"
 #include "core/buffer.h"
+#include "core/quality_controller.h"
+#include "core/readback.h"
+#include "core/light_tree.h"
 #include "loaders/image.h"
 #include "loaders/scene.h"
 #include "loaders/geometry_gltf.h"
 #include "loaders/toml.hpp"
 #include "loaders/environment.h"
+#include "loaders/batch.h"
 #include "processors/gltf/gltf_processor.h"
 #include "pipeline/raytracing/pipeline_builder.h"
+#include "pipeline/raytracing/integrator.h"
+#include "pipeline/raytracing/wavefront_integrator.h"
+#include "pipeline/raytracing/megakernel_integrator.h"
 #include "pipeline/processing/pipeline_builder.h"
 #include "pipeline/processing/compute_shader.h"
 #include "ui.h"
 #include "shader_interface.h"
+#include "shader_watcher.h"
 
 #include <vector>
 #include <optional>
@@ -19,6 +27,7 @@
 #include <functional>
 #include <iostream>
 #include <filesystem>
+#include <future>
 
 #include "glm/glm.hpp"
 using vec2 = glm::vec2;
@@ -34,6 +43,29 @@ struct QueueFamilyIndices
     std::optional<uint32_t> present;
 };
 
+// settings for rendering without window or swapchain
+struct HeadlessSettings {
+    VkExtent2D extent = {1280, 720};
+    // stop after this many samples per pixel (0 = unlimited)
+    uint32_t sample_count = 0;
+    // stop after this many seconds of rendering (0 = unlimited)
+    double time_budget = 0.0;
+    // names of output buffers to write, defaults to the result image
+    std::vector<std::string> outputs;
+    std::filesystem::path output_directory = ".";
+    // render in tiles of this size with tile-sized output buffers (0 = full frame)
+    uint32_t tile_size = 0;
+    // sample adaptively and stop once the mean relative pixel error reaches this value (0 = disabled)
+    float adaptive_threshold = 0.0f;
+    Integrator integrator = Integrator::RaytracingPipeline;
+    // wavefront integrator: shade hits ordered by material
+    bool material_sorting = true;
+    // wavefront integrator: trace secondary rays ordered by coherence key
+    bool coherence_sorting = false;
+    // render with every integrator in turn and print their paths per second side by side, no outputs are written
+    bool benchmark = false;
+};
+
 struct MeshData {
     VkDevice device_handle;
     size_t index_count;
@@ -51,10 +83,18 @@ struct MeshData {
 };
 
 struct AccelerationStructure {
-    VkAccelerationStructureKHR acceleration_structure;
+    VkAccelerationStructureKHR acceleration_structure = VK_NULL_HANDLE;
     Buffer buffer;
 };
 
+// gpu resources of a loaded object file, kept resident across scene changes
+struct LoadedObject {
+    GLTFData gltf;
+    std::vector<MeshData> meshes;
+    std::vector<AccelerationStructure> blas;
+    std::vector<Image> textures;
+};
+
 struct VulkanApplication {
     private:
     GLFWwindow* window;
@@ -63,6 +103,10 @@ struct VulkanApplication {
 
     bool minimized = false;
 
+    bool headless = false;
+    HeadlessSettings headless_settings;
+    std::vector<BatchJob> batch_jobs;
+
     float last_cursor_x, last_cursor_y, delta_cursor_x, delta_cursor_y;
 
     VkInstance vulkan_instance;
@@ -78,6 +122,7 @@ struct VulkanApplication {
     VkQueue present_queue;
 
     UI ui;
+    QualityController quality_controller;
 
     VkSwapchainKHR swap_chain;
     std::vector<VkImage> swap_chain_images;
@@ -89,9 +134,19 @@ struct VulkanApplication {
     VkDescriptorPool imgui_descriptor_pool;
 
     float render_scale;
+    // allocated extent of the output buffers, the rendered extent can be smaller
+    VkExtent2D render_buffer_extent;
     VkExtent2D render_image_extent;
+    // full image extent and offset of the rendered region when rendering in tiles
+    VkExtent2D render_full_extent;
+    VkOffset2D render_tile_offset = {0, 0};
 
     Image render_transfer_image;
+    // extent of the displayed region of the transfer image
+    VkExtent2D display_extent{};
+
+    // cursor color and screenshots are read back from the transfer image
+    ReadbackRing readback;
 
     VkRenderPass render_pass;
     RaytracingPipelineBuilder rt_pipeline_builder;
@@ -129,10 +184,39 @@ struct VulkanApplication {
     Buffer restir_reservoir_buffer_0, restir_reservoir_buffer_1;
     Buffer prev_camera_matrix_buffer;
 
+    // adaptive sampling: compaction of unconverged pixels into an indirect trace command
+    ComputeShader* adaptive_compact_shader = nullptr;
+    Buffer adaptive_sampling_buffer{}, adaptive_error_buffer{};
+    bool adaptive_sampling_active = false;
+    bool adaptive_statistics_pending = false;
+    uint32_t adaptive_active_pixels = 0;
+    float adaptive_mean_error = 0.0f;
+
+    // compute integrators share outputs and descriptors with the raytracing pipeline, their kernels and buffers only exist while selected
+    Integrator active_integrator = Integrator::RaytracingPipeline;
+    WavefrontIntegrator wavefront_integrator;
+    MegakernelIntegrator megakernel_integrator;
+
+    // unpacks half precision and 8 bit outputs for display
+    ComputeShader* output_decode_shader = nullptr;
+    Buffer output_display_buffer{};
+
+    // shader hot reload: modified shaders are compiled in the background while the current pipelines keep rendering
+    ShaderWatcher shader_watcher;
+    std::vector<std::filesystem::path> modified_shader_files;
+    struct ShaderReload {
+        std::vector<size_t> rt_stages;
+        std::vector<ComputeShader*> compute_shaders;
+        // compiled modules, raytracing stages first
+        std::future<std::vector<std::filesystem::path>> compilation;
+    } shader_reload;
+
     std::filesystem::path scene_path;
     SceneData loaded_scene_data;
 
     EnvironmentMap loaded_environment;
+    // absolute path or color of the loaded environment map
+    std::string loaded_environment_key;
 
     GLTFProcessor* gltf_processor = nullptr;
 
@@ -143,6 +227,9 @@ struct VulkanApplication {
     // this uses loaded_texture_index
     std::vector<Image> loaded_textures;
 
+    // mapping absolute object path -> resident object resources
+    std::unordered_map<std::string, LoadedObject> object_cache;
+
     // mapping object name -> GLTF data
     std::unordered_map<std::string, GLTFData> loaded_objects;
     // mapping object name -> mesh index offset
@@ -156,6 +243,16 @@ struct VulkanApplication {
     Buffer lights_buffer;
     std::vector<InstanceData::MaterialParameters> material_parameters;
     std::vector<Shaders::Light> lights;
+    // indexed like lights, spatial bounds and surface area of area lights are computed when they are created
+    std::vector<LightBounds> light_bounds;
+    LightTree light_tree;
+    Buffer light_tree_buffer;
+    // top level distribution followed by the per triangle distributions of area lights
+    Buffer light_distribution_buffer;
+    // radius of the bounding sphere of all scene geometry
+    float scene_radius = 1.0f;
+    // bounding box of all scene geometry
+    vec3 scene_bounds_min = vec3(-1.0f), scene_bounds_max = vec3(1.0f);
 
     VkResult CreateDebugUtilsMessengerEXT(VkInstance instance, const VkDebugUtilsMessengerCreateInfoEXT *pCreateInfo, const VkAllocationCallbacks *pAllocator, VkDebugUtilsMessengerEXT *pDebugMessenger);
     void DestroyDebugUtilsMessengerEXT(VkInstance instance, VkDebugUtilsMessengerEXT debugMessenger, const VkAllocationCallbacks *pAllocator);
@@ -172,16 +269,45 @@ struct VulkanApplication {
     void create_swapchain();
     void create_swapchain_image_views();
     void create_framebuffers();
+    void create_render_pass();
     void recreate_swapchain();
     void recreate_render_images();
+    void resize_render_buffers();
+    void apply_render_scale();
     void rebuild_pipeline();
+    void update_requested_outputs();
+    void update_integrator();
+    std::vector<ComputeShader*> get_compute_shaders();
+    void update_shader_reload();
+    Buffer* cmd_decode_output(VkCommandBuffer command_buffer, OutputBuffer& output);
+    void load_scene();
+    void free_loaded_object(LoadedObject& object);
+    void free_scene_resources();
+    void change_scene(std::filesystem::path path);
     void create_default_descriptor_writes();
+    void update_light_tree();
     void create_synchronization();
+    void update_camera_matrix();
+    Shaders::PushConstantsPacked get_push_constants();
+    RaytracingPipelineSettings get_pipeline_settings();
+    uint32_t get_adaptive_min_frames();
+    void cmd_compact_adaptive_pixels(VkCommandBuffer command_buffer, Shaders::PushConstantsPacked& push_constants_packed);
+    Shaders::PushConstantsPacked cmd_trace_rays(VkCommandBuffer command_buffer);
+    void update_adaptive_statistics();
     void draw_frame();
+    // returns the camera paths traced per second
+    double accumulate_headless_samples(uint32_t target_samples, double time_budget);
+    std::filesystem::path get_headless_output_path(std::string output);
+    void run_headless();
+    void run_headless_tiled(std::vector<std::string> outputs, uint32_t target_samples);
+    void run_headless_benchmark(uint32_t target_samples);
+    void run_batch();
 
     public:
 
     void set_scene_path(std::string path);
+    void set_headless(HeadlessSettings settings);
+    void set_batch_jobs(std::vector<BatchJob> jobs);
     void setup();
     void run();
     void cleanup();
@@ -192,11 +318,16 @@ struct VulkanApplication {
     RaytracingPipeline get_pipeline();
     SceneData& get_scene_data();
     std::vector<Shaders::Light>& get_lights();
+    GPUProfiler& get_gpu_profiler();
+    QualityController& get_quality_controller();
 
     void save_screenshot(std::string path);
 
     double get_fps();
     uint32_t get_accumulated_frames();
+    uint32_t get_adaptive_active_pixels();
+    float get_adaptive_mean_error();
+    double get_traversal_rays_per_second();
     void clear_accumulated_frames();
     vec2 get_cursor_position();
 };
\ No newline at end of file